@@ -105,7 +105,9 @@
 #define configUSE_MALLOC_FAILED_HOOK	0
 #define configUSE_APPLICATION_TASK_TAG	0
 #define configUSE_COUNTING_SEMAPHORES	1
-#define configGENERATE_RUN_TIME_STATS	0
+#define configGENERATE_RUN_TIME_STATS	1
+#define configSUPPORT_DYNAMIC_ALLOCATION	1
+#define configSUPPORT_STATIC_ALLOCATION	1
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 			0
@@ -128,6 +130,16 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil				1
 #define INCLUDE_vTaskDelay					1
 #define INCLUDE_xTaskGetSchedulerState		1
+#define INCLUDE_xTaskGetIdleTaskHandle		1
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle	1
+
+/* Run time stats are counted on the DWT cycle counter, see runtimeStats.cpp */
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+	extern void vConfigureRunTimeStatsTimer( void );
+	extern uint32_t ulGetRunTimeCounterValue( void );
+	#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vConfigureRunTimeStatsTimer()
+	#define portGET_RUN_TIME_COUNTER_VALUE()			ulGetRunTimeCounterValue()
+#endif
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -157,6 +169,17 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 /* Normal assert() semantics without relying on the provision of an assert.h
 header file. */
 #define configASSERT( x ) if( ( x ) == 0 ) { taskDISABLE_INTERRUPTS(); for( ;; ); }	
+
+/* Heap allocations after boot trap in static allocation mode, see staticMemory.cpp */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+ #include <stddef.h>
+ #ifdef __cplusplus
+ extern "C" void vHeapGuardCheck( size_t xSize );
+ #else
+ extern void vHeapGuardCheck( size_t xSize );
+ #endif
+ #define traceMALLOC( pvAddress, uiSize )	vHeapGuardCheck( uiSize )
+#endif
 	
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
 standard names. */
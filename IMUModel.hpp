@@ -142,5 +142,86 @@ namespace IMU
 		}
 	};
 
+
+	/**
+	* @brief Closed form Kalman filter for the identity system/measurement models above
+	*
+	* Both SystemModel::f and MeasurementModel::h are identities, so the unscented transform
+	* used by Kalman::SquareRootUnscentedKalmanFilter is exact and the filter reduces to a
+	* linear Kalman filter. With diagonal process and measurement covariances (and the identity
+	* initial covariance the SR-UKF also starts from) every matrix stays diagonal, leaving six
+	* independent scalar filters, run without any sigma points, QR decompositions or Cholesky
+	* updates.
+	*
+	* It is the textbook filter, with gain P/(P + R) from the predicted variance. The SR-UKF
+	* measures the sigma points predict() drew before adding process noise, so its gain is
+	* P_prev/(P_prev + R) instead. Both settle on the same steady state gain, but they differ
+	* while P is still converging from its initial value: on ahrs_recorded_output.csv
+	* (host/smoother_bench against WorkspaceSquareRootUKF) the estimates are 1.0e-3 apart on
+	* the first sample and within float rounding after about 30.
+	*
+	* The interface mirrors the SR-UKF so either one can be handed to SOAR_AHRS::FilterChainT.
+	*
+	* @warning Only valid for the IMU models in this file with diagonal covariances. Any
+	*			off-diagonal terms are ignored.
+	*/
+	template<class StateType>
+	class IdentityKalmanFilter
+	{
+	public:
+		typedef typename StateType::Scalar T;
+		typedef Kalman::Vector<T, 6> Variance;
+
+		/**
+		* @brief Accepts the same parameters as the SR-UKF so the two are interchangeable
+		*
+		* The sigma point scaling parameters have no effect on a linear model and are unused.
+		*/
+		IdentityKalmanFilter(T /* alpha */ = T(1), T /* beta */ = T(2), T /* kappa */ = T(0))
+		{
+			x.setZero();
+			P.setOnes();
+		}
+
+		void init(const StateType& initialState)
+		{
+			x = initialState;
+		}
+
+		/**
+		* @brief Prediction step. x is unchanged by the identity model, only the variance grows.
+		*/
+		template<class System>
+		const StateType& predict(const System& s)
+		{
+			P += s.getCovariance().diagonal();
+			return x;
+		}
+
+		/**
+		* @brief Measurement update, one scalar Kalman gain per axis
+		*/
+		template<class Measure, class MeasurementType>
+		const StateType& update(const Measure& m, const MeasurementType& z)
+		{
+			const Variance R = m.getCovariance().diagonal();
+
+			for (int i = 0; i < 6; i++)
+			{
+				T K = P[i] / (P[i] + R[i]);
+				x[i] += K * (z[i] - x[i]);
+				P[i] = (T(1) - K) * P[i];
+			}
+
+			return x;
+		}
+
+		const StateType& getState() const { return x; }
+		const Variance& getVariance() const { return P; }
+
+	private:
+		StateType x;
+		Variance P;		/* Diagonal of the state covariance */
+	};
 }
 #endif 
\ No newline at end of file
@@ -13,7 +13,6 @@
 
 /* Boost Includes */
 #include <boost/smart_ptr.hpp>
-#include <boost/make_shared.hpp>
 
 /* FreeRTOS Includes */
 #include "FreeRTOS.h"
@@ -22,34 +21,140 @@
 
 /* Project Includes */
 #include "ahrs.hpp"
-#include "LSM9DS1.hpp"
 #include "config.hpp"
 #include "dataTypes.hpp"
 #include "threading.hpp"
+#include "dataReady.hpp"
+#include "staticMemory.hpp"
 
-/* Madgwick Filter */
-#include "madgwick.hpp"
+/* Sensor Sources */
+#include "sensors.hpp"
+#include "lsm9ds1Source.hpp"
 
-/* Kalman Filter */
-#include "kalman/SquareRootUnscentedKalmanFilter.hpp"
-#include "IMUModel.hpp"
+/* Filter Chain */
+#include "ahrsFilter.hpp"
+#include "cycleCounter.hpp"
+#include "trace.hpp"
+#include "rateGroup.hpp"
+#include "magCalibration.hpp"
+#include "calibrationStore.hpp"
+#include "calibrationTask.hpp"
+#include "bootTiming.hpp"
 
+/* Only the LSM9DS1 has calibration worth keeping */
+#define AHRS_CAL_STORE	(CAL_STORE_ENABLED && (AHRS_SENSOR_SOURCE == AHRS_SENSOR_LSM9DS1))
 
 
 namespace SOAR_AHRS
 {
-	typedef float T;
-	typedef IMU::State<T> State;
-	typedef IMU::Control<T> Control;
-	typedef IMU::Measurement<T> Measurement;
-	typedef IMU::SystemModel<T> SystemModel;
-	typedef IMU::MeasurementModel<T> MeasurementModel;
+	const int updateRate_mS = (1.0 / AHRS_SAMPLE_RATE_HZ) * 1000.0;
 
-	const int updateRate_mS = (1.0 / SENSOR_UPDATE_FREQ_HZ) * 1000.0;
-	const int magMaxUpdateRate_mS = (1.0 / LSM9DS1_M_MAX_BW) * 1000.0;
+	/* Everything the ahrsTask rate groups share. Lives on the task's stack. */
+	template<class Source>
+	struct SampleContext
+	{
+		SampleContext(Source& imu, FilterChain& filter, AHRSData_t& data) :
+			imu(imu), filter(filter), data(data), lastSampleCycles(0), sampleCycles(0), dt(0.0f)
+			#if (MAG_CAL_ONLINE)
+			, magCal(true)
+			#endif
+		{
+			mag_raw.setZero();	/* The first mag read may be a few samples in */
+		}
+
+		Source& imu;
+		FilterChain& filter;
+		AHRSData_t& data;
+
+		Eigen::Vector3f accel_raw, gyro_raw, mag_raw;
+
+		/* Cycle count when the previous sample was taken. The variable dt path integrates
+		* the real time between samples rather than the nominal period. */
+		uint32_t lastSampleCycles;
+		uint32_t sampleCycles;
+
+		float dt;			/* Integrated by the last filter step */
+
+		#if (MAG_CAL_ONLINE)
+		MagCalibrator magCal;		/* Deferred, calibrationTask does the solves */
+		#endif
+
+		#if (MAG_CAL_ONLINE && AHRS_CAL_STORE)
+		CalibrationStore* calibration;
+		#endif
+	};
+
+	/* Mag group, at no more than LSM9DS1_M_MAX_BW (~75Hz). The mag has no FIFO, so a batch
+	* of accel/gyro samples shares one reading. */
+	template<class Source>
+	static void runMagGroup(void* context, uint32_t periods)
+	{
+		SampleContext<Source>& ctx = *static_cast<SampleContext<Source>*>(context);
+
+		TRACE_BEGIN(TRACE_MAG_READ);
+		ctx.imu.readMag(ctx.mag_raw);
+		TRACE_END(TRACE_MAG_READ);
+
+		#if (MAG_CAL_ONLINE)
+		/* Every reading refines the fit, then gets the best correction so far */
+		#if (AHRS_CAL_STORE)
+		/* The fit is saved once per run, after it has settled, and only if it moved. The flash
+		* write itself happens later in calibrationTask. */
+		if (ctx.magCal.addSample(ctx.mag_raw) && (ctx.magCal.accepted() == CAL_STORE_MAG_SAVE_AFTER) &&
+			ctx.calibration->magDiffers(ctx.magCal.hardIron()))
+		{
+			ctx.calibration->setMagCorrection(ctx.magCal.hardIron(), ctx.magCal.softIron());
+			ctx.calibration->requestSave();
+		}
+		#else
+		ctx.magCal.addSample(ctx.mag_raw);
+		#endif
+
+		ctx.magCal.apply(ctx.mag_raw);
+		#endif
+	}
+
+	/* Accel/gyro group, at the full sample rate. In FIFO mode periods is the batch size. */
+	template<class Source>
+	static void runInertialGroup(void* context, uint32_t periods)
+	{
+		SampleContext<Source>& ctx = *static_cast<SampleContext<Source>*>(context);
+
+		#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+		const uint32_t edgeTimestamp_mS = ctx.data.timestamp_mS;
+		#endif
+
+		for (uint32_t sample = 0; sample < periods; sample++)
+		{
+			/* Lands in the filter frame, already aligned */
+			ctx.imu.readInertial(ctx.accel_raw, ctx.gyro_raw);
+
+			#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+			/* The edge marks the sample that reached the threshold; the rest are spaced
+			* one output data period either side of it */
+			ctx.data.timestamp_mS = edgeTimestamp_mS +
+				(((int32_t)sample - (IMU_FIFO_THRESHOLD - 1)) * 1000) / IMU_ODR_HZ;
+			#endif
 
-	const float accelUncertainty = 0.8f;
-	const float gyroUncertainty = 1.05f;
+			/*----------------------------
+			* UKF + AHRS Algorithm, or the error-state EKF (AHRS_PIPELINE)
+			*---------------------------*/
+			#if (AHRS_VARIABLE_DT)
+			#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+			/* FIFO entries are paced by the sensor's own clock */
+			ctx.dt = 1.0f / IMU_ODR_HZ;
+			#else
+			ctx.dt = SOAR_PROFILE::cyclesToSeconds(ctx.lastSampleCycles, ctx.sampleCycles);
+			#endif
+
+			ctx.filter.step(ctx.accel_raw, ctx.gyro_raw, ctx.mag_raw, ctx.dt, ctx.data);
+			#else
+			ctx.filter.step(ctx.accel_raw, ctx.gyro_raw, ctx.mag_raw, ctx.data);
+			#endif
+		}
+
+		ctx.lastSampleCycles = ctx.sampleCycles;
+	}
 
 	void ahrsTask(void* argument)
 	{
@@ -67,6 +172,28 @@ namespace SOAR_AHRS
 		volatile float my;
 		volatile float mz;
 		volatile UBaseType_t stackHighWaterMark_AHRS = 0;
+		volatile uint32_t smootherCycles = 0;
+		volatile uint32_t orientationCycles = 0;
+		volatile uint32_t sampleLatencyCycles = 0;
+		volatile uint32_t dataReadyMissed = 0;
+		volatile uint32_t dataReadyTimeouts = 0;
+		volatile uint32_t fifoBatchSize = 0;
+		volatile uint32_t fifoRedrains = 0;
+		volatile float sampleDt_uS = 0.0f;
+		volatile uint32_t orientationSteps = 0;
+		volatile uint32_t magRate_Hz = 0;
+		volatile uint32_t inertialJitterMax_uS = 0;
+		volatile uint32_t rateGroupOverruns = 0;
+		volatile uint32_t frameOverruns = 0;
+		volatile uint32_t magCalAccepted = 0;
+		volatile float magField_G = 0.0f;
+		#if (AHRS_PIPELINE == AHRS_PIPELINE_ESKF)
+		volatile float gyroBiasX_dps = 0.0f;
+		volatile float gyroBiasY_dps = 0.0f;
+		volatile float gyroBiasZ_dps = 0.0f;
+		#endif
+		volatile uint8_t calibrationStatus = CAL_STATUS_NONE;
+		volatile uint32_t calibrationSaves = 0;
 		volatile size_t bytesRemaining = xPortGetFreeHeapSize();
 		#endif
 
@@ -74,82 +201,91 @@ namespace SOAR_AHRS
 
 
 		/*----------------------------------
-		* Initialize the UKF
+		* Initialize the UKF and Madgwick Filter, or the error-state EKF
 		*----------------------------------*/
-		State x, x_ukf;
-		Control u;
-		SystemModel sys;
-		MeasurementModel om;
-		Measurement meas;
+		FilterChain filter;
 
-		Eigen::Matrix<T, 6, 6> R;
-		Eigen::Matrix<T, 6, 6> processNoise;
-
-		Kalman::SquareRootUnscentedKalmanFilter<State> ukf(0.5f, 3.0f, 0.0f);
-
-		x.setZero();
-		u.setZero();
-		R.setZero();
-
-		T cnst = 5.00e-4f;
-		T dnst = 3.33e-4f;
-		T enst = 5.00e-4f;
-
-		processNoise <<
-			cnst, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, dnst, 0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, enst, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, cnst, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f, dnst, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, enst;
-
-		sys.setCovariance(processNoise);
-
-		R(0, 0) = accelUncertainty * accelUncertainty;
-		R(1, 1) = accelUncertainty * accelUncertainty;
-		R(2, 2) = accelUncertainty * accelUncertainty;
-		R(3, 3) = gyroUncertainty * gyroUncertainty;
-		R(4, 4) = gyroUncertainty * gyroUncertainty;
-		R(5, 5) = gyroUncertainty * gyroUncertainty;
-
-		om.setCovariance(R);
-
-		ukf.init(x);
+		SOAR_PROFILE::enableCycleCounter();
 
 
 		/*----------------------------------
 		* Initialize the IMU
 		*----------------------------------*/
-		GPIOClass_sPtr lsm_ss_xg = boost::make_shared<GPIOClass>(GPIOC, PIN_4, ULTRA_SPD, NOALTERNATE);
-		GPIOClass_sPtr lsm_ss_m = boost::make_shared<GPIOClass>(GPIOC, PIN_3, ULTRA_SPD, NOALTERNATE);
+		#if (AHRS_SENSOR_SOURCE == AHRS_SENSOR_LSM9DS1)
+		GPIOClass_sPtr lsm_ss_xg = SOAR_MEMORY::makePeripheral<GPIOClass>(GPIOC, PIN_4, ULTRA_SPD, NOALTERNATE);
+		GPIOClass_sPtr lsm_ss_m = SOAR_MEMORY::makePeripheral<GPIOClass>(GPIOC, PIN_3, ULTRA_SPD, NOALTERNATE);
 		SPIClass_sPtr lsm_spi = spi2;
 
-		LSM9DS1 imu(lsm_spi, lsm_ss_xg, lsm_ss_m);
+		#if (AHRS_CAL_STORE)
+		/* Biases and mag correction from the last run, so a warm boot skips calibrating */
+		CalibrationStore calibration;
+		calibration.load();
+
+		LSM9DS1Source<> imu(lsm_spi, lsm_ss_xg, lsm_ss_m, &calibration);
+		#else
+		LSM9DS1Source<> imu(lsm_spi, lsm_ss_xg, lsm_ss_m);
+		#endif
+		#else
+		SyntheticSource<> imu;
+		#endif
+		static_assert(IsSensorSource<decltype(imu)>::value, "The AHRS sensor must implement the interface in sensors.hpp");
+		typedef decltype(imu) Source;
 
 		/* Force halt of the device if the IMU cannot be reached */
-		if (imu.begin() == 0)
+		if (!imu.begin())
 			BasicErrorHandler("The IMU WHO_AM_I registers did not return valid readings");
 
-		//TODO: Switch this out to print over the serial port
+		SOAR_PROFILE::bootMark(SOAR_PROFILE::BOOT_IMU_READY);
 
-		imu.calibrate(true); /* "true" forces an automatic software subtraction of the calculated bias from all further data */
-		imu.calibrateMag(true); /* "true" writes the offest into the mag sensor hardware for automatic subtraction in results */
+		#if (AHRS_CAL_STORE)
+		SOAR_PROFILE::bootSetCalibration(calibration.status());
+		#endif
 
-		int count = 0;
+		//TODO: Switch this out to print over the serial port
+
+		#if (AHRS_ACQUISITION_MODE != AHRS_ACQUISITION_POLLED)
+		DataReadyEvent dataReady;
+		#if (AHRS_SENSOR_SOURCE == AHRS_SENSOR_LSM9DS1)
+		dataReadyInit(imu.device());
+		#else
+		dataReadyInit();
+		#endif
+		#endif
 
 
 		/*----------------------------------
-		* Initialize the Madgwick Filter
+		* Rate Groups
 		*----------------------------------*/
-		float beta = 10.0;
-		Eigen::Vector3f accel_raw, gyro_raw, mag_raw;
-		Eigen::Vector3f accel_filtered, gyro_filtered, mag_filtered, eulerDeg;
+		/* One base tick per accel/gyro sample. The mag is registered first so each filter
+		* step sees the freshest reading. */
+		SampleContext<Source> sample(imu, filter, ahrsData);
+		SOAR_SCHEDULE::RateGroupExecutive rateGroups(AHRS_SAMPLE_RATE_HZ);
 
-		MadgwickFilter ahrs((AHRS_UPDATE_RATE_MULTIPLIER * SENSOR_UPDATE_FREQ_HZ), beta);
+		/* Registration order fixes the group indices, which only the debug counters need */
+		enum { MAG_GROUP, INERTIAL_GROUP };
 
-		float dt = (1.0f / SENSOR_UPDATE_FREQ_HZ);
-		float tau_accel = 0.01f;
-		float alpha_lp_accel = dt / tau_accel;
+		rateGroups.add("mag", SOAR_SCHEDULE::divisorForRate(AHRS_SAMPLE_RATE_HZ, LSM9DS1_M_MAX_BW),
+			runMagGroup<Source>, &sample);
+		rateGroups.add("inertial", 1, runInertialGroup<Source>, &sample);
+
+		/* Mag solves and store writes are too slow for the sample path */
+		#if (MAG_CAL_ONLINE)
+		calibrationServe(sample.magCal);
+		#endif
+
+		#if (AHRS_CAL_STORE)
+		calibrationServe(calibration);
+		#endif
+
+		#if (MAG_CAL_ONLINE && AHRS_CAL_STORE)
+		/* Start from the stored mag correction until the online fit has enough data of its own */
+		sample.calibration = &calibration;
+
+		Eigen::Vector3f hardIron;
+		Eigen::Matrix3f softIron;
+		if (calibration.magCorrection(hardIron, softIron))
+			sample.magCal.setCorrection(hardIron, softIron);
+		#endif
 
 
 		/* Tell init task that this thread's initialization is done and ok to run.
@@ -159,7 +295,15 @@ namespace SOAR_AHRS
 		taskYIELD();
 
 
+		#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_POLLED)
 		TickType_t lastTimeWoken = xTaskGetTickCount();
+		#endif
+		sample.lastSampleCycles = SOAR_PROFILE::cycleCount() - (uint32_t)(SOAR_PROFILE::cycleCounterHz() / AHRS_SAMPLE_RATE_HZ);
+
+		#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+		uint32_t fifoBacklog = 0;	/* FIFO level seen right after the last drain */
+		#endif
+
 		for (;;)
 		{
 			#ifdef DEBUG
@@ -170,115 +314,132 @@ namespace SOAR_AHRS
 			/*----------------------------
 			* Sensor Reading
 			*---------------------------*/
+			uint32_t batch = 1;
+
+			#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_POLLED)
 			/* Update Accel & Gyro Data at whatever frequency set by user. Max bandwidth on
 			* chip is 952Hz which will saturate FreeRTOS if sampled that often.*/
-			//taskENTER_CRITICAL();
-			imu.readAccel();
-			imu.readGyro();
-			
-
-			/* Update Mag Data at a max frequency set by LSM9DS1_M_MAX_BW (~75Hz) */
-			#if (SENSOR_UPDATE_FREQ_HZ > LSM9DS1_M_MAX_BW)
-			if (count > magMaxUpdateRate_mS)
+			ahrsData.timestamp_mS = TICKS_TO_MS(xTaskGetTickCount());
+			sample.sampleCycles = SOAR_PROFILE::cycleCount();
+			#else
+			/* Sleep until the IMU signals new data, so every sample is read exactly once and
+			* as soon as it exists. If the edge never comes, read anyway rather than stall. */
+			TickType_t timeout = pdMS_TO_TICKS(IMU_DRDY_TIMEOUT_MS);
+
+			#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+			/* The threshold output is a level but the EXTI line only sees its rising edge. If
+			* the FIFO refilled past the threshold during the last drain, INT1 never dropped
+			* and no edge is coming, so only pick up a pending one and carry straight on. */
+			if (fifoBacklog >= IMU_FIFO_THRESHOLD)
 			{
-				imu.readMag();
-				imu.calcMag();
-				count = 0;
+				timeout = 0;
+
+				#ifdef DEBUG
+				fifoRedrains++;
+				#endif
 			}
-			else
-				count += updateRate_mS;
-			#else
-			imu.readMag();
-			imu.calcMag();
 			#endif
-			//taskEXIT_CRITICAL();
-
-			/* Convert raw data from chip into meaningful data */
-			imu.calcAccel(); imu.calcGyro();
-
-// 			#ifdef DEBUG
-// 			ax = imu.aRaw[0];
-// 			ay = imu.aRaw[1];
-// 			az = imu.aRaw[2];
-// 
-// 			gx = imu.gRaw[0];
-// 			gy = imu.gRaw[1];
-// 			gz = imu.gRaw[2];
-// 
-// 			mx = imu.mRaw[0];
-// 			my = imu.mRaw[1];
-// 			mz = imu.mRaw[2];
-// 			#endif
-
-			accel_raw << imu.aRaw[0], imu.aRaw[1], imu.aRaw[2];
-			gyro_raw << imu.gRaw[0], imu.gRaw[1], imu.gRaw[2];
-			mag_raw <<
-				-imu.mRaw[0],  //Align mag x with accel x
-				-imu.mRaw[1],  //Align mag y with accel y
-				-imu.mRaw[2];  //from LSM9DS1, mag z is opposite direction of accel z
-
 
-			/*----------------------------
-			* UKF Algorithm
-			*---------------------------*/
-			//Simulate the system
-			x = sys.f(x, u);
+			if (waitForDataReady(dataReady, timeout))
+			{
+				ahrsData.timestamp_mS = TICKS_TO_MS(dataReady.tick);
 
-			//Predict state for current time step 
-			x_ukf = ukf.predict(sys);
+				#ifdef DEBUG
+				dataReadyMissed += dataReady.pending - 1;
+				#endif
+			}
+			else
+			{
+				dataReady.cycles = SOAR_PROFILE::cycleCount();
+				ahrsData.timestamp_mS = TICKS_TO_MS(xTaskGetTickCount());
 
-			//Take a measurement given system state
-			meas << accel_raw, gyro_raw;
+				#ifdef DEBUG
+				if (timeout > 0)
+					dataReadyTimeouts++;
+				#endif
+			}
 
-			//Update the state equation given measurement
-			x_ukf = ukf.update(om, meas);
+			sample.sampleCycles = dataReady.cycles;
+			#endif
 
+			TRACE_BEGIN(TRACE_SAMPLE);
 
-			accel_filtered << x_ukf.ax(), x_ukf.ay(), x_ukf.az();
-			gyro_filtered << x_ukf.gx(), x_ukf.gy(), x_ukf.gz();
-			mag_filtered = mag_raw;
+			#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+			/* Drain everything that is there, which may be more than the threshold */
+			batch = imu.samplesReady();
 
+			#ifdef DEBUG
+			fifoBatchSize = batch;
+			#endif
+			#endif
 
-			/*----------------------------
-			* AHRS Algorithm
-			*---------------------------*/
-			/* The Madgwick filter needs to run between 3-5 times as fast IMU measurements
-			* to achieve decent convergence to a stable value. This thread only runs when
-			* new data has arrived from the IMU, so frequency multiplication is as simple
-			* as looping 3-5 times here. */
-			for (int i = 0; i < AHRS_UPDATE_RATE_MULTIPLIER; i++)
-				ahrs.update(accel_filtered, gyro_filtered, mag_filtered);
+			rateGroups.tick(batch);
 
-			ahrs.getEulerDeg(eulerDeg);
-			ahrsData(eulerDeg, accel_filtered, gyro_filtered, mag_filtered);
+			#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+			fifoBacklog = imu.samplesReady();
+			#endif
 
 			#ifdef DEBUG
-			pitch = eulerDeg(0);
-			roll = eulerDeg(1);
-			yaw = eulerDeg(2);
+			#if (AHRS_VARIABLE_DT)
+			sampleDt_uS = sample.dt * 1.0e6f;
+			#endif
+			smootherCycles = filter.smootherCycles();
+			orientationCycles = filter.orientationCycles();
+			orientationSteps = filter.orientationSteps();
+
+			#if (AHRS_PIPELINE == AHRS_PIPELINE_ESKF)
+			const Eigen::Vector3f gyroBias = filter.gyroBiasDps();
+			gyroBiasX_dps = gyroBias(0);
+			gyroBiasY_dps = gyroBias(1);
+			gyroBiasZ_dps = gyroBias(2);
+			#endif
 
-			ax = accel_filtered(0);
-			ay = accel_filtered(1);
-			az = accel_filtered(2);
+			magRate_Hz = rateGroups.rateHz(MAG_GROUP);
+			inertialJitterMax_uS = (uint32_t)(SOAR_PROFILE::cyclesToSeconds(0, rateGroups.stats(INERTIAL_GROUP).maxJitterCycles) * 1.0e6f);
+			rateGroupOverruns = rateGroups.stats(MAG_GROUP).overruns + rateGroups.stats(INERTIAL_GROUP).overruns;
+			frameOverruns = rateGroups.frameOverruns();
 
-			gx = gyro_filtered(0);
-			gy = gyro_filtered(1);
-			gz = gyro_filtered(2);
+			#if (MAG_CAL_ONLINE)
+			magCalAccepted = sample.magCal.accepted();
+			magField_G = sample.magCal.fieldStrength();
+			#endif
 
-			mx = mag_filtered(0);
-			my = mag_filtered(1);
-			mz = mag_filtered(2);
+			#if (AHRS_CAL_STORE)
+			calibrationStatus = calibration.status();
+			calibrationSaves = calibration.saves();
+			#endif
+
+			pitch = ahrsData.pitch();
+			roll = ahrsData.roll();
+			yaw = ahrsData.yaw();
+
+			ax = ahrsData.ax();
+			ay = ahrsData.ay();
+			az = ahrsData.az();
+
+			gx = ahrsData.gx();
+			gy = ahrsData.gy();
+			gz = ahrsData.gz();
+
+			mx = ahrsData.mx();
+			my = ahrsData.my();
+			mz = ahrsData.mz();
 			#endif
 
 			/* Send data over to the Serial thread*/
-			if (xSemaphoreTake(ahrsBufferMutex, 0) == pdPASS)
-			{
-				xQueueOverwrite(qAHRS, &ahrsData);
-				xSemaphoreGive(ahrsBufferMutex);
-			}
+			TRACE_BEGIN(TRACE_PUBLISH);
+			ahrsChannel.publish(ahrsData);
+			TRACE_END(TRACE_PUBLISH);
+			SOAR_PROFILE::bootMark(SOAR_PROFILE::BOOT_FIRST_OUTPUT);
+			TRACE_END(TRACE_SAMPLE);
 
+			#if (AHRS_ACQUISITION_MODE != AHRS_ACQUISITION_POLLED)
+			#ifdef DEBUG
+			sampleLatencyCycles = SOAR_PROFILE::cycleCount() - dataReady.cycles;
+			#endif
+			#else
 			vTaskDelayUntil(&lastTimeWoken, pdMS_TO_TICKS(updateRate_mS));
+			#endif
 		}
 	}
 }
-
@@ -0,0 +1,12 @@
+#include "ahrsFilter.hpp"
+
+namespace SOAR_AHRS
+{
+	/* The firmware's chains and the error-state pipeline. Anything else (double, the other
+	* Attitude scalars, the other orientation filters) is built from the header by the host
+	* tools that use it. */
+	template class FilterChainT<Kalman::SquareRootUnscentedKalmanFilter, T, AttitudeScalar, OrientationFilter>;
+	template class FilterChainT<IMU::WorkspaceSquareRootUKF, T, AttitudeScalar, OrientationFilter>;
+	template class FilterChainT<IMU::IdentityKalmanFilter, T, AttitudeScalar, OrientationFilter>;
+	template class ErrorStateChainT<T>;
+}
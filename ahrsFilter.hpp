@@ -0,0 +1,525 @@
+#pragma once
+#ifndef SOAR_AHRS_FILTER_HPP
+#define SOAR_AHRS_FILTER_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+/* Project Includes */
+#include "config.hpp"
+#include "dataTypes.hpp"
+#include "cycleCounter.hpp"
+#include "trace.hpp"
+
+/* Orientation Filters */
+#include "orientation.hpp"
+#include "fixedPoint.hpp"
+#include "errorStateEKF.hpp"
+
+/* Kalman Filter */
+#include "kalman/SquareRootUnscentedKalmanFilter.hpp"
+#include "IMUModel.hpp"
+#include "workspaceUKF.hpp"
+
+namespace SOAR_AHRS
+{
+	/* Scalar the firmware's smoother runs in */
+	typedef float T;
+	typedef IMU::State<T> State;
+	typedef IMU::Control<T> Control;
+	typedef IMU::Measurement<T> Measurement;
+	typedef IMU::SystemModel<T> SystemModel;
+	typedef IMU::MeasurementModel<T> MeasurementModel;
+
+	/* Scalar the firmware's orientation stage runs in */
+	#if (AHRS_ORIENTATION_SCALAR == AHRS_SCALAR_Q16)
+	typedef Q16 AttitudeScalar;
+	#elif (AHRS_ORIENTATION_SCALAR == AHRS_SCALAR_Q29)
+	typedef Q29 AttitudeScalar;
+	#else
+	typedef float AttitudeScalar;
+	#endif
+
+	/* Orientation filter the firmware runs after the smoother */
+	#if (AHRS_ORIENTATION_FILTER == AHRS_FILTER_MAHONY)
+	template<typename Scalar> using OrientationFilter = MahonyAHRST<Scalar>;
+	#elif (AHRS_ORIENTATION_FILTER == AHRS_FILTER_COMPLEMENTARY)
+	template<typename Scalar> using OrientationFilter = ComplementaryAHRST<Scalar>;
+	#else
+	template<typename Scalar> using OrientationFilter = MadgwickAHRST<Scalar>;
+	#endif
+
+	/**
+	* @brief Loads the accel/gyro process and measurement noise used by the pre-smoother
+	*/
+	template<typename Real>
+	void initNoiseModels(IMU::SystemModel<Real>& sys, IMU::MeasurementModel<Real>& om)
+	{
+		const Real accelUncertainty = Real(0.8f);
+		const Real gyroUncertainty = Real(1.05f);
+
+		Eigen::Matrix<Real, 6, 6> R;
+		Eigen::Matrix<Real, 6, 6> processNoise;
+
+		R.setZero();
+		processNoise.setZero();
+
+		Real cnst = Real(5.00e-4f);
+		Real dnst = Real(3.33e-4f);
+		Real enst = Real(5.00e-4f);
+
+		processNoise.diagonal() << cnst, dnst, enst, cnst, dnst, enst;
+		sys.setCovariance(processNoise);
+
+		R(0, 0) = accelUncertainty * accelUncertainty;
+		R(1, 1) = accelUncertainty * accelUncertainty;
+		R(2, 2) = accelUncertainty * accelUncertainty;
+		R(3, 3) = gyroUncertainty * gyroUncertainty;
+		R(4, 4) = gyroUncertainty * gyroUncertainty;
+		R(5, 5) = gyroUncertainty * gyroUncertainty;
+
+		om.setCovariance(R);
+	}
+
+	/*----------------------------------
+	* Orientation Filter Setup
+	*----------------------------------*/
+	/* Gains the chain runs each orientation filter with. The accelerometer gets about the same
+	* pull in all three, as much as it takes to hold the tilt against the ~14 dps gyro bias in
+	* ahrs_recorded_output.csv. host/orientation_bench.cpp scores them. */
+	const float madgwickBeta = 10.0f;
+	const float mahonyKp = 10.0f;
+	const float mahonyKi = 0.0f;			/* Needs far longer than the recorded log to learn a bias, and adds heading error meanwhile */
+	const float complementaryAccelGain = 10.0f;
+	const float complementaryMagGain = 0.5f;
+
+	/**
+	* @brief How FilterChainT builds and steps each orientation filter
+	*
+	* create() returns the filter with the chain's gains. fixedRateSteps is how many updates
+	* the fixed rate path gives every sample: one gradient step per update is all the Madgwick
+	* filter corrects, so it needs several, while the others correct fully in one.
+	*/
+	template<class Filter>
+	struct OrientationSetup;
+
+	template<typename Scalar>
+	struct OrientationSetup<MadgwickAHRST<Scalar> >
+	{
+		static const uint32_t fixedRateSteps = AHRS_UPDATE_RATE_MULTIPLIER;
+		static MadgwickAHRST<Scalar> create() { return MadgwickAHRST<Scalar>(madgwickBeta); }
+	};
+
+	template<typename Scalar>
+	struct OrientationSetup<MahonyAHRST<Scalar> >
+	{
+		static const uint32_t fixedRateSteps = 1;
+		static MahonyAHRST<Scalar> create() { return MahonyAHRST<Scalar>(mahonyKp, mahonyKi); }
+	};
+
+	template<typename Scalar>
+	struct OrientationSetup<ComplementaryAHRST<Scalar> >
+	{
+		static const uint32_t fixedRateSteps = 1;
+		static ComplementaryAHRST<Scalar> create() { return ComplementaryAHRST<Scalar>(complementaryAccelGain, complementaryMagGain); }
+	};
+
+	/**
+	* @brief Hardware independent portion of the AHRS algorithm
+	*
+	* Holds the Kalman pre-smoother and the orientation filter that run on every new IMU
+	* sample. Nothing in here touches the RTOS or the MCU peripherals, so the exact same
+	* per-sample work can be replayed from a log on a host machine.
+	*
+	* @tparam Smoother  Kalman filter used to smooth the accel/gyro data. Either the generic
+	*					Kalman::SquareRootUnscentedKalmanFilter, the same algorithm with its scratch
+	*					in a workspace (IMU::WorkspaceSquareRootUKF) or the closed form
+	*					IMU::IdentityKalmanFilter. The two SR-UKFs match, the closed form only
+	*					matches them once converged (see IdentityKalmanFilter).
+	* @tparam Real      Scalar for the smoother, the inputs and the output. float in the firmware,
+	*					double for host reference runs.
+	* @tparam Attitude  Scalar for the orientation stage. Real, or a Fixed point type.
+	* @tparam Orientation  Orientation filter: MadgwickAHRST, MahonyAHRST or ComplementaryAHRST
+	*/
+	template<template<class> class Smoother, typename Real = T, typename Attitude = Real,
+		template<class> class Orientation = MadgwickAHRST>
+	class FilterChainT
+	{
+	public:
+		typedef Eigen::Matrix<Real, 3, 1> Vector3;
+		typedef AHRSDataT<Real> Output;
+
+		FilterChainT();
+
+		/**
+		* @brief Runs one IMU sample through the smoother -> orientation chain
+		*
+		* @param [in]  accel_raw   Accelerometer reading (m/s^2), in the filter frame as a sensor source delivers it
+		* @param [in]  gyro_raw    Gyroscope reading (dps), same frame
+		* @param [in]  mag_raw     Magnetometer reading, same frame
+		* @param [out] output      Filtered data and attitude for this sample
+		*/
+		void step(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw, Output& output);
+
+		/**
+		* @brief Runs one IMU sample through the chain using the measured time since the last sample
+		*
+		* The smoother process noise is scaled to dt, and the orientation filter integrates exactly
+		* dt in as few steps as possible: one for an on-time sample, more if dt is longer than
+		* 1/AHRS_MAX_STEP_HZ (task ran late, samples were missed).
+		*
+		* @param [in]  dt          Time since the previous sample (s)
+		*/
+		void step(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw, Real dt, Output& output);
+
+		/**
+		* @brief Cycles spent in the smoother (predict + update) during the last call to step()
+		*/
+		uint32_t smootherCycles() const { return lastSmootherCycles; }
+
+		/**
+		* @brief Cycles spent in the orientation updates during the last call to step()
+		*/
+		uint32_t orientationCycles() const { return lastOrientationCycles; }
+
+		/**
+		* @brief Orientation updates run during the last call to step()
+		*/
+		uint32_t orientationSteps() const { return lastOrientationSteps; }
+
+	private:
+		typedef IMU::State<Real> StateT;
+		typedef IMU::SystemModel<Real> SystemModelT;
+		typedef IMU::MeasurementModel<Real> MeasurementModelT;
+		typedef IMU::Measurement<Real> MeasurementT;
+
+		/* UKF */
+		StateT x_ukf;
+		SystemModelT sys;
+		MeasurementModelT om;
+		MeasurementT meas;
+		Smoother<StateT> ukf;
+		Eigen::Matrix<Real, 6, 6> processNoise;	/* Per nominal sample period */
+		Real processNoiseDt;					/* Period the system model covariance is currently scaled to */
+
+		/* Orientation */
+		Orientation<Attitude> ahrs;
+
+		Vector3 accel_filtered, gyro_filtered;
+
+		uint32_t lastSmootherCycles;
+		uint32_t lastOrientationCycles;
+		uint32_t lastOrientationSteps;
+
+		/* Nominal sample period. Both the process noise and the fixed rate path assume it. */
+		static Real nominalDt() { return Real(1) / Real(AHRS_SAMPLE_RATE_HZ); }
+
+		void smooth(const Vector3& accel_raw, const Vector3& gyro_raw);
+		void orient(const Vector3& mag_raw, Real dt, uint32_t steps, Output& output);
+	};
+
+
+	/*----------------------------------
+	* FilterChainT
+	*----------------------------------*/
+	/* Kept in the header so host tools can build any Real/Attitude/Orientation combination.
+	* The firmware's variants are instantiated once, in ahrsFilter.cpp. */
+	template<template<class> class Smoother, typename Real, typename Attitude, template<class> class Orientation>
+	FilterChainT<Smoother, Real, Attitude, Orientation>::FilterChainT() :
+		ukf(Real(0.5f), Real(3.0f), Real(0.0f)),
+		ahrs(OrientationSetup<Orientation<Attitude> >::create())
+	{
+		/*----------------------------------
+		* Initialize the UKF
+		*----------------------------------*/
+		StateT x;
+		x.setZero();
+
+		initNoiseModels(sys, om);
+		ukf.init(x);
+
+		processNoise = sys.getCovariance();
+		processNoiseDt = nominalDt();
+
+		accel_filtered.setZero();
+		gyro_filtered.setZero();
+
+		lastSmootherCycles = 0;
+		lastOrientationCycles = 0;
+		lastOrientationSteps = 0;
+	}
+
+	template<template<class> class Smoother, typename Real, typename Attitude, template<class> class Orientation>
+	void FilterChainT<Smoother, Real, Attitude, Orientation>::step(const Vector3& accel_raw, const Vector3& gyro_raw,
+		const Vector3& mag_raw, Output& output)
+	{
+		smooth(accel_raw, gyro_raw);
+
+		/* The Madgwick filter needs to run between 3-5 times as fast IMU measurements
+		* to achieve decent convergence to a stable value. This only runs when new data
+		* has arrived from the IMU, so frequency multiplication is as simple as looping
+		* 3-5 times here. The other filters get one step. */
+		orient(mag_raw, nominalDt(), OrientationSetup<Orientation<Attitude> >::fixedRateSteps, output);
+	}
+
+	template<template<class> class Smoother, typename Real, typename Attitude, template<class> class Orientation>
+	void FilterChainT<Smoother, Real, Attitude, Orientation>::step(const Vector3& accel_raw, const Vector3& gyro_raw,
+		const Vector3& mag_raw, Real dt, Output& output)
+	{
+		/* Two readings of the same sample (e.g. a data ready timeout) carry no new time */
+		if (dt <= Real(0))
+			dt = nominalDt();
+
+		/* The smoother state is a random walk, so its process noise grows linearly with time.
+		* Only re-scale on a real change in period, since the SR-UKF refactors the covariance. */
+		const Real change = dt - processNoiseDt;
+		const Real tolerance = Real(0.05f) * nominalDt();
+		if ((change > tolerance) || (change < -tolerance))
+		{
+			sys.setCovariance(processNoise * (dt / nominalDt()));
+			processNoiseDt = dt;
+		}
+
+		smooth(accel_raw, gyro_raw);
+
+		/* One step per on-time sample. A late sample gets split so no single step is
+		* longer than 1/AHRS_MAX_STEP_HZ. */
+		uint32_t steps = (uint32_t)(dt * AHRS_MAX_STEP_HZ + Real(0.5f));
+		if (steps < 1)
+			steps = 1;
+		else if (steps > AHRS_MAX_SUBSTEPS)
+			steps = AHRS_MAX_SUBSTEPS;
+
+		orient(mag_raw, dt, steps, output);
+	}
+
+	template<template<class> class Smoother, typename Real, typename Attitude, template<class> class Orientation>
+	void FilterChainT<Smoother, Real, Attitude, Orientation>::smooth(const Vector3& accel_raw, const Vector3& gyro_raw)
+	{
+		/*----------------------------
+		* UKF Algorithm
+		*---------------------------*/
+		uint32_t start = SOAR_PROFILE::cycleCount();
+
+		//Predict state for current time step. The system model is an identity,
+		//so there is no need to simulate it beforehand.
+		TRACE_BEGIN(TRACE_SMOOTHER_PREDICT);
+		x_ukf = ukf.predict(sys);
+		TRACE_END(TRACE_SMOOTHER_PREDICT);
+
+		//Take a measurement given system state
+		meas << accel_raw, gyro_raw;
+
+		//Update the state equation given measurement
+		TRACE_BEGIN(TRACE_SMOOTHER_UPDATE);
+		x_ukf = ukf.update(om, meas);
+		TRACE_END(TRACE_SMOOTHER_UPDATE);
+
+		lastSmootherCycles = SOAR_PROFILE::cycleCount() - start;
+
+		accel_filtered << x_ukf.ax(), x_ukf.ay(), x_ukf.az();
+		gyro_filtered << x_ukf.gx(), x_ukf.gy(), x_ukf.gz();
+	}
+
+	template<template<class> class Smoother, typename Real, typename Attitude, template<class> class Orientation>
+	void FilterChainT<Smoother, Real, Attitude, Orientation>::orient(const Vector3& mag_raw, Real dt, uint32_t steps, Output& output)
+	{
+		/*----------------------------
+		* AHRS Algorithm
+		*---------------------------*/
+		const Real stepDt = dt / steps;
+		uint32_t start = SOAR_PROFILE::cycleCount();
+
+		TRACE_BEGIN(TRACE_ORIENTATION);
+		for (uint32_t i = 0; i < steps; i++)
+			ahrs.update(accel_filtered, gyro_filtered, mag_raw, stepDt);
+		TRACE_END(TRACE_ORIENTATION);
+
+		lastOrientationCycles = SOAR_PROFILE::cycleCount() - start;
+		lastOrientationSteps = steps;
+
+		/* The quaternion goes out as it is. Euler angles are left to whoever prints them. */
+		TRACE_BEGIN(TRACE_OUTPUT);
+		output(ahrs.template quaternion<Real>(), accel_filtered, gyro_filtered, mag_raw);
+		TRACE_END(TRACE_OUTPUT);
+	}
+
+	/*----------------------------------
+	* Error-State EKF Setup
+	*----------------------------------*/
+	/* Noise the error-state pipeline runs with. The initial bias covers the ~14 dps in
+	* ahrs_recorded_output.csv; host/pipeline_bench.cpp scores the rest. */
+	const float eskfGyroNoise_dps = 1.05f;			/* Same as the smoother's gyro measurement noise */
+	const float eskfGyroBiasWalk_dps = 0.05f;
+	const float eskfAccelNoise = 0.1f;
+	const float eskfHeadingNoise_deg = 5.0f;
+	const float eskfInitialTilt_deg = 5.0f;
+	const float eskfInitialBias_dps = 20.0f;
+
+	/**
+	* @brief Alternative to FilterChainT: one error-state EKF on the raw readings
+	*
+	* The same interface as FilterChainT, so ahrs.cpp and the host tools run either. Attitude
+	* and gyro bias come out of a single filter (ErrorStateEKF) instead of a smoother and an
+	* orientation filter each working on part of the problem, so there is nothing to step
+	* several times per sample and the bias is estimated rather than left for the orientation
+	* filter's feedback to fight.
+	*
+	* The output accel is the raw reading and the output gyro has the estimated bias taken
+	* off. Neither is smoothed.
+	*
+	* @tparam Real  float in the firmware, double for host reference runs
+	*/
+	template<typename Real = T>
+	class ErrorStateChainT
+	{
+	public:
+		typedef Eigen::Matrix<Real, 3, 1> Vector3;
+		typedef AHRSDataT<Real> Output;
+
+		ErrorStateChainT();
+
+		/**
+		* @brief Runs one IMU sample through the filter, assuming 1/AHRS_SAMPLE_RATE_HZ since the last
+		*
+		* @param [in]  accel_raw   Accelerometer reading (m/s^2), in the filter frame
+		* @param [in]  gyro_raw    Gyroscope reading (dps), same frame
+		* @param [in]  mag_raw     Magnetometer reading, same frame. Only fused when it changes.
+		* @param [out] output      Attitude and bias corrected data for this sample
+		*/
+		void step(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw, Output& output);
+
+		/**
+		* @brief Runs one IMU sample through the filter using the measured time since the last sample
+		*
+		* A dt covering several sample periods (the task ran late, samples were missed) is
+		* predicted one period at a time, up to AHRS_MAX_SUBSTEPS.
+		*
+		* @param [in]  dt          Time since the previous sample (s)
+		*/
+		void step(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw, Real dt, Output& output);
+
+		/* There is no separate smoother, so everything is counted as orientation */
+		uint32_t smootherCycles() const { return 0; }
+		uint32_t orientationCycles() const { return lastCycles; }
+
+		/**
+		* @brief Predict steps run during the last call to step()
+		*/
+		uint32_t orientationSteps() const { return lastSteps; }
+
+		/* Gyro bias estimate (dps) */
+		Vector3 gyroBiasDps() const { return ekf.gyroBiasDps(); }
+
+	private:
+		ErrorStateEKF<Real> ekf;
+		Vector3 gyro_corrected;
+
+		uint32_t lastCycles;
+		uint32_t lastSteps;
+
+		static Real nominalDt() { return Real(1) / Real(AHRS_SAMPLE_RATE_HZ); }
+		static ErrorStateNoise noise();
+
+		void run(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw, Real dt, uint32_t steps, Output& output);
+	};
+
+
+	/*----------------------------------
+	* ErrorStateChainT
+	*----------------------------------*/
+	template<typename Real>
+	ErrorStateChainT<Real>::ErrorStateChainT() : ekf(noise())
+	{
+		gyro_corrected.setZero();
+		lastCycles = 0;
+		lastSteps = 0;
+	}
+
+	template<typename Real>
+	ErrorStateNoise ErrorStateChainT<Real>::noise()
+	{
+		ErrorStateNoise n;
+		n.gyro_dps = eskfGyroNoise_dps;
+		n.gyroBiasWalk_dps = eskfGyroBiasWalk_dps;
+		n.accel = eskfAccelNoise;
+		n.heading_deg = eskfHeadingNoise_deg;
+		n.initialTilt_deg = eskfInitialTilt_deg;
+		n.initialBias_dps = eskfInitialBias_dps;
+		return n;
+	}
+
+	template<typename Real>
+	void ErrorStateChainT<Real>::step(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw, Output& output)
+	{
+		/* The filter corrects fully on every sample, so there is no rate multiplier */
+		run(accel_raw, gyro_raw, mag_raw, nominalDt(), 1, output);
+	}
+
+	template<typename Real>
+	void ErrorStateChainT<Real>::step(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw,
+		Real dt, Output& output)
+	{
+		if (dt <= Real(0))
+			dt = nominalDt();
+
+		/* One predict per sample period, so a late sample is integrated in on-time steps */
+		uint32_t steps = (uint32_t)(dt / nominalDt() + Real(0.5f));
+		if (steps < 1)
+			steps = 1;
+		else if (steps > AHRS_MAX_SUBSTEPS)
+			steps = AHRS_MAX_SUBSTEPS;
+
+		run(accel_raw, gyro_raw, mag_raw, dt, steps, output);
+	}
+
+	template<typename Real>
+	void ErrorStateChainT<Real>::run(const Vector3& accel_raw, const Vector3& gyro_raw, const Vector3& mag_raw,
+		Real dt, uint32_t steps, Output& output)
+	{
+		/*----------------------------
+		* Error-State EKF
+		*---------------------------*/
+		const Real stepDt = dt / steps;
+		uint32_t start = SOAR_PROFILE::cycleCount();
+
+		TRACE_BEGIN(TRACE_SMOOTHER_PREDICT);
+		for (uint32_t i = 0; i < steps; i++)
+			ekf.predict(gyro_raw, stepDt);
+		TRACE_END(TRACE_SMOOTHER_PREDICT);
+
+		TRACE_BEGIN(TRACE_SMOOTHER_UPDATE);
+		ekf.update(accel_raw, mag_raw);
+		TRACE_END(TRACE_SMOOTHER_UPDATE);
+
+		lastCycles = SOAR_PROFILE::cycleCount() - start;
+		lastSteps = steps;
+
+		TRACE_BEGIN(TRACE_OUTPUT);
+		gyro_corrected = gyro_raw - ekf.gyroBiasDps();
+		output(ekf.quaternion(), accel_raw, gyro_corrected, mag_raw);
+		TRACE_END(TRACE_OUTPUT);
+	}
+
+	/* The firmware variants are instantiated once in ahrsFilter.cpp */
+	extern template class FilterChainT<Kalman::SquareRootUnscentedKalmanFilter, T, AttitudeScalar, OrientationFilter>;
+	extern template class FilterChainT<IMU::WorkspaceSquareRootUKF, T, AttitudeScalar, OrientationFilter>;
+	extern template class FilterChainT<IMU::IdentityKalmanFilter, T, AttitudeScalar, OrientationFilter>;
+
+	extern template class ErrorStateChainT<T>;
+
+	#if (AHRS_PIPELINE == AHRS_PIPELINE_ESKF)
+	typedef ErrorStateChainT<T> FilterChain;
+	#elif (AHRS_CLOSED_FORM_SMOOTHER)
+	typedef FilterChainT<IMU::IdentityKalmanFilter, T, AttitudeScalar, OrientationFilter> FilterChain;
+	#elif (AHRS_UKF_WORKSPACE)
+	typedef FilterChainT<IMU::WorkspaceSquareRootUKF, T, AttitudeScalar, OrientationFilter> FilterChain;
+	#else
+	typedef FilterChainT<Kalman::SquareRootUnscentedKalmanFilter, T, AttitudeScalar, OrientationFilter> FilterChain;
+	#endif
+}
+
+#endif
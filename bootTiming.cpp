@@ -0,0 +1,45 @@
+#include "bootTiming.hpp"
+#include "cycleCounter.hpp"
+
+namespace SOAR_PROFILE
+{
+	/* Written by whichever task reaches a milestone first, read by the serial task */
+	static volatile uint32_t milestoneCycles[BOOT_MILESTONE_COUNT];
+	static volatile bool reached[BOOT_MILESTONE_COUNT];
+	static volatile uint8_t calibrationStatus = CAL_STATUS_NONE;
+
+	void bootMark(BootMilestone milestone)
+	{
+		if (reached[milestone])
+			return;
+
+		milestoneCycles[milestone] = cycleCount();
+		reached[milestone] = true;
+	}
+
+	void bootSetCalibration(uint8_t status)
+	{
+		calibrationStatus = status;
+	}
+
+	static uint32_t elapsed_uS(BootMilestone milestone)
+	{
+		if (!reached[milestone])
+			return 0;
+
+		return (uint32_t)(cyclesToSeconds(milestoneCycles[BOOT_MAIN], milestoneCycles[milestone]) * 1.0e6f);
+	}
+
+	bool bootTiming(BootTiming_t& timing)
+	{
+		if (!reached[BOOT_FIRST_OUTPUT])
+			return false;
+
+		timing.scheduler_uS = elapsed_uS(BOOT_SCHEDULER);
+		timing.imuReady_uS = elapsed_uS(BOOT_IMU_READY);
+		timing.tasksResumed_uS = elapsed_uS(BOOT_TASKS_RESUMED);
+		timing.firstOutput_uS = elapsed_uS(BOOT_FIRST_OUTPUT);
+		timing.calibration = calibrationStatus;
+		return true;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef SOAR_BOOT_TIMING_HPP
+#define SOAR_BOOT_TIMING_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/* Project Includes */
+#include "dataTypes.hpp"
+
+namespace SOAR_PROFILE
+{
+	/* Points on the way from reset to the first AHRS sample, in the order they happen */
+	enum BootMilestone
+	{
+		BOOT_MAIN,					/* Clocks set up, cycle counter started. Time zero. */
+		BOOT_SCHEDULER,				/* Init task running */
+		BOOT_IMU_READY,				/* IMU up and calibrated, or its calibration loaded */
+		BOOT_TASKS_RESUMED,			/* Init task released every task */
+		BOOT_FIRST_OUTPUT,			/* First AHRS sample published */
+		BOOT_MILESTONE_COUNT
+	};
+
+	/**
+	* @brief Stamps a milestone with the cycle counter. Only the first call for each one counts,
+	* so it is cheap enough to leave in a loop.
+	*
+	* The counter cannot run before the clocks are set up, so HAL_Init() and ThorInit() are
+	* not included. They take the same time on every boot.
+	*/
+	extern void bootMark(BootMilestone milestone);
+
+	/* Records how the AHRS got its sensor calibration, a CalibrationStatus */
+	extern void bootSetCalibration(uint8_t status);
+
+	/**
+	* @brief The boot timeline, once the first AHRS sample is out
+	* @returns false until then
+	*/
+	extern bool bootTiming(BootTiming_t& timing);
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include "calibrationStore.hpp"
+
+/* C/C++ Includes */
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#if (CAL_STORE_FILE)
+#include <stdio.h>
+#include <stdlib.h>
+#else
+/* HAL Includes */
+#include "stm32f4xx_hal.h"
+#endif
+
+namespace SOAR_AHRS
+{
+	static const uint32_t CALIBRATION_MAGIC = 0x4C414353;	/* "SCAL" */
+
+	static_assert((sizeof(CalibrationRecord) % 4) == 0, "Flash is programmed a word at a time");
+
+	uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc)
+	{
+		crc = ~crc;
+		for (size_t i = 0; i < length; i++)
+		{
+			crc ^= data[i];
+			for (int bit = 0; bit < 8; bit++)
+				crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1u)));
+		}
+		return ~crc;
+	}
+
+	static bool valid(const CalibrationRecord& record)
+	{
+		return (record.magic == CALIBRATION_MAGIC) &&
+			(record.version == CALIBRATION_VERSION) &&
+			(record.size == sizeof(CalibrationRecord)) &&
+			(record.crc == crc32((const uint8_t*)&record, offsetof(CalibrationRecord, crc)));
+	}
+
+
+	/*----------------------------------
+	* Backends
+	*----------------------------------*/
+	#if (CAL_STORE_FILE)
+	static const char* storePath()
+	{
+		const char* path = getenv("SOAR_SIM_CAL");
+		return path ? path : "soar_calibration.bin";
+	}
+
+	static bool readBackend(CalibrationRecord& record)
+	{
+		FILE* file = fopen(storePath(), "rb");
+		if (!file)
+			return false;
+
+		bool ok = (fread(&record, sizeof(record), 1, file) == 1) && valid(record);
+		fclose(file);
+		return ok;
+	}
+
+	static bool writeBackend(const CalibrationRecord& record)
+	{
+		FILE* file = fopen(storePath(), "wb");
+		if (!file)
+			return false;
+
+		bool ok = (fwrite(&record, sizeof(record), 1, file) == 1);
+		return (fclose(file) == 0) && ok;
+	}
+
+	/* A file never fills up */
+	static void reserveBackend(const CalibrationRecord* /* newest */)
+	{
+	}
+	#else
+	/* The sector is a log of records, one slot each. Erased flash reads 0xFF. */
+	static const uint32_t slotSize = sizeof(CalibrationRecord);
+	static const uint32_t slotCount = CAL_STORE_FLASH_SIZE / slotSize;
+
+	static const CalibrationRecord* slot(uint32_t index)
+	{
+		return (const CalibrationRecord*)(CAL_STORE_FLASH_ADDRESS + index * slotSize);
+	}
+
+	static bool blank(uint32_t index)
+	{
+		const uint32_t* words = (const uint32_t*)slot(index);
+		for (uint32_t i = 0; i < slotSize / 4; i++)
+			if (words[i] != 0xFFFFFFFF)
+				return false;
+		return true;
+	}
+
+	/* First slot that has never been written, slotCount if the sector is full */
+	static uint32_t nextFreeSlot()
+	{
+		uint32_t index = 0;
+		while ((index < slotCount) && !blank(index))
+			index++;
+		return index;
+	}
+
+	static bool readBackend(CalibrationRecord& record)
+	{
+		/* Newest first. A record cut short by a reset fails its CRC and the one before it is used. */
+		for (uint32_t index = nextFreeSlot(); index > 0; index--)
+		{
+			if (valid(*slot(index - 1)))
+			{
+				memcpy(&record, slot(index - 1), sizeof(record));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void unlockFlash()
+	{
+		HAL_FLASH_Unlock();
+		__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+			FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+	}
+
+	/* Flash must be unlocked */
+	static bool program(uint32_t index, const CalibrationRecord& record)
+	{
+		bool ok = true;
+
+		const uint32_t* words = (const uint32_t*)&record;
+		const uint32_t address = CAL_STORE_FLASH_ADDRESS + index * slotSize;
+		for (uint32_t i = 0; ok && (i < slotSize / 4); i++)
+			ok = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + 4 * i, words[i]) == HAL_OK);
+
+		return ok && valid(*slot(index));
+	}
+
+	/* Appends only. A full sector waits for the next boot's reserveBackend(). */
+	static bool writeBackend(const CalibrationRecord& record)
+	{
+		const uint32_t index = nextFreeSlot();
+		if (index == slotCount)
+			return false;
+
+		unlockFlash();
+		const bool ok = program(index, record);
+		HAL_FLASH_Lock();
+		return ok;
+	}
+
+	/* Boot only: erases a nearly full sector and writes the newest record back to slot 0 */
+	static void reserveBackend(const CalibrationRecord* newest)
+	{
+		if ((slotCount - nextFreeSlot()) >= CAL_STORE_RESERVE_SLOTS)
+			return;
+
+		unlockFlash();
+
+		FLASH_EraseInitTypeDef erase;
+		erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+		erase.Sector = CAL_STORE_FLASH_SECTOR;
+		erase.NbSectors = 1;
+		erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+		uint32_t sectorError = 0;
+		if ((HAL_FLASHEx_Erase(&erase, &sectorError) == HAL_OK) && newest)
+			program(0, *newest);
+
+		HAL_FLASH_Lock();
+	}
+	#endif
+
+
+	/*----------------------------------
+	* Store
+	*----------------------------------*/
+	CalibrationStore::CalibrationStore() :
+		state(CAL_STATUS_NONE),
+		saveCount(0),
+		savePending(false)
+	{
+		clear();
+	}
+
+	void CalibrationStore::clear()
+	{
+		memset(&data, 0, sizeof(data));
+	}
+
+	bool CalibrationStore::load()
+	{
+		const bool found = readBackend(data);
+		if (!found)
+			clear();
+
+		reserveBackend(found ? &data : NULL);
+		return found;
+	}
+
+	void CalibrationStore::seal(CalibrationRecord& record)
+	{
+		record.magic = CALIBRATION_MAGIC;
+		record.version = CALIBRATION_VERSION;
+		record.size = sizeof(CalibrationRecord);
+		record.crc = crc32((const uint8_t*)&record, offsetof(CalibrationRecord, crc));
+	}
+
+	bool CalibrationStore::save()
+	{
+		seal(data);
+
+		if (!writeBackend(data))
+			return false;
+
+		saveCount++;
+		return true;
+	}
+
+	bool CalibrationStore::requestSave()
+	{
+		if (savePending.load(std::memory_order_acquire))
+			return false;
+
+		pending = data;
+		seal(pending);
+		savePending.store(true, std::memory_order_release);
+		return true;
+	}
+
+	bool CalibrationStore::service()
+	{
+		if (!savePending.load(std::memory_order_acquire))
+			return false;
+
+		if (writeBackend(pending))
+			saveCount++;
+
+		savePending.store(false, std::memory_order_release);
+		return true;
+	}
+
+	bool CalibrationStore::inertialUsable(float temperature_C)
+	{
+		if (!(data.flags & CAL_HAS_INERTIAL))
+			state = CAL_STATUS_MISSING;
+		else if (fabsf(temperature_C - data.temperature_C) > CAL_STORE_MAX_TEMP_DELTA_C)
+			state = CAL_STATUS_STALE;
+		else
+			state = CAL_STATUS_LOADED;
+
+		return (state == CAL_STATUS_LOADED);
+	}
+
+	void CalibrationStore::setInertial(const float gyroBias[3], const float accelBias[3], float temperature_C)
+	{
+		memcpy(data.gyroBias, gyroBias, sizeof(data.gyroBias));
+		memcpy(data.accelBias, accelBias, sizeof(data.accelBias));
+		data.temperature_C = temperature_C;
+		data.flags |= CAL_HAS_INERTIAL;
+	}
+
+	bool CalibrationStore::magCorrection(Eigen::Vector3f& hardIron, Eigen::Matrix3f& softIron) const
+	{
+		if (!(data.flags & CAL_HAS_MAG))
+			return false;
+
+		hardIron = Eigen::Map<const Eigen::Vector3f>(data.magHardIron);
+		softIron = Eigen::Map<const Eigen::Matrix3f>(data.magSoftIron);
+		return true;
+	}
+
+	bool CalibrationStore::magDiffers(const Eigen::Vector3f& hardIron) const
+	{
+		if (!(data.flags & CAL_HAS_MAG))
+			return true;
+
+		return (hardIron - Eigen::Map<const Eigen::Vector3f>(data.magHardIron)).cwiseAbs().maxCoeff() > CAL_STORE_MAG_TOLERANCE_G;
+	}
+
+	void CalibrationStore::setMagCorrection(const Eigen::Vector3f& hardIron, const Eigen::Matrix3f& softIron)
+	{
+		Eigen::Map<Eigen::Vector3f>(data.magHardIron) = hardIron;
+		Eigen::Map<Eigen::Matrix3f>(data.magSoftIron) = softIron;
+		data.flags |= CAL_HAS_MAG;
+	}
+
+	bool CalibrationStore::magOffset(int16_t offset[3]) const
+	{
+		if (!(data.flags & CAL_HAS_MAG_OFFSET))
+			return false;
+
+		memcpy(offset, data.magOffset, sizeof(data.magOffset));
+		return true;
+	}
+
+	void CalibrationStore::setMagOffset(const int16_t offset[3])
+	{
+		memcpy(data.magOffset, offset, sizeof(data.magOffset));
+		data.flags |= CAL_HAS_MAG_OFFSET;
+	}
+}
@@ -0,0 +1,154 @@
+#pragma once
+#ifndef SOAR_CALIBRATION_STORE_HPP
+#define SOAR_CALIBRATION_STORE_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+/* Project Includes */
+#include "config.hpp"
+#include "dataTypes.hpp"
+
+namespace SOAR_AHRS
+{
+	/* Bumped whenever CalibrationRecord changes, so older records read back as missing */
+	const uint16_t CALIBRATION_VERSION = 2;
+
+	enum CalibrationFlags
+	{
+		CAL_HAS_INERTIAL = (1 << 0),
+		CAL_HAS_MAG = (1 << 1),
+		CAL_HAS_MAG_OFFSET = (1 << 2)
+	};
+
+	/**
+	* @brief Everything the store keeps, exactly as it is laid out in flash or in the file
+	*/
+	struct CalibrationRecord
+	{
+		uint32_t magic;
+		uint16_t version;			/* CALIBRATION_VERSION */
+		uint16_t size;				/* sizeof(CalibrationRecord) */
+		uint32_t flags;				/* CalibrationFlags */
+
+		float gyroBias[3];			/* Sensor frame, same units as the driver's gRaw (dps) */
+		float accelBias[3];			/* Sensor frame, same units as the driver's aRaw */
+		float temperature_C;		/* Die temperature the biases were measured at */
+
+		float magHardIron[3];		/* MagCalibrator correction, filter frame (gauss) */
+		float magSoftIron[9];		/* Column major */
+
+		int16_t magOffset[3];		/* LSM9DS1 OFFSET_X/Y/Z_REG_M from calibrateMag(), when MAG_CAL_ONLINE is off */
+		int16_t reserved;
+
+		uint32_t crc;				/* CRC-32 over every byte before it */
+	};
+
+	/**
+	* @brief Sensor calibration that survives a reset
+	*
+	* Holds one CalibrationRecord in RAM. load() reads it back from the backend, which is a
+	* reserved flash sector on the board (CAL_STORE_FLASH_SECTOR) and a file in host builds
+	* (CAL_STORE_FILE, path in SOAR_SIM_CAL). A record with the wrong magic, version, size
+	* or CRC reads as missing.
+	*
+	* In flash, records are appended one after another and the last valid one wins. The
+	* erase, which stalls the core for one to two seconds, only happens in load(): when fewer
+	* than CAL_STORE_RESERVE_SLOTS are left the sector is wiped and the newest record carried
+	* over, so saves after boot only ever append. An append is still a few hundred uS with
+	* instruction fetches stalled, so while running the AHRS task only queues it with
+	* requestSave() and calibrationTask writes it.
+	*/
+	class CalibrationStore
+	{
+	public:
+		CalibrationStore();
+
+		/**
+		* @brief Reads the newest record from the backend, and makes room for the saves of
+		* this run if the backend is close to full
+		* @returns false if there is none, in which case the store starts out empty
+		*/
+		bool load();
+
+		/**
+		* @brief Seals the record (magic, version, size, CRC) and writes it to the backend
+		*/
+		bool save();
+
+		/**
+		* @brief Seals a copy of the record for service() to write, so the caller never waits
+		* on the backend
+		* @returns false if the last one has not been written yet
+		*/
+		bool requestSave();
+
+		/**
+		* @brief Writes the copy queued by requestSave(), if there is one. Safe to call from one
+		* other task.
+		* @returns true if it wrote one
+		*/
+		bool service();
+
+		/**
+		* @brief Decides whether the stored gyro/accel biases can be used as they are
+		*
+		* They can if there are any and they were measured within CAL_STORE_MAX_TEMP_DELTA_C
+		* of the current die temperature. Sets status() to match.
+		*
+		* @returns true to use gyroBias()/accelBias(), false if the sensor needs calibrating
+		*/
+		bool inertialUsable(float temperature_C);
+
+		void setInertial(const float gyroBias[3], const float accelBias[3], float temperature_C);
+
+		const float* gyroBias() const { return data.gyroBias; }
+		const float* accelBias() const { return data.accelBias; }
+
+		/**
+		* @brief Stored magnetometer correction, for MagCalibrator::setCorrection()
+		* @returns false if there is none
+		*/
+		bool magCorrection(Eigen::Vector3f& hardIron, Eigen::Matrix3f& softIron) const;
+
+		/* True if there is no stored mag correction or its hard iron is more than CAL_STORE_MAG_TOLERANCE_G off */
+		bool magDiffers(const Eigen::Vector3f& hardIron) const;
+
+		void setMagCorrection(const Eigen::Vector3f& hardIron, const Eigen::Matrix3f& softIron);
+
+		/**
+		* @brief Stored magnetometer offset registers, for LSM9DS1::magOffset()
+		* @returns false if there are none
+		*/
+		bool magOffset(int16_t offset[3]) const;
+
+		void setMagOffset(const int16_t offset[3]);
+
+		CalibrationStatus status() const { return state; }
+		uint32_t saves() const { return saveCount; }
+
+	private:
+		CalibrationRecord data;
+		CalibrationStatus state;
+		uint32_t saveCount;
+
+		/* requestSave() owns pending while this is false, service() while it is true */
+		CalibrationRecord pending;
+		std::atomic<bool> savePending;
+
+		void clear();
+		void seal(CalibrationRecord& record);
+	};
+
+	/**
+	* @brief CRC-32 (IEEE 802.3, reflected, as zlib)
+	*/
+	extern uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+}
+
+#endif
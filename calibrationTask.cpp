@@ -0,0 +1,65 @@
+#include "calibrationTask.hpp"
+
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Project Includes */
+#include "config.hpp"
+#include "threading.hpp"
+
+namespace SOAR_AHRS
+{
+	/* Set during initialization, before any task is resumed */
+	static MagCalibrator* servedMagCal = NULL;
+	static CalibrationStore* servedStore = NULL;
+
+	void calibrationServe(MagCalibrator& magCal)
+	{
+		servedMagCal = &magCal;
+	}
+
+	void calibrationServe(CalibrationStore& store)
+	{
+		servedStore = &store;
+	}
+
+	void calibrationTask(void* argument)
+	{
+		#ifdef DEBUG
+		volatile UBaseType_t stackHighWaterMark_CAL = 0;
+		volatile uint32_t magSolves = 0;
+		volatile uint32_t storeWrites = 0;
+		#endif
+
+		/* Tell init task that this thread's initialization is done and ok to run.
+		* Wait for init task to resume operation. */
+		xTaskSendMessage(INIT_TASK, 1u);
+		vTaskSuspend(NULL);
+		taskYIELD();
+
+		TickType_t lastTimeWoken = xTaskGetTickCount();
+		for (;;)
+		{
+			if (servedMagCal && servedMagCal->service())
+			{
+				#ifdef DEBUG
+				magSolves++;
+				#endif
+			}
+
+			if (servedStore && servedStore->service())
+			{
+				#ifdef DEBUG
+				storeWrites++;
+				#endif
+			}
+
+			#ifdef DEBUG
+			stackHighWaterMark_CAL = uxTaskGetStackHighWaterMark(NULL);
+			#endif
+
+			vTaskDelayUntil(&lastTimeWoken, pdMS_TO_TICKS(CAL_TASK_PERIOD_MS));
+		}
+	}
+}
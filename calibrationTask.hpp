@@ -0,0 +1,34 @@
+#pragma once
+#ifndef SOAR_CALIBRATION_TASK_HPP
+#define SOAR_CALIBRATION_TASK_HPP
+
+/* Project Includes */
+#include "magCalibration.hpp"
+#include "calibrationStore.hpp"
+
+namespace SOAR_AHRS
+{
+	/**
+	* @brief Low priority worker for the calibration jobs too slow for the sample path
+	*
+	* The AHRS task only queues them and carries on; this task picks them up every
+	* CAL_TASK_PERIOD_MS, between everything else: the MagCalibrator ellipsoid solve, a few
+	* thousand software double operations on the M4F, and CalibrationStore saves, which stall
+	* instruction fetches while the flash programs.
+	*/
+	extern void calibrationTask(void* argument);
+
+	/**
+	* @brief Has calibrationTask run the deferred solves of magCal. Call from the AHRS task
+	* before it reports its initialization done.
+	*/
+	extern void calibrationServe(MagCalibrator& magCal);
+
+	/**
+	* @brief Has calibrationTask write the saves queued with CalibrationStore::requestSave().
+	* Same rules as above.
+	*/
+	extern void calibrationServe(CalibrationStore& store);
+}
+
+#endif
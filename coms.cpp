@@ -1,8 +1,5 @@
 /* C/C++ Includes */
 #include <stdint.h>
-#include <string>
-#include <memory>
-#include <cstdio>
 
 /* FreeRTOS Includes */
 #include "FreeRTOS.h"
@@ -13,13 +10,22 @@
 #include "stm32f4xx_hal.h"
 
 /* Thor Includes */
-#include "Thor\include\uart.h"
+#include "Thor/include/uart.h"
+#include "Thor/include/interrupt.h"
 
 
 /* Project Includes */
 #include "config.hpp"
 #include "threading.hpp"
 #include "coms.hpp"
+#include "telemetry.hpp"
+#include "format.hpp"
+#include "txBuffer.hpp"
+#include "cycleCounter.hpp"
+#include "runtimeStats.hpp"
+#include "trace.hpp"
+#include "rateGroup.hpp"
+#include "bootTiming.hpp"
 
 #define WRITE_RAW true
 
@@ -29,138 +35,232 @@ namespace SOAR_SERIAL
 
 	/* Input data from the AHRS algorithm */
 	AHRSData_t ahrs;	
+	static SeqLockReader ahrsReader;
+
+	/* Output buffers. Static so formatting never touches the heap. The next frame is built
+	* in the back buffer while the previous one is still being sent. */
+	#if (CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY)
+	const size_t txBufferSize = (SOAR_TELEMETRY::AHRS_FRAME_SIZE > SOAR_TELEMETRY::RUNTIME_FRAME_SIZE) ?
+		SOAR_TELEMETRY::AHRS_FRAME_SIZE : SOAR_TELEMETRY::RUNTIME_FRAME_SIZE;
+	#else
+	const size_t txBufferSize = (AHRS_LINE_SIZE > RUNTIME_LINE_SIZE) ? AHRS_LINE_SIZE : RUNTIME_LINE_SIZE;
+	#endif
+
+	static_assert(SOAR_TELEMETRY::TRACE_FRAME_SIZE <= txBufferSize, "Trace frames must fit the transmit buffer");
+	static_assert((CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY) || (TRACE_LINE_SIZE <= txBufferSize),
+		"Trace lines must fit the transmit buffer");
+	static_assert(SOAR_TELEMETRY::BOOT_FRAME_SIZE <= txBufferSize, "Boot frames must fit the transmit buffer");
+	static_assert((CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY) || (BOOT_LINE_SIZE <= txBufferSize),
+		"Boot lines must fit the transmit buffer");
+
+	static PingPongBuffer<txBufferSize> txBuffer;
+	static TxStats txStats;
+
+	#if (CONSOLE_TX_DMA)
+	static SemaphoreHandle_t txComplete;
+	static bool txInFlight = false;
+	static TickType_t txStartTick = 0;
+	static size_t txLength = 0;
+
+	/* Longest a transfer can be on the wire: 10 bits a byte, rounded up to a whole tick, plus
+	* the tick it started part way into */
+	static TickType_t transferTicks(size_t length)
+	{
+		const uint32_t wire_uS = (uint32_t)(((uint64_t)length * 10u * 1000000u) / CONSOLE_BAUD_RATE);
+		return pdMS_TO_TICKS(wire_uS / 1000u + 1u) + 1u;
+	}
+	#endif
 
-	/* Formatter to output as std::string...much easier to use */
-	template<typename ... Args>
-	std::string stringFormat(const std::string& format, Args ... args)
+	/* Sends the frame sitting in txBuffer.back() */
+	static void transmit(size_t length)
 	{
-		size_t size = std::snprintf(nullptr, 0, format.c_str(), args ...) + 1; //Extra space for '\0'
+		uint32_t waitCycles = 0;
+		uint32_t start = SOAR_PROFILE::cycleCount();
+
+		#if (CONSOLE_TX_DMA)
+		/* The buffer we swap back out must be free, so wait for the previous transfer. Across
+		* ticks it is long done. When one tick sends several frames the second one blocks here
+		* for the rest of the first one's time on the wire, about 11uS a byte at 921600 baud. */
+		if (txInFlight)
+		{
+			const TickType_t elapsed = xTaskGetTickCount() - txStartTick;
+			const TickType_t limit = transferTicks(txLength);
 
-		std::unique_ptr<char[]> buf(new char[size]);
+			if (xSemaphoreTake(txComplete, (elapsed < limit) ? (limit - elapsed) : 0) != pdPASS)
+			{
+				/* With no flow control the UART cannot take longer than that, so the DMA is idle
+				* and only the TX_COMPLETE give went missing. Carry on rather than wait forever. */
+				txStats.lostCompletions++;
+			}
 
-		std::snprintf(buf.get(), size, format.c_str(), args ...);
-		return std::string(buf.get(), buf.get() + size - 1); //Exclude the '\0'
+			waitCycles = SOAR_PROFILE::cycleCount() - start;
+			start = SOAR_PROFILE::cycleCount();
+		}
+
+		txStartTick = xTaskGetTickCount();
+		txLength = length;
+		uart2->write(txBuffer.swap(), length);
+		txInFlight = true;
+		#else
+		uart2->write(txBuffer.back(), length);
+		#endif
+
+		txStats.record(length, SOAR_PROFILE::cycleCount() - start, waitCycles);
 	}
 
-	#define MAX_PRECISION	(10)
-	static const double rounders[MAX_PRECISION + 1] =
-	{
-		0.5,				// 0
-		0.05,				// 1
-		0.005,				// 2
-		0.0005,				// 3
-		0.00005,			// 4
-		0.000005,			// 5
-		0.0000005,			// 6
-		0.00000005,			// 7
-		0.000000005,		// 8
-		0.0000000005,		// 9
-		0.00000000005		// 10
-	};
-
-	char * ftoa(double f, char * buf, int precision)
+	#if (CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY)
+	/* Sequence number of the next binary AHRS frame */
+	static uint16_t sequence = 0;
+	#endif
+
+	/* Telemetry group: the latest AHRS sample */
+	static void sendTelemetry(void* context, uint32_t periods)
 	{
-		char * ptr = buf;
-		char * p = ptr;
-		char * p1;
-		char c;
-		long intPart;
-
-		// check precision bounds
-		if (precision > MAX_PRECISION)
-			precision = MAX_PRECISION;
-
-		// sign stuff
-		if (f < 0)
+		#if (CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY)
+		/* Framed binary packets, see telemetry.hpp. Only fresh samples are sent so the
+		* receiver never sees the same timestamp twice. */
+		if (ahrsChannel.read(ahrs, ahrsReader))
+			transmit(SOAR_TELEMETRY::encodeAHRSFrame(ahrs, sequence++, txBuffer.back()));
+		#else
+		/* Check for an update from the AHRS thread. This will always pull the latest information. */
+		ahrsChannel.read(ahrs, ahrsReader);
+
+		if (WRITE_RAW)
 		{
-			f = -f;
-			*ptr++ = '-';
+			/* Simple csv style data */
+			transmit(formatAHRSLine(ahrs, (char*)txBuffer.back()));
 		}
-
-		if (precision < 0)  // negative precision == automatic precision guess
+		else
 		{
-			if (f < 1.0) precision = 6;
-			else if (f < 10.0) precision = 5;
-			else if (f < 100.0) precision = 4;
-			else if (f < 1000.0) precision = 3;
-			else if (f < 10000.0) precision = 2;
-			else if (f < 100000.0) precision = 1;
-			else precision = 0;
+			/* Pretty Print data to the terminal */
 		}
+		#endif
+	}
 
-		// round value according the precision
-		if (precision)
-			f += rounders[precision];
+	/* Boot group: the time from reset to the first AHRS sample, sent once as soon as it is known */
+	static void sendBootTiming(void* context, uint32_t periods)
+	{
+		static bool sent = false;
+		BootTiming_t timing;
+
+		if (sent || !SOAR_PROFILE::bootTiming(timing))
+			return;
+
+		#if (CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY)
+		transmit(SOAR_TELEMETRY::encodeBootFrame(timing, txBuffer.back()));
+		#else
+		transmit(formatBootLine(timing, (char*)txBuffer.back()));
+		#endif
+		sent = true;
+	}
 
-		// integer part...
-		intPart = f;
-		f -= intPart;
+	#if (RUNTIME_STATS_PERIOD_MS > 0)
+	static RuntimeStats_t runtimeStats;
 
-		if (!intPart)
-			*ptr++ = '0';
-		else
+	/* Runtime stats group: CPU, stack and heap usage, so rates can be sized against the real headroom */
+	static void sendRuntimeStats(void* context, uint32_t periods)
+	{
+		if (SOAR_PROFILE::sampleRuntimeStats(runtimeStats))
 		{
-			// save start pointer
-			p = ptr;
-
-			// convert (reverse order)
-			while (intPart)
-			{
-				*p++ = '0' + intPart % 10;
-				intPart /= 10;
-			}
-
-			// save end pos
-			p1 = p;
+			#if (CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY)
+			transmit(SOAR_TELEMETRY::encodeRuntimeFrame(runtimeStats, txBuffer.back()));
+			#else
+			transmit(formatRuntimeLine(runtimeStats, (char*)txBuffer.back()));
+			#endif
+		}
+	}
+	#endif
 
-			// reverse result
-			while (p > ptr)
-			{
-				c = *--p;
-				*p = *ptr;
-				*ptr++ = c;
-			}
+	#if (AHRS_TRACE_ENABLED)
+	/* Trace group: folds new AHRS stage timings into the histograms and answers console trace commands */
+	static void serviceTrace(void* context, uint32_t periods)
+	{
+		SOAR_PROFILE::traceDrain();
 
-			// restore end pos
-			ptr = p1;
-		}
+		bool dump = false;
+		uint8_t command[16];
 
-		// decimal part
-		if (precision)
+		while (uart2->availablePackets())
 		{
-			// place decimal point
-			*ptr++ = '.';
+			size_t length = uart2->nextPacketSize();
+			if (length > sizeof(command))
+				length = sizeof(command);
+
+			uart2->readPacket(command, sizeof(command));
 
-			// convert
-			while (precision--)
+			for (size_t i = 0; i < length; i++)
 			{
-				f *= 10.0;
-				c = f;
-				*ptr++ = '0' + c;
-				f -= c;
+				if (command[i] == TRACE_DUMP_COMMAND)
+					dump = true;
+				else if (command[i] == TRACE_RESET_COMMAND)
+					SOAR_PROFILE::traceReset();
 			}
 		}
 
-		// terminating zero
-		*ptr = 0;
+		if (!dump)
+			return;
 
-		return buf;
+		SOAR_PROFILE::TraceSummary summary;
+		for (uint8_t stage = 0; stage < SOAR_PROFILE::TRACE_STAGE_COUNT; stage++)
+		{
+			SOAR_PROFILE::traceSummary(stage, summary);
+
+			#if (CONSOLE_OUTPUT_MODE == CONSOLE_OUTPUT_BINARY)
+			transmit(SOAR_TELEMETRY::encodeTraceFrame(summary, SOAR_PROFILE::traceDropped(), txBuffer.back()));
+			#else
+			transmit(formatTraceLine(summary, SOAR_PROFILE::traceDropped(), (char*)txBuffer.back()));
+			#endif
+		}
 	}
-	
+	#endif
+
 	void serialTask(void* argument)
 	{
-		uart2->begin(921600);
-
-
-		std::string data = "hello friend\n";
-
-		std::string gx, gy, gz;
-		std::string ax, ay, az;
-		std::string mx, my, mz;
-		std::string pitch, roll, yaw;
-
-		const int precision = 2;
-		char *buff = new char(100);
+		#ifdef DEBUG
+		volatile uint32_t txCallCycles = 0;
+		volatile uint32_t txWaitCycles = 0;
+		volatile uint32_t txLostCompletions = 0;
+		volatile uint32_t txMaxFrameRate = 0;
+		volatile uint32_t ahrsSamplesMissed = 0;
+		volatile uint16_t cpuIdle_permille = 0;
+		volatile uint32_t frameOverruns = 0;
+		#endif
+
+		uart2->begin(CONSOLE_BAUD_RATE);
+
+		#if (CONSOLE_TX_DMA)
+		/* DMA transmit, with the driver giving txComplete at the end of each transfer */
+		#if (STATIC_ALLOCATION)
+		static StaticSemaphore_t txCompleteBuffer;
+		txComplete = xSemaphoreCreateBinaryStatic(&txCompleteBuffer);
+		#else
+		txComplete = xSemaphoreCreateBinary();
+		#endif
+		uart2->setMode(ThorDef::UART::SubPeripheral::TX, ThorDef::UART::Modes::DMA);
+		uart2->attachThreadTrigger(ThorDef::Interrupt::Trigger::TX_COMPLETE, &txComplete);
+		#endif
+
+		#if (AHRS_TRACE_ENABLED)
+		/* Console commands arrive by interrupt and are picked up each period */
+		uart2->setMode(ThorDef::UART::SubPeripheral::RX, ThorDef::UART::Modes::INTERRUPT);
+		#endif
+
+		SOAR_PROFILE::enableCycleCounter();
+
+
+		/* One base tick per console period. Slower groups run at divisors of it. */
+		SOAR_SCHEDULE::RateGroupExecutive rateGroups(CONSOLE_UPDATE_FREQ_HZ);
+		rateGroups.add("telemetry", 1, sendTelemetry, NULL);
+		rateGroups.add("boot", 1, sendBootTiming, NULL);
+
+		#if (RUNTIME_STATS_PERIOD_MS > 0)
+		rateGroups.add("runtimeStats", SOAR_SCHEDULE::divisorForPeriod(CONSOLE_UPDATE_FREQ_HZ, RUNTIME_STATS_PERIOD_MS),
+			sendRuntimeStats, NULL);
+		#endif
+
+		#if (AHRS_TRACE_ENABLED)
+		rateGroups.add("trace", 1, serviceTrace, NULL);
+		#endif
 
 		/* Tell init task that this thread's initialization is done and ok to run.
 		* Wait for init task to resume operation. */
@@ -171,39 +271,20 @@ namespace SOAR_SERIAL
 		TickType_t lastTimeWoken = xTaskGetTickCount();
 		for (;;)
 		{
-			/* Check for an update from the AHRS thread. This will always pull the latest information. */
-			if (xSemaphoreTake(ahrsBufferMutex, 0) == pdPASS)
-			{
-				xQueueReceive(qAHRS, &ahrs, 0);
-				xSemaphoreGive(ahrsBufferMutex);
-			}
-
-			if (WRITE_RAW)
-			{
-				/* Simple csv style data */
-				gx = ftoa(ahrs.gx(), buff, precision);
-				gy = ftoa(ahrs.gy(), buff, precision);
-				gz = ftoa(ahrs.gz(), buff, precision);
-
-				ax = ftoa(ahrs.ax(), buff, precision);
-				ay = ftoa(ahrs.ay(), buff, precision);
-				az = ftoa(ahrs.az(), buff, precision);
-
-				pitch = ftoa(ahrs.pitch(), buff, precision);
-				roll = ftoa(ahrs.roll(), buff, precision);
-				yaw = ftoa(ahrs.yaw(), buff, precision);
-				
-
-				std::string line = 
-					pitch + ',' + roll + ',' + yaw + ',' + \
-					ax + ',' + ay + ',' + az + ',' + \
-					gx + ',' + gy + ',' + gz + "\r\n";
-				uart2->write(line);
-			}
-			else
-			{
-				/* Pretty Print data to the terminal */
-			}
+			rateGroups.tick();
+
+			#ifdef DEBUG
+			txCallCycles = txStats.lastCallCycles;
+			txWaitCycles = txStats.lastWaitCycles;
+			txLostCompletions = txStats.lostCompletions;
+			txMaxFrameRate = maxFrameRate(CONSOLE_BAUD_RATE, txStats.averageFrameSize());
+			ahrsSamplesMissed = ahrsReader.missed;
+			frameOverruns = rateGroups.frameOverruns();
+
+			#if (RUNTIME_STATS_PERIOD_MS > 0)
+			cpuIdle_permille = runtimeStats.idle_permille;
+			#endif
+			#endif
 
 			vTaskDelayUntil(&lastTimeWoken, pdMS_TO_TICKS(updateRate_mS));
 		}
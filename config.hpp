@@ -10,6 +10,7 @@
 #define AHRS_UPDATE_PRIORITY		3
 #define STATUS_LEDS_PRIORITY		1
 #define CONSOLE_LOGGING_PRIORITY	2
+#define CALIBRATION_PRIORITY		1
 
 
 /*-----------------------------
@@ -17,12 +18,153 @@
 *----------------------------*/
 #define STATUS_LED_UPDATE_FREQ_HZ	5		
 #define CONSOLE_UPDATE_FREQ_HZ		50
+#define CAL_TASK_PERIOD_MS			100		/* How often calibrationTask looks for queued work */
 #define SENSOR_UPDATE_FREQ_HZ		150		
 #define AHRS_UPDATE_RATE_MULTIPLIER	5		/* AHRS will have an effective update at X multiple of SENSOR_UPDATE_FREQ_HZ (x5) */
+#define RATE_GROUP_MAX				4		/* Groups per task rate group executive, see rateGroup.hpp */
+
+/*-----------------------------
+* Sensor Acquisition
+*----------------------------*/
+#define AHRS_ACQUISITION_POLLED		0		/* Read the IMU every SENSOR_UPDATE_FREQ_HZ */
+#define AHRS_ACQUISITION_DRDY		1		/* Read the IMU when its INT1 data ready line fires */
+#define AHRS_ACQUISITION_FIFO		2		/* Let the IMU FIFO fill and drain it in one go on the threshold interrupt */
+#define AHRS_ACQUISITION_MODE		AHRS_ACQUISITION_POLLED
+
+/* FIFO mode saves the wakeups, not the bus traffic: every entry is still two SPI transactions
+* of 7 bytes (readGyro() then readAccel()), 2 * IMU_FIFO_THRESHOLD per batch plus the level
+* reads. OUT_X_L_G (0x18) and OUT_X_L_XL (0x28) are not adjacent, so one burst would have to
+* clock 22 bytes through the control registers to get both. TRACE_SPI_READ measures it. */
+
+#define AHRS_SENSOR_LSM9DS1			0		/* The IMU on SPI2 */
+#define AHRS_SENSOR_SYNTHETIC		1		/* Generated motion with a known attitude, see sensors.hpp. Needs no hardware. */
+#define AHRS_SENSOR_SOURCE			AHRS_SENSOR_LSM9DS1
+
+#define IMU_ODR_HZ					238		/* LSM9DS1 accel/gyro output data rate for the interrupt driven modes */
+#define IMU_FIFO_THRESHOLD			8		/* Samples per wakeup in FIFO mode (1-31) */
+#define IMU_DRDY_TIMEOUT_MS			20		/* Fall back to a polled read if no data ready edge arrives in time */
+
+#ifndef IMU_DRDY_SIMULATED
+#define IMU_DRDY_SIMULATED			0		/* 1: A software timer stands in for the INT1 line (host builds) */
+#endif
+
+/* Rate at which new samples actually reach the AHRS algorithm */
+#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_POLLED)
+#define AHRS_SAMPLE_RATE_HZ			SENSOR_UPDATE_FREQ_HZ
+#else
+#define AHRS_SAMPLE_RATE_HZ			IMU_ODR_HZ
+#endif
+
+/*-----------------------------
+* Magnetometer Calibration
+*----------------------------*/
+#define MAG_CAL_ONLINE				1		/* 1: Fit hard and soft iron continuously while running (magCalibration.hpp), 0: Blocking hard iron calibration at boot */
+#define MAG_CAL_WINDOW				4096	/* Mag samples the fit effectively remembers (~55s at 75Hz) */
+#define MAG_CAL_SOLVE_INTERVAL		75		/* Mag samples between solutions */
+#define MAG_CAL_MIN_SAMPLES			300		/* No correction until this many samples are in */
+#define MAG_CAL_MIN_FIELD_G			0.15f	/* Fitted field strengths outside these limits are rejected */
+#define MAG_CAL_MAX_FIELD_G			1.0f
+#define MAG_CAL_MAX_AXIS_RATIO		2.0f	/* Longest over shortest ellipsoid axis */
+#define MAG_CAL_MAX_RESIDUAL		0.05f	/* RMS fit error, relative to the field strength squared */
+
+/*-----------------------------
+* Calibration Store
+*----------------------------*/
+#define CAL_STORE_ENABLED			1		/* 1: Keep the LSM9DS1 biases and mag correction across resets (calibrationStore.hpp), 0: Calibrate on every boot */
+#ifndef CAL_STORE_FILE
+#define CAL_STORE_FILE				IMU_DRDY_SIMULATED	/* 1: Keep the record in a file (host builds, see SOAR_SIM_CAL), 0: Flash */
+#endif
+#define CAL_STORE_FLASH_SECTOR		11		/* Reserved for the store. Must be left out of the linker script's FLASH region. */
+#define CAL_STORE_FLASH_ADDRESS		0x080E0000
+#define CAL_STORE_FLASH_SIZE		0x20000
+#define CAL_STORE_RESERVE_SLOTS		16		/* Free records below which load() erases the sector at boot. Saves after that never erase. */
+#define CAL_STORE_MAX_TEMP_DELTA_C	15.0f	/* Stored gyro/accel biases go stale this far from the temperature they were measured at */
+#define CAL_STORE_MAG_SAVE_AFTER	10		/* Online mag fits accepted in a run before its correction is saved */
+#define CAL_STORE_MAG_TOLERANCE_G	0.01f	/* Smallest hard iron change worth a save */
+
+/*-----------------------------
+* AHRS Algorithm Selection
+*----------------------------*/
+#define AHRS_CLOSED_FORM_SMOOTHER	1		/* 1: Per-axis scalar Kalman pre-smoother, 0: Generic SR-UKF. Same steady state, differs while the filter converges (1.0e-3 at the first sample). */
+#define AHRS_UKF_WORKSPACE			1		/* SR-UKF only. 1: Scratch matrices in a static workspace (workspaceUKF.hpp), 0: Kalman library filter with its stack temporaries */
+#define AHRS_VARIABLE_DT			1		/* 1: Integrate the measured time between samples, 0: Assume 1/AHRS_SAMPLE_RATE_HZ and step AHRS_UPDATE_RATE_MULTIPLIER times */
+#define AHRS_MAX_STEP_HZ			(2 * AHRS_SAMPLE_RATE_HZ)	/* Variable dt: longest single Madgwick step is 1/X s, so late samples get extra steps */
+#define AHRS_MAX_SUBSTEPS			8		/* Variable dt: cap on Madgwick steps per sample after a long stall */
+
+#define AHRS_SCALAR_FLOAT			0		/* Single precision, native to the M4F FPU */
+#define AHRS_SCALAR_Q16				1		/* Q15.16 fixed point, see fixedPoint.hpp */
+#define AHRS_SCALAR_Q29				2		/* Q2.29 fixed point */
+#ifndef AHRS_ORIENTATION_SCALAR
+#define AHRS_ORIENTATION_SCALAR		AHRS_SCALAR_FLOAT	/* Arithmetic of the Madgwick stage. The smoother is float either way; double is host only (host/scalar_bench.cpp). */
+#endif
+
+#define AHRS_FILTER_MADGWICK		0		/* Gradient descent, AHRS_UPDATE_RATE_MULTIPLIER steps per sample on the fixed rate path */
+#define AHRS_FILTER_MAHONY			1		/* PI feedback on the gyro, one step per sample */
+#define AHRS_FILTER_COMPLEMENTARY	2		/* Gyro integration blended onto the accel tilt and mag heading, one step per sample */
+#ifndef AHRS_ORIENTATION_FILTER
+#define AHRS_ORIENTATION_FILTER		AHRS_FILTER_MADGWICK	/* Orientation stage after the smoother. Cost and accuracy of each: host/orientation_bench.cpp */
+#endif
+
+#define AHRS_PIPELINE_CASCADE		0		/* Kalman pre-smoother, then the orientation filter above */
+#define AHRS_PIPELINE_ESKF			1		/* One error-state EKF for attitude and gyro bias on the raw data (errorStateEKF.hpp). Ignores the smoother and orientation settings. */
+#ifndef AHRS_PIPELINE
+#define AHRS_PIPELINE				AHRS_PIPELINE_CASCADE	/* Cost and accuracy of both: host/pipeline_bench.cpp */
+#endif
+
+/*-----------------------------
+* Console Output
+*----------------------------*/
+#define CONSOLE_OUTPUT_CSV			0		/* Human readable comma separated lines */
+#define CONSOLE_OUTPUT_BINARY		1		/* COBS framed packets, see telemetry.hpp */
+#define CONSOLE_OUTPUT_MODE			CONSOLE_OUTPUT_CSV
+#define CONSOLE_BAUD_RATE			921600
+#define CONSOLE_TX_DMA				1		/* 1: DMA transmit from ping-pong buffers, a frame only waits out the one before it, 0: Blocking writes */
+
+/*-----------------------------
+* Run Time Statistics
+*----------------------------*/
+#define RUNTIME_STATS_PERIOD_MS		1000	/* serialTask reports per-task CPU, stack and heap usage this often (0: never) */
+#define RUNTIME_STATS_MAX_TASKS		8		/* Tasks tracked, including the idle and timer tasks */
+
+/*-----------------------------
+* Stage Tracing
+*----------------------------*/
+#ifndef AHRS_TRACE_ENABLED
+#define AHRS_TRACE_ENABLED			0		/* 1: Time each AHRS loop stage into histograms, dumped by sending TRACE_DUMP_COMMAND to the console */
+#endif
+#define AHRS_TRACE_RING_SIZE		256		/* Events buffered between the AHRS and serial tasks (power of two) */
+#define TRACE_DUMP_COMMAND			'T'		/* Console input that dumps the stage histograms */
+#define TRACE_RESET_COMMAND			'R'		/* Console input that clears them */
+
+/*-----------------------------
+* POSIX Simulator
+*----------------------------*/
+#ifndef SIM_TIME_SCALE
+#define SIM_TIME_SCALE				1		/* Simulated seconds per real second. Only the sim/ build sets this above 1. */
+#endif
 
 /*-----------------------------
 * Memory Management
 *----------------------------*/
 #define QUEUE_MINIMUM_SIZE			5
 
+#ifndef STATIC_ALLOCATION
+#define STATIC_ALLOCATION			0		/* 1: Tasks, semaphores, timers and peripherals use static storage and any heap allocation after boot traps */
+#endif
+#define HEAP_GUARD_WRAP_MALLOC		0		/* 1: Also trap the C library malloc. Link with -Wl,--wrap=malloc. */
+#define PERIPHERAL_POOL_BYTES		512		/* Static storage for the GPIO/SPI driver objects in static allocation mode */
+
+#define INIT_TASK_STACK_WORDS		500
+#define LED_TASK_STACK_WORDS		350
+#define SERIAL_TASK_STACK_WORDS		1000
+#define CAL_TASK_STACK_WORDS		1000	/* The MagCalibrator solve peaks at ~2.7KB (host, -O2) */
+#if (AHRS_CLOSED_FORM_SMOOTHER || AHRS_UKF_WORKSPACE)
+/* Deepest call from the sample loop, measured on the host at -O2: ~1.0KB for a cascade step,
+* ~0.8KB for an ESKF step, ~0.2KB for the mag group now that the solve is in calibrationTask.
+* Confirm with stackHighWaterMark_AHRS on the target after changing any of them. */
+#define AHRS_TASK_STACK_WORDS		2000
+#else
+#define AHRS_TASK_STACK_WORDS		8000	/* The Kalman library SR-UKF builds its Eigen temporaries on the stack */
+#endif
+
 #endif 
\ No newline at end of file
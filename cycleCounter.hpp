@@ -0,0 +1,110 @@
+#pragma once
+#ifndef SOAR_CYCLE_COUNTER_HPP
+#define SOAR_CYCLE_COUNTER_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/* Project Includes */
+#include "config.hpp"
+
+#if defined(__arm__)
+/* HAL Includes */
+#include "stm32f4xx_hal.h"
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <chrono>
+#else
+#include <chrono>
+#endif
+
+namespace SOAR_PROFILE
+{
+	/**
+	* @brief Starts the free running cycle counter
+	*
+	* On the STM32 this is the DWT CYCCNT register, which counts core clocks. Host builds use
+	* the TSC (or a nanosecond clock where there is none), so counts are only comparable
+	* against other counts taken on the same machine.
+	*/
+	inline void enableCycleCounter()
+	{
+		#if defined(__arm__)
+		/* Several tasks call this, and the run time stats clock shares the counter, so
+		* only the first call may reset it */
+		if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+		{
+			CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+			DWT->CYCCNT = 0;
+			DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+		}
+		#endif
+	}
+
+	/**
+	* @brief Current value of the cycle counter. Wraps at 32 bits, so only differences
+	* between two readings are meaningful (about 25s of range at 168MHz).
+	*/
+	inline uint32_t cycleCount()
+	{
+		#if defined(__arm__)
+		return DWT->CYCCNT;
+		#elif defined(__x86_64__) || defined(__i386__)
+		return (uint32_t)__rdtsc();
+		#else
+		return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		#endif
+	}
+
+	/* Width of the counter rate. A TSC can run faster than 4.29GHz, which a uint32_t would
+	* silently wrap, so host builds carry it in 64 bits. */
+	#if defined(__arm__)
+	typedef uint32_t CycleRate;
+	#else
+	typedef uint64_t CycleRate;
+	#endif
+
+	/**
+	* @brief Rate the cycle counter runs at, for turning counts into time
+	*
+	* The core clock on the STM32. On x86 the TSC rate is measured against the steady clock
+	* the first time this is called, which takes about 10mS.
+	*/
+	inline CycleRate cycleCounterHz()
+	{
+		#if defined(__arm__)
+		return SystemCoreClock;
+		#elif defined(__x86_64__) || defined(__i386__)
+		static uint64_t hz = 0;
+		if (hz == 0)
+		{
+			typedef std::chrono::steady_clock Clock;
+			Clock::time_point start = Clock::now();
+			uint64_t startCycles = __rdtsc();
+
+			while (Clock::now() - start < std::chrono::milliseconds(10)) {}
+
+			double elapsed_S = std::chrono::duration<double>(Clock::now() - start).count();
+			hz = (uint64_t)((__rdtsc() - startCycles) / elapsed_S);
+		}
+		return hz;
+		#else
+		return 1000000000u;
+		#endif
+	}
+
+	/**
+	* @brief Seconds between two cycle counter readings (valid across one wrap)
+	*
+	* This is simulated time: under the POSIX simulator's faster than real time mode the
+	* wall clock interval is stretched by SIM_TIME_SCALE, so sample intervals match the
+	* RTOS ticks. Profiling code that wants real time uses cycleCounterHz() directly.
+	*/
+	inline float cyclesToSeconds(uint32_t startCycles, uint32_t endCycles)
+	{
+		return (float)(endCycles - startCycles) * SIM_TIME_SCALE / (float)cycleCounterHz();
+	}
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "dataReady.hpp"
+
+/* FreeRTOS Includes */
+#include "timers.h"
+
+/* Project Includes */
+#include "config.hpp"
+#include "threading.hpp"
+#include "cycleCounter.hpp"
+
+#if !(IMU_DRDY_SIMULATED)
+/* HAL Includes */
+#include "stm32f4xx_hal.h"
+
+/* Thor Includes */
+#include "Thor/include/exti.h"
+#endif
+
+namespace SOAR_AHRS
+{
+	/* Written only by dataReadyISR(), read by the AHRS task after the notification */
+	static volatile TickType_t lastEdgeTick = 0;
+	static volatile uint32_t lastEdgeCycles = 0;
+
+	static TimerHandle_t simulatedSource;
+
+	/* Runs in the timer task rather than an ISR, so the task-level notify is used */
+	static void simulatedDataReady(TimerHandle_t timer)
+	{
+		lastEdgeTick = xTaskGetTickCount();
+		lastEdgeCycles = SOAR_PROFILE::cycleCount();
+
+		if (TaskHandle[AHRS_TASK])
+			xTaskNotifyGive(TaskHandle[AHRS_TASK]);
+	}
+
+	/* Fires at the rate the sensor would raise INT1 */
+	static void startSimulatedSource()
+	{
+		#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+		TickType_t period = pdMS_TO_TICKS((1000 * IMU_FIFO_THRESHOLD) / IMU_ODR_HZ);
+		#else
+		TickType_t period = pdMS_TO_TICKS(1000 / IMU_ODR_HZ);
+		#endif
+		#if (STATIC_ALLOCATION)
+		static StaticTimer_t simulatedSourceBuffer;
+		simulatedSource = xTimerCreateStatic("drdySim", (period > 0) ? period : 1, pdTRUE, NULL, simulatedDataReady, &simulatedSourceBuffer);
+		#else
+		simulatedSource = xTimerCreate("drdySim", (period > 0) ? period : 1, pdTRUE, NULL, simulatedDataReady);
+		#endif
+		xTimerStart(simulatedSource, 0);
+	}
+
+	#if !(IMU_DRDY_SIMULATED)
+	/* LSM9DS1 INT1_A/G is wired to PC5 */
+	#define IMU_DRDY_PORT	GPIOC
+	#define IMU_DRDY_PIN	GPIO_PIN_5
+	#define IMU_DRDY_IRQn	EXTI9_5_IRQn
+	#endif
+
+	/* Maps IMU_ODR_HZ onto the LSM9DS1 gyro ODR setting (CTRL_REG1_G) */
+	static uint8_t gyroODRSetting(int odr_Hz)
+	{
+		if (odr_Hz <= 15) return 1;
+		if (odr_Hz <= 60) return 2;
+		if (odr_Hz <= 119) return 3;
+		if (odr_Hz <= 238) return 4;
+		if (odr_Hz <= 476) return 5;
+		return 6;
+	}
+
+	void dataReadyInit(LSM9DS1& imu)
+	{
+		/* Accel and gyro share the gyro ODR when both are enabled */
+		imu.setGyroODR(gyroODRSetting(IMU_ODR_HZ));
+
+		#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+		/* Continuous mode keeps the newest 32 samples, overwriting the oldest if we fall behind */
+		imu.enableFIFO(true);
+		imu.setFIFO(FIFO_CONT, IMU_FIFO_THRESHOLD);
+		#endif
+
+		#if (IMU_DRDY_SIMULATED)
+		startSimulatedSource();
+		#else
+		#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+		/* Push-pull, active high INT1 while the FIFO holds at least IMU_FIFO_THRESHOLD samples */
+		imu.configInt(XG_INT1, INT_FTH, INT_ACTIVE_HIGH, INT_PUSH_PULL);
+		#else
+		/* Push-pull, active high pulse on INT1 whenever a new gyro sample is ready */
+		imu.configInt(XG_INT1, INT_DRDY_G, INT_ACTIVE_HIGH, INT_PUSH_PULL);
+		#endif
+
+		GPIO_InitTypeDef init;
+		init.Pin = IMU_DRDY_PIN;
+		init.Mode = GPIO_MODE_IT_RISING;
+		init.Pull = GPIO_NOPULL;
+		init.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+		HAL_GPIO_Init(IMU_DRDY_PORT, &init);
+
+		/* Must not be above configMAX_SYSCALL_INTERRUPT_PRIORITY to use FreeRTOS calls */
+		HAL_NVIC_SetPriority(IMU_DRDY_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+		HAL_NVIC_EnableIRQ(IMU_DRDY_IRQn);
+		#endif
+	}
+
+	void dataReadyInit()
+	{
+		startSimulatedSource();
+	}
+
+	bool waitForDataReady(DataReadyEvent& event, TickType_t timeout)
+	{
+		event.pending = ulTaskNotifyTake(pdTRUE, timeout);
+		event.tick = lastEdgeTick;
+		event.cycles = lastEdgeCycles;
+
+		return (event.pending > 0);
+	}
+
+	void dataReadyISR()
+	{
+		BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+		lastEdgeCycles = SOAR_PROFILE::cycleCount();
+		lastEdgeTick = xTaskGetTickCountFromISR();
+
+		if (TaskHandle[AHRS_TASK])
+			vTaskNotifyGiveFromISR(TaskHandle[AHRS_TASK], &higherPriorityTaskWoken);
+
+		portYIELD_FROM_ISR(higherPriorityTaskWoken);
+	}
+}
+
+#if !(IMU_DRDY_SIMULATED)
+/* The Thor EXTI interrupt handlers dispatch every line through the HAL callback */
+extern "C" void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	if (GPIO_Pin == IMU_DRDY_PIN)
+		SOAR_AHRS::dataReadyISR();
+}
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef SOAR_DATA_READY_HPP
+#define SOAR_DATA_READY_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Project Includes */
+#include "LSM9DS1.hpp"
+
+namespace SOAR_AHRS
+{
+	/* Timestamp of the latest LSM9DS1 data ready edge, captured in interrupt context */
+	struct DataReadyEvent
+	{
+		TickType_t tick;		/* RTOS tick at the edge */
+		uint32_t cycles;		/* Cycle counter at the edge, for latency measurements */
+		uint32_t pending;		/* Edges since the last wait. Anything above 1 is a missed sample. */
+	};
+
+	/**
+	* @brief Routes the LSM9DS1 INT1 data ready signal to the AHRS task
+	*
+	* Configures the IMU to raise INT1 on new gyro/accel data (or, in FIFO mode, when the FIFO
+	* reaches IMU_FIFO_THRESHOLD) and arms the EXTI line it is wired to. With IMU_DRDY_SIMULATED
+	* set, a software timer at the same rate stands in for the sensor instead, so the interrupt
+	* driven path also runs in host builds.
+	*
+	* @param [in] imu    Initialized sensor
+	*/
+	extern void dataReadyInit(LSM9DS1& imu);
+
+	/**
+	* @brief Starts the software timer data ready source on its own, for sensor sources
+	* with no INT1 line (see sensors.hpp)
+	*/
+	extern void dataReadyInit();
+
+	/**
+	* @brief Blocks the calling task until the next data ready edge
+	*
+	* @param [out] event    Timestamp of the edge that woke the task
+	* @param [in]  timeout  Maximum ticks to wait
+	* @returns true if an edge arrived, false on timeout
+	*/
+	extern bool waitForDataReady(DataReadyEvent& event, TickType_t timeout);
+
+	/**
+	* @brief Data ready handler. Called from the EXTI interrupt, or by the simulated source.
+	*/
+	extern void dataReadyISR();
+}
+
+#endif
@@ -9,6 +9,10 @@
 /* Eigen Includes */
 #include <Eigen/Eigen>
 
+/* Project Includes */
+#include "config.hpp"
+#include "orientation.hpp"
+
 
 enum LEDInstructions
 {
@@ -27,46 +31,138 @@ enum LEDInstructions
 };
 
 
-struct AHRSData_t
+/**
+* @brief One filtered sample and the attitude worked out from it
+*
+* @tparam Real  Scalar the filter chain ran in. The firmware and everything that sends or
+*				prints samples use the float AHRSData_t; double is for host reference runs.
+*/
+template<typename Real>
+struct AHRSDataT
 {
-	AHRSData_t()
+	typedef Eigen::Matrix<Real, 3, 1> Vector3;
+	typedef Eigen::Matrix<Real, 4, 1> Vector4;
+
+	AHRSDataT()
 	{
-		eulerAngles.setZero();
+		quaternion << Real(1), Real(0), Real(0), Real(0);
 		accel.setZero();
 		gyro.setZero();
 		mag.setZero();
+		timestamp_mS = 0;
 	}
 
-	void operator()(Eigen::Vector3f euler_deg, Eigen::Vector3f acceleration_ms2,
-		Eigen::Vector3f gyroscope_dps, Eigen::Vector3f magnetometer_g)
+	void operator()(const Vector4& attitude, const Vector3& acceleration_ms2,
+		const Vector3& gyroscope_dps, const Vector3& magnetometer_g)
 	{
-		eulerAngles = euler_deg;
+		quaternion = attitude;
 		accel = acceleration_ms2;
 		gyro = gyroscope_dps;
 		mag = magnetometer_g;
 	}
 
-	Eigen::Vector3f eulerAngles;	/* [PITCH, ROLL, YAW] (deg) */
-	Eigen::Vector3f accel;			/* [X, Y, Z] (m/s^2) */
-	Eigen::Vector3f gyro;			/* [X, Y, Z] (dps) */
-	Eigen::Vector3f mag;			/* [X, Y, Z] (gauss) */
+	Vector4 quaternion;				/* Attitude, [W, X, Y, Z] */
+	Vector3 accel;					/* [X, Y, Z] (m/s^2) */
+	Vector3 gyro;					/* [X, Y, Z] (dps) */
+	Vector3 mag;					/* [X, Y, Z] (gauss) */
+	uint32_t timestamp_mS;			/* Time the raw sample was read (mS since boot) */
+
+
+	/* Euler angles are worked out from the quaternion on request. The AHRS itself never
+	* needs them, so only the consumers that print them pay for the trig. */
+	void eulerDeg(Eigen::Vector3f& euler) const { SOAR_AHRS::quaternionToEulerDeg(quaternion, euler); }
+	Eigen::Vector3f eulerDeg() const { Eigen::Vector3f euler; eulerDeg(euler); return euler; }	/* [PITCH, ROLL, YAW] (deg) */
+
+	float pitch() const { return SOAR_AHRS::quaternionPitchDeg(quaternion(0), quaternion(1), quaternion(2), quaternion(3)); }
+	float roll() const { return SOAR_AHRS::quaternionRollDeg(quaternion(0), quaternion(1), quaternion(2), quaternion(3)); }
+	float yaw() const { return SOAR_AHRS::quaternionYawDeg(quaternion(0), quaternion(1), quaternion(2), quaternion(3)); }
+
+	const Real& ax() { return this->accel(0); }
+	const Real& ay() { return this->accel(1); }
+	const Real& az() { return this->accel(2); }
+
+	const Real& gx() { return this->gyro(0); }
+	const Real& gy() { return this->gyro(1); }
+	const Real& gz() { return this->gyro(2); }
+
+	const Real& mx() { return this->mag(0); }
+	const Real& my() { return this->mag(1); }
+	const Real& mz() { return this->mag(2); }
+};
+
+typedef AHRSDataT<float> AHRSData_t;
+
+
+/* Task identifiers in RuntimeStats_t that are not one of the application's TaskIndex values */
+enum RuntimeTaskID
+{
+	RUNTIME_TASK_IDLE = 0x80,
+	RUNTIME_TASK_TIMER = 0x81,
+	RUNTIME_TASK_OTHER = 0xFF
+};
+
+#define RUNTIME_TASK_NAME_LEN	16
+
+struct TaskRuntime_t
+{
+	uint8_t id;							/* TaskIndex, or a RuntimeTaskID */
+	char name[RUNTIME_TASK_NAME_LEN];	/* Name given to xTaskCreate() */
+	uint16_t cpu_permille;				/* Share of the window spent running this task (0.1%) */
+	uint16_t stackFree_words;			/* Least free stack seen since the task started */
+};
+
+struct RuntimeStats_t
+{
+	RuntimeStats_t()
+	{
+		timestamp_mS = 0;
+		window_mS = 0;
+		idle_permille = 0;
+		freeHeap_bytes = 0;
+		taskCount = 0;
+	}
+
+	uint32_t timestamp_mS;				/* End of the measurement window (mS since boot) */
+	uint32_t window_mS;					/* Length of the measurement window */
+	uint16_t idle_permille;				/* Idle task share of the window, i.e. CPU headroom (0.1%) */
+	uint32_t freeHeap_bytes;			/* xPortGetFreeHeapSize() */
+	uint8_t taskCount;
+	TaskRuntime_t tasks[RUNTIME_STATS_MAX_TASKS];
+};
 
 
-	const float& pitch() { return this->eulerAngles(0); }
-	const float& roll() { return this->eulerAngles(1); }
-	const float& yaw() { return this->eulerAngles(2); }
+/* How the AHRS got its sensor calibration at boot, see SOAR_AHRS::CalibrationStore */
+enum CalibrationStatus
+{
+	CAL_STATUS_NONE = 0,				/* No store in this build, or not looked at yet */
+	CAL_STATUS_LOADED = 1,				/* Stored biases used as they were */
+	CAL_STATUS_MISSING = 2,				/* Nothing valid stored, so calibrated and saved */
+	CAL_STATUS_STALE = 3				/* Stored at too different a temperature, so calibrated and saved */
+};
 
-	const float& ax() { return this->accel(0); }
-	const float& ay() { return this->accel(1); }
-	const float& az() { return this->accel(2); }
+inline const char* calibrationStatusName(uint8_t status)
+{
+	static const char* names[] = { "none", "loaded", "missing", "stale" };
+	return (status < sizeof(names) / sizeof(names[0])) ? names[status] : "unknown";
+}
 
-	const float& gx() { return this->gyro(0); }
-	const float& gy() { return this->gyro(1); }
-	const float& gz() { return this->gyro(2); }
+struct BootTiming_t
+{
+	BootTiming_t()
+	{
+		scheduler_uS = 0;
+		imuReady_uS = 0;
+		tasksResumed_uS = 0;
+		firstOutput_uS = 0;
+		calibration = CAL_STATUS_NONE;
+	}
 
-	const float& mx() { return this->mag(0); }
-	const float& my() { return this->mag(1); }
-	const float& mz() { return this->mag(2); }
+	/* Milestones, uS after main() finished setting up the clocks */
+	uint32_t scheduler_uS;				/* Init task started */
+	uint32_t imuReady_uS;				/* IMU up and calibrated (or calibration loaded) */
+	uint32_t tasksResumed_uS;			/* Init task released every task */
+	uint32_t firstOutput_uS;			/* First AHRS sample published */
+	uint8_t calibration;				/* CalibrationStatus */
 };
 
-#endif 
\ No newline at end of file
+#endif
\ No newline at end of file
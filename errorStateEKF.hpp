@@ -0,0 +1,339 @@
+#pragma once
+#ifndef SOAR_ERROR_STATE_EKF_HPP
+#define SOAR_ERROR_STATE_EKF_HPP
+
+/* C/C++ Includes */
+#include <math.h>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+/* Project Includes */
+#include "fixedPoint.hpp"
+#include "orientation.hpp"
+
+namespace SOAR_AHRS
+{
+	/**
+	* @brief Noise model of the error-state EKF. All standard deviations.
+	*/
+	struct ErrorStateNoise
+	{
+		float gyro_dps;				/* Gyro white noise on one sample */
+		float gyroBiasWalk_dps;		/* Gyro bias drift over one second */
+		float accel;				/* Accelerometer direction, as a fraction of its length (~rad). Covers linear acceleration too. */
+		float heading_deg;			/* Heading from a magnetometer reading with a horizontal field */
+		float initialTilt_deg;		/* Attitude after aligning to the first accel reading */
+		float initialBias_dps;		/* Gyro bias before any reading */
+	};
+
+	inline float arcTangent2(float y, float x) { return atan2f(y, x); }
+	inline double arcTangent2(double y, double x) { return atan2(y, x); }
+
+	/**
+	* @brief Quaternion error-state Kalman filter for attitude and gyro bias
+	*
+	* The nominal state is the attitude q ([w, x, y, z], body to earth, same convention as
+	* MadgwickAHRST) and the gyro bias b. The filter keeps the covariance of a 6 element error
+	* around them, [dtheta, db]: a small body frame rotation, q_true = q * [1, dtheta/2], and
+	* the bias error. The error is folded back into q and b after every update, so q never
+	* needs a covariance of its own and there is no unit norm constraint to linearise.
+	*
+	*	predict:  w = gyro - b, q = q * [1, w*dt/2], P = F P F' + Q
+	*	          F = [ I - [w*dt]x   -I*dt ]
+	*	              [ 0              I    ]
+	*	accel:    the unit accel reading against the up axis in the body frame, R' * z:
+	*	          H = [ [R'z]x  0 ]
+	*	mag:      the heading of the reading rotated to the earth frame. One scalar, so the
+	*	          magnetometer cannot pull the tilt; its noise grows as the field gets steeper.
+	*
+	* Everything is fixed size Eigen. The covariance predict is done by 3x3 blocks, using the
+	* zeros in F, and the measurements are fused one scalar at a time, which needs no matrix
+	* inverse and only one divide each. A MARG sample is ~570 adds and multiplies and 13
+	* divides or square roots (host/pipeline_bench.cpp), and nothing allocates.
+	*
+	* The attitude is aligned to the first accel reading, and the heading to the first mag
+	* reading, rather than converged to from identity. Linear acceleration is not modelled;
+	* ErrorStateNoise::accel has to cover it.
+	*
+	* @tparam Real  float or double
+	*/
+	template<typename Real>
+	class ErrorStateEKF
+	{
+	public:
+		typedef Eigen::Matrix<Real, 3, 1> Vector3;
+		typedef Eigen::Matrix<Real, 4, 1> Vector4;
+		typedef Eigen::Matrix<Real, 3, 3> Matrix3;
+		typedef Eigen::Matrix<Real, 6, 1> Vector6;
+		typedef Eigen::Matrix<Real, 6, 6> Matrix6;
+
+		ErrorStateEKF(const ErrorStateNoise& noise) : noise(noise)
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			q << Real(1), Real(0), Real(0), Real(0);
+			bias.setZero();
+			P.setZero();
+			tiltAligned = false;
+			headingAligned = false;
+		}
+
+		/**
+		* @brief Integrates the gyro over one step and grows the covariance to match
+		*
+		* @param [in] gyro    Gyroscope (dps)
+		* @param [in] dt      Integration step (s)
+		*/
+		void predict(const Vector3& gyro, Real dt)
+		{
+			if (!tiltAligned)
+				return;
+
+			const Vector3 theta = (gyro * Real(DEG_TO_RAD) - bias) * dt;
+
+			turnBody(theta);
+
+			/* P = F P F' + Q by blocks, P = [A B; B' C] and Phi = I - [theta]x:
+			*	A = N Phi' - dt M,  B = M,  C = C
+			*	N = Phi A - dt B',  M = Phi B - dt C
+			* [theta]x X is the cross product with every column of X, and X [theta]x with
+			* every row, which is cheaper than multiplying by Phi. */
+			const Matrix3 A = P.template topLeftCorner<3, 3>();
+			const Matrix3 B = P.template topRightCorner<3, 3>();
+			const Matrix3 C = P.template bottomRightCorner<3, 3>();
+
+			const Matrix3 M = B + B.colwise().cross(theta) - dt * C;
+			const Matrix3 N = A + A.colwise().cross(theta) - dt * B.transpose();
+			const Matrix3 Anew = N + N.rowwise().cross(theta) - dt * M;
+
+			const Real gyroVar = square(Real(noise.gyro_dps * DEG_TO_RAD) * dt);
+			const Real walkVar = square(Real(noise.gyroBiasWalk_dps * DEG_TO_RAD)) * dt;
+
+			P.template topLeftCorner<3, 3>() = Anew.template selfadjointView<Eigen::Lower>();
+			P.template topLeftCorner<3, 3>().diagonal().array() += gyroVar;
+			P.template topRightCorner<3, 3>() = M;
+			P.template bottomLeftCorner<3, 3>() = M.transpose();
+			P.template bottomRightCorner<3, 3>().diagonal().array() += walkVar;
+		}
+
+		/**
+		* @brief Corrects the attitude and bias from an accel reading and, if it is new, a mag reading
+		*
+		* The accelerometer gives the tilt and the bias about the horizontal axes, the
+		* magnetometer the heading and the bias about the vertical. Both are fused against the
+		* same predicted state and folded in once. The first accel reading aligns the attitude
+		* instead, and the first usable mag reading the heading.
+		*
+		* @param [in] accel   Accelerometer, any unit (only the direction is used). All zeros is skipped.
+		* @param [in] mag     Magnetometer, any unit. All zeros, or the reading fused last time, is
+		*                     skipped, so a mag that updates slower than the accel/gyro counts once.
+		*/
+		void update(const Vector3& accel, const Vector3& mag)
+		{
+			const Real accelNormSq = accel.squaredNorm();
+			if (!tiltAligned)
+			{
+				if (accelNormSq > Real(0))
+					alignTilt(accel * (Real(1) / squareRoot(accelNormSq)));
+				return;
+			}
+
+			const Vector3 up = upInBody();
+			Vector6 dx = Vector6::Zero();
+
+			if (accelNormSq > Real(0))
+				fuseAccel(accel * (Real(1) / squareRoot(accelNormSq)), up, dx);
+
+			if (mag != lastMag)
+			{
+				lastMag = mag;
+				fuseMag(mag, up, dx);
+			}
+
+			inject(dx);
+		}
+
+		/* Attitude quaternion, [w, x, y, z] */
+		const Vector4& quaternion() const { return q; }
+
+		/* Gyro bias estimate (dps) */
+		Vector3 gyroBiasDps() const { return bias * Real(RAD_TO_DEG); }
+
+		/* Error covariance, [dtheta (rad), db (rad/s)] */
+		const Matrix6& covariance() const { return P; }
+
+	private:
+		ErrorStateNoise noise;
+
+		Vector4 q;
+		Vector3 bias;			/* rad/s */
+		Matrix6 P;
+		Vector3 lastMag;
+
+		bool tiltAligned;
+		bool headingAligned;
+
+		static Real square(Real x) { return x * x; }
+
+		static Matrix3 skew(const Vector3& v)
+		{
+			Matrix3 m;
+			m << Real(0), -v(2), v(1),
+				v(2), Real(0), -v(0),
+				-v(1), v(0), Real(0);
+			return m;
+		}
+
+		static Vector4 multiply(const Vector4& a, const Vector4& b)
+		{
+			return Vector4(
+				a(0) * b(0) - a(1) * b(1) - a(2) * b(2) - a(3) * b(3),
+				a(0) * b(1) + a(1) * b(0) + a(2) * b(3) - a(3) * b(2),
+				a(0) * b(2) - a(1) * b(3) + a(2) * b(0) + a(3) * b(1),
+				a(0) * b(3) + a(1) * b(2) - a(2) * b(1) + a(3) * b(0));
+		}
+
+		/* q = q * [1, angle/2], normalised: a small turn in the body frame */
+		void turnBody(const Vector3& angle)
+		{
+			const Vector3 h = Real(0.5) * angle;
+			q += Vector4(
+				-q(1) * h(0) - q(2) * h(1) - q(3) * h(2),
+				q(0) * h(0) + q(2) * h(2) - q(3) * h(1),
+				q(0) * h(1) - q(1) * h(2) + q(3) * h(0),
+				q(0) * h(2) + q(1) * h(1) - q(2) * h(0));
+			q *= Real(1) / squareRoot(q.squaredNorm());
+		}
+
+		/* R' * [0 0 1] */
+		Vector3 upInBody() const
+		{
+			return Vector3(
+				Real(2) * (q(1) * q(3) - q(0) * q(2)),
+				Real(2) * (q(0) * q(1) + q(2) * q(3)),
+				q(0) * q(0) - q(1) * q(1) - q(2) * q(2) + q(3) * q(3));
+		}
+
+		/* Horizontal part of R * v. The vertical part is left at zero, nothing uses it. */
+		Vector3 toEarth(const Vector3& v) const
+		{
+			return Vector3(
+				(Real(1) - Real(2) * (q(2) * q(2) + q(3) * q(3))) * v(0) +
+				Real(2) * (q(1) * q(2) - q(0) * q(3)) * v(1) + Real(2) * (q(1) * q(3) + q(0) * q(2)) * v(2),
+				Real(2) * (q(1) * q(2) + q(0) * q(3)) * v(0) +
+				(Real(1) - Real(2) * (q(1) * q(1) + q(3) * q(3))) * v(1) + Real(2) * (q(2) * q(3) - q(0) * q(1)) * v(2),
+				Real(0));
+		}
+
+		/**
+		* @brief measured = up + [up]x dtheta, up being the last row of the rotation matrix
+		*
+		* The axes have independent noise, so they are fused one at a time. The axis most in
+		* line with up mostly measures the length of the reading, which normalising threw away,
+		* so only the other two are used.
+		*/
+		void fuseAccel(const Vector3& measured, const Vector3& up, Vector6& dx)
+		{
+			const Vector3 residual = measured - up;
+			const Matrix3 H = skew(up);
+			const Real variance = square(Real(noise.accel));
+
+			int skip;
+			up.cwiseAbs().maxCoeff(&skip);
+
+			for (int axis = 0; axis < 3; axis++)
+				if (axis != skip)
+					fuse(H.row(axis).transpose(), residual(axis), variance, dx);
+		}
+
+		/* heading = -up' dtheta, a turn of the body about the earth vertical */
+		void fuseMag(const Vector3& mag, const Vector3& up, Vector6& dx)
+		{
+			const Real normSq = mag.squaredNorm();
+			if (normSq == Real(0))
+				return;
+
+			/* The reading in the earth frame, of which only the horizontal part gives a heading.
+			* The heading gets noisier as the field gets steeper. */
+			const Vector3 earth = toEarth(mag);
+			const Real horizontalSq = (earth(0) * earth(0) + earth(1) * earth(1)) / normSq;
+			if (horizontalSq < Real(0.01))
+				return;
+
+			const Real heading = arcTangent2(earth(1), earth(0));
+			if (!headingAligned)
+			{
+				rotateHeading(-heading);
+				headingAligned = true;
+				return;
+			}
+
+			fuse(-up, heading, square(Real(noise.heading_deg * DEG_TO_RAD)) / horizontalSq, dx);
+		}
+
+		/**
+		* @brief Fuses one scalar measurement of the attitude error, z = h' dtheta + noise
+		*
+		* Nothing measures the bias directly, so H is zero over it and P H' is the left three
+		* columns of P times h. P is kept symmetric by updating one triangle and mirroring it.
+		*
+		* @param [in]     h          Measurement row over dtheta
+		* @param [in]     residual   Measurement minus its prediction at the nominal state
+		* @param [in]     variance   Measurement noise
+		* @param [in,out] dx         Error estimate from the measurements fused so far
+		*/
+		void fuse(const Vector3& h, Real residual, Real variance, Vector6& dx)
+		{
+			const Vector6 PHt = P.template leftCols<3>() * h;
+			const Vector6 K = PHt * (Real(1) / (h.dot(PHt.template head<3>()) + variance));
+
+			dx += K * (residual - h.dot(dx.template head<3>()));
+
+			for (int col = 0; col < 6; col++)
+				for (int row = col; row < 6; row++)
+				{
+					P(row, col) -= K(row) * PHt(col);
+					P(col, row) = P(row, col);
+				}
+		}
+
+		/* Folds the error estimate into q and b. The covariance already describes the error after it. */
+		void inject(const Vector6& dx)
+		{
+			turnBody(dx.template head<3>());
+
+			bias += dx.template tail<3>();
+		}
+
+		/* Shortest rotation taking the measured up direction onto the earth's, no heading */
+		void alignTilt(const Vector3& up)
+		{
+			if (up(2) > Real(-0.999))
+				q << Real(1) + up(2), up(1), -up(0), Real(0);
+			else
+				q << Real(0), Real(1), Real(0), Real(0);
+			q *= Real(1) / squareRoot(q.squaredNorm());
+
+			P.setZero();
+			P.template topLeftCorner<3, 3>().diagonal().setConstant(square(Real(noise.initialTilt_deg * DEG_TO_RAD)));
+			P.template bottomRightCorner<3, 3>().diagonal().setConstant(square(Real(noise.initialBias_dps * DEG_TO_RAD)));
+
+			lastMag.setZero();
+			tiltAligned = true;
+		}
+
+		/* q = Rz(angle) * q, a turn about the earth vertical */
+		void rotateHeading(Real angle)
+		{
+			Vector4 turn;
+			turn << Real(cos(angle * Real(0.5))), Real(0), Real(0), Real(sin(angle * Real(0.5)));
+			q = multiply(turn, q);
+		}
+	};
+}
+
+#endif
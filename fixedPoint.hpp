@@ -0,0 +1,257 @@
+#pragma once
+#ifndef SOAR_FIXED_POINT_HPP
+#define SOAR_FIXED_POINT_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <math.h>
+
+namespace SOAR_AHRS
+{
+	/**
+	* @brief Signed fixed point number in 32 bits, FracBits of them after the point
+	*
+	* Stands in for float in the scalar templated parts of the AHRS (MadgwickAHRST), so only
+	* the arithmetic those use is here. Products and quotients go through 64 bits and are
+	* rounded to nearest. Sums and differences wrap like the underlying integer instead of
+	* saturating: a long sum whose partial results leave the range still ends up right, as
+	* long as the final result is in range. Converting in from float/double saturates.
+	*
+	* @tparam FracBits  Fractional bits, 1 to 30. The range is +/-2^(31 - FracBits).
+	*/
+	template<int FracBits>
+	class Fixed
+	{
+	public:
+		static_assert((FracBits > 0) && (FracBits < 31), "Fixed needs at least one integer bit");
+
+		static const int32_t ONE = (int32_t)1 << FracBits;
+
+		Fixed() : raw(0) {}
+		explicit Fixed(float value) : raw(saturate(value * (float)ONE)) {}
+		explicit Fixed(double value) : raw(saturate(value * ONE)) {}
+		explicit Fixed(int value) : raw((int32_t)value << FracBits) {}
+
+		static Fixed fromRaw(int32_t raw)
+		{
+			Fixed f;
+			f.raw = raw;
+			return f;
+		}
+
+		int32_t toRaw() const { return raw; }
+
+		explicit operator float() const { return (float)raw * (1.0f / ONE); }
+		explicit operator double() const { return (double)raw * (1.0 / ONE); }
+
+		Fixed operator+(Fixed rhs) const { return fromRaw((int32_t)((uint32_t)raw + (uint32_t)rhs.raw)); }
+		Fixed operator-(Fixed rhs) const { return fromRaw((int32_t)((uint32_t)raw - (uint32_t)rhs.raw)); }
+		Fixed operator-() const { return fromRaw((int32_t)(0u - (uint32_t)raw)); }
+
+		Fixed operator*(Fixed rhs) const
+		{
+			return fromRaw((int32_t)(((int64_t)raw * rhs.raw + ((int64_t)1 << (FracBits - 1))) >> FracBits));
+		}
+
+		Fixed operator/(Fixed rhs) const
+		{
+			return fromRaw((int32_t)(((int64_t)raw << FracBits) / rhs.raw));
+		}
+
+		Fixed& operator+=(Fixed rhs) { return *this = *this + rhs; }
+		Fixed& operator-=(Fixed rhs) { return *this = *this - rhs; }
+		Fixed& operator*=(Fixed rhs) { return *this = *this * rhs; }
+
+		bool operator==(Fixed rhs) const { return raw == rhs.raw; }
+		bool operator!=(Fixed rhs) const { return raw != rhs.raw; }
+		bool operator<(Fixed rhs) const { return raw < rhs.raw; }
+		bool operator>(Fixed rhs) const { return raw > rhs.raw; }
+		bool operator<=(Fixed rhs) const { return raw <= rhs.raw; }
+		bool operator>=(Fixed rhs) const { return raw >= rhs.raw; }
+
+	private:
+		int32_t raw;
+
+		/* Separate float and double versions, so converting a float never goes through
+		* the software double routines on the target */
+		static int32_t saturate(float scaled)
+		{
+			if (scaled >= 2147483520.0f)
+				return INT32_MAX;
+			if (scaled <= -2147483648.0f)
+				return INT32_MIN;
+			return (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+		}
+
+		static int32_t saturate(double scaled)
+		{
+			if (scaled >= 2147483647.0)
+				return INT32_MAX;
+			if (scaled <= -2147483648.0)
+				return INT32_MIN;
+			return (int32_t)((scaled >= 0.0) ? (scaled + 0.5) : (scaled - 0.5));
+		}
+	};
+
+	/* Q15.16: the whole Madgwick range with room to spare, 1.5e-5 resolution */
+	typedef Fixed<16> Q16;
+
+	/* Q2.29: the most resolution (1.9e-9) a 32 bit word gives with the +/-2 the Madgwick
+	* intermediates need. A true Q31 has no integer bits, so it cannot hold them. */
+	typedef Fixed<29> Q29;
+
+
+	/*----------------------------------
+	* Integer Square Roots
+	*----------------------------------*/
+	/**
+	* @brief 1/sqrt(x) for x in [0.25, 4), both in Q2.30 (unsigned)
+	*
+	* A straight line guess on each octave, good to about 2.5%, then three Newton steps.
+	* Each step squares the error, so the result is good to the last bit of Q2.30.
+	*/
+	inline uint32_t invSqrtQ30(uint32_t x)
+	{
+		/* Octave of x, and 1/sqrt of the bottom of it (Q30) */
+		static const uint32_t octaveScale[4] = { 2147483648u, 1518500250u, 1073741824u, 759250125u };	/* 2, sqrt(2), 1, 1/sqrt(2) */
+		int octave = (x >= (1u << 31)) ? 3 : (x >= (1u << 30)) ? 2 : (x >= (1u << 29)) ? 1 : 0;
+
+		/* Mantissa in [1, 2), Q30 */
+		uint64_t m = (octave == 3) ? (x >> 1) : ((uint64_t)x << (2 - octave));
+
+		/* 1/sqrt(m) ~= 1.2735 - 0.2929m */
+		uint64_t guess = 1367410213u - ((314498980u * m) >> 30);
+		uint64_t y = (guess * octaveScale[octave]) >> 30;
+
+		for (int i = 0; i < 3; i++)
+		{
+			uint64_t ySq = (y * y) >> 30;
+			uint64_t halfTerm = (3ull << 30) - ((x * ySq) >> 30);
+			y = (y * halfTerm) >> 31;
+		}
+
+		return (uint32_t)y;
+	}
+
+	/**
+	* @brief Shift that brings a positive 64 bit value into [2^28, 2^32), always even so a
+	* square root can follow it by half as much
+	*
+	* @returns left shift (negative for right)
+	*/
+	inline int evenShiftQ30(uint64_t value)
+	{
+		int shift = 0;
+		while (value >= (1ull << 32))
+		{
+			value >>= 2;
+			shift -= 2;
+		}
+		while (value < (1ull << 28))
+		{
+			value <<= 2;
+			shift += 2;
+		}
+		return shift;
+	}
+
+	inline uint64_t shiftBy(uint64_t value, int shift)
+	{
+		return (shift >= 0) ? (value << shift) : (value >> -shift);
+	}
+
+
+	/*----------------------------------
+	* Scalar Math
+	*----------------------------------*/
+	/* The few functions the scalar templated code needs, for every type it runs in */
+	inline float squareRoot(float x) { return sqrtf(x); }
+	inline double squareRoot(double x) { return sqrt(x); }
+
+	template<int FracBits>
+	inline Fixed<FracBits> squareRoot(Fixed<FracBits> x)
+	{
+		int32_t raw = x.toRaw();
+		if (raw <= 0)
+			return Fixed<FracBits>();
+
+		/* sqrt(x) = x / sqrt(x), with x scaled into the range invSqrtQ30 takes. x is Q(FracBits),
+		* so in Q30 it is raw << (30 - FracBits), shifted on by an even amount. */
+		int shift = evenShiftQ30((uint64_t)raw << (30 - FracBits));
+		uint32_t y = invSqrtQ30((uint32_t)shiftBy((uint64_t)raw << (30 - FracBits), shift));
+
+		/* 1/sqrt(x) = y * 2^(shift / 2 - 30) */
+		return Fixed<FracBits>::fromRaw((int32_t)shiftBy((uint64_t)raw * y, shift / 2 - 30));
+	}
+
+	/**
+	* @brief Scales a 4 vector to unit length
+	* @returns false, leaving it alone, if it is all zeros
+	*/
+	template<typename Scalar>
+	inline bool normalize4(Scalar& a, Scalar& b, Scalar& c, Scalar& d)
+	{
+		Scalar norm = a * a + b * b + c * c + d * d;
+		if (!(norm > Scalar(0)))
+			return false;
+
+		Scalar recipNorm = Scalar(1) / squareRoot(norm);
+		a *= recipNorm;
+		b *= recipNorm;
+		c *= recipNorm;
+		d *= recipNorm;
+		return true;
+	}
+
+	/**
+	* @brief Fixed point normalize4()
+	*
+	* Squaring in the vector's own format would throw away the low half of every element, so
+	* the sum of squares is taken in 64 bits and the inverse root comes from invSqrtQ30(). A
+	* vector of tiny elements (a gradient near convergence) keeps its full direction.
+	*/
+	template<int FracBits>
+	inline bool normalize4(Fixed<FracBits>& a, Fixed<FracBits>& b, Fixed<FracBits>& c, Fixed<FracBits>& d)
+	{
+		Fixed<FracBits>* element[4] = { &a, &b, &c, &d };
+		int64_t v[4];
+		int64_t largest = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			v[i] = element[i]->toRaw();
+			largest |= (v[i] < 0) ? -v[i] : v[i];
+		}
+
+		if (largest == 0)
+			return false;
+
+		/* Four squares of 31 bits would overflow the sum. Dropping a bit from each element
+		* keeps the direction. */
+		if (largest >= (1 << 30))
+			for (int i = 0; i < 4; i++)
+				v[i] >>= 1;
+
+		uint64_t norm = 0;
+		for (int i = 0; i < 4; i++)
+			norm += (uint64_t)(v[i] * v[i]);
+
+		/* norm is Q(2 * FracBits). Shifted by an even amount it reads as a Q30 value in range
+		* for invSqrtQ30(), and 1/sqrt(norm) = y * 2^(FracBits + shift / 2 - 45) (Q0). */
+		int shift = evenShiftQ30(norm);
+		uint32_t y = invSqrtQ30((uint32_t)shiftBy(norm, shift));
+
+		int outShift = 45 - FracBits - shift / 2;
+		for (int i = 0; i < 4; i++)
+		{
+			int64_t scaled = v[i] * (int64_t)y;
+			if (outShift > 0)
+				scaled = (scaled + ((int64_t)1 << (outShift - 1))) >> outShift;
+			else
+				scaled <<= -outShift;
+			*element[i] = Fixed<FracBits>::fromRaw((int32_t)scaled);
+		}
+		return true;
+	}
+}
+
+#endif
@@ -0,0 +1,317 @@
+#include "format.hpp"
+
+/* C/C++ Includes */
+#include <string.h>
+
+namespace SOAR_SERIAL
+{
+	#define MAX_PRECISION	(10)
+	static const double rounders[MAX_PRECISION + 1] =
+	{
+		0.5,				// 0
+		0.05,				// 1
+		0.005,				// 2
+		0.0005,				// 3
+		0.00005,			// 4
+		0.000005,			// 5
+		0.0000005,			// 6
+		0.00000005,			// 7
+		0.000000005,		// 8
+		0.0000000005,		// 9
+		0.00000000005		// 10
+	};
+
+	char * ftoa(double f, char * buf, int precision)
+	{
+		char * ptr = buf;
+		char * p = ptr;
+		char * p1;
+		char c;
+		long intPart;
+
+		// check precision bounds
+		if (precision > MAX_PRECISION)
+			precision = MAX_PRECISION;
+
+		// sign stuff
+		if (f < 0)
+		{
+			f = -f;
+			*ptr++ = '-';
+		}
+
+		if (precision < 0)  // negative precision == automatic precision guess
+		{
+			if (f < 1.0) precision = 6;
+			else if (f < 10.0) precision = 5;
+			else if (f < 100.0) precision = 4;
+			else if (f < 1000.0) precision = 3;
+			else if (f < 10000.0) precision = 2;
+			else if (f < 100000.0) precision = 1;
+			else precision = 0;
+		}
+
+		// round value according the precision
+		if (precision)
+			f += rounders[precision];
+
+		// integer part...
+		intPart = f;
+		f -= intPart;
+
+		if (!intPart)
+			*ptr++ = '0';
+		else
+		{
+			// save start pointer
+			p = ptr;
+
+			// convert (reverse order)
+			while (intPart)
+			{
+				*p++ = '0' + intPart % 10;
+				intPart /= 10;
+			}
+
+			// save end pos
+			p1 = p;
+
+			// reverse result
+			while (p > ptr)
+			{
+				c = *--p;
+				*p = *ptr;
+				*ptr++ = c;
+			}
+
+			// restore end pos
+			ptr = p1;
+		}
+
+		// decimal part
+		if (precision)
+		{
+			// place decimal point
+			*ptr++ = '.';
+
+			// convert
+			while (precision--)
+			{
+				f *= 10.0;
+				c = f;
+				*ptr++ = '0' + c;
+				f -= c;
+			}
+		}
+
+		// terminating zero
+		*ptr = 0;
+
+		return buf;
+	}
+
+	static const int32_t powersOfTen[10] =
+	{
+		1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+	};
+
+	size_t formatUnsigned(char* out, uint32_t value)
+	{
+		char digits[10];
+		int count = 0;
+
+		// convert (reverse order)
+		do
+		{
+			digits[count++] = '0' + (value % 10);
+			value /= 10;
+		} while (value);
+
+		for (int i = 0; i < count; i++)
+			out[i] = digits[count - 1 - i];
+
+		return count;
+	}
+
+	size_t formatFixed(char* out, float value, int precision)
+	{
+		char* ptr = out;
+
+		if (precision < 0)
+			precision = 0;
+		else if (precision > 9)
+			precision = 9;
+
+		// sign stuff
+		if (value < 0.0f)
+		{
+			value = -value;
+			*ptr++ = '-';
+		}
+
+		// split into integer part and a 0.32 fixed point fraction, both exact for any float
+		uint32_t intPart = 0xFFFFFFFFu;
+		uint64_t fraction = 0;
+
+		if (value < 4294967040.0f)
+		{
+			intPart = (uint32_t)value;
+			fraction = (uint64_t)((value - (float)intPart) * 4294967296.0f);
+		}
+
+		// round the fraction to the requested number of decimals
+		uint32_t scale = powersOfTen[precision];
+		uint32_t decimals = (uint32_t)((fraction * scale + 0x80000000u) >> 32);
+
+		if ((decimals >= scale) && (intPart != 0xFFFFFFFFu))
+		{
+			decimals -= scale;
+			intPart++;
+		}
+
+		// integer part
+		ptr += formatUnsigned(ptr, intPart);
+
+		// decimal part, zero padded
+		if (precision)
+		{
+			*ptr++ = '.';
+			for (int i = precision - 1; i >= 0; i--)
+			{
+				ptr[i] = '0' + (decimals % 10);
+				decimals /= 10;
+			}
+			ptr += precision;
+		}
+
+		return ptr - out;
+	}
+
+	size_t formatAHRSLine(const AHRSData_t& data, char* line)
+	{
+		const int precision = 2;
+
+		/* The only place the firmware needs Euler angles, at the console rate */
+		Eigen::Vector3f euler;
+		data.eulerDeg(euler);
+
+		const float* fields[9] =
+		{
+			&euler(0), &euler(1), &euler(2),
+			&data.accel(0), &data.accel(1), &data.accel(2),
+			&data.gyro(0), &data.gyro(1), &data.gyro(2)
+		};
+
+		char* ptr = line;
+		for (int i = 0; i < 9; i++)
+		{
+			ptr += formatFixed(ptr, *fields[i], precision);
+			*ptr++ = (i < 8) ? ',' : '\r';
+		}
+
+		*ptr++ = '\n';
+		*ptr = 0;
+
+		return ptr - line;
+	}
+
+	/* Writes a 0.1% count as a percentage with one decimal */
+	static size_t formatPermille(char* out, uint16_t permille)
+	{
+		char* ptr = out;
+		ptr += formatUnsigned(ptr, permille / 10);
+		*ptr++ = '.';
+		*ptr++ = '0' + (permille % 10);
+		return ptr - out;
+	}
+
+	size_t formatRuntimeLine(const RuntimeStats_t& stats, char* line)
+	{
+		static const char prefix[] = "#stats,";
+		uint8_t count = (stats.taskCount > RUNTIME_STATS_MAX_TASKS) ? RUNTIME_STATS_MAX_TASKS : stats.taskCount;
+
+		char* ptr = line;
+		memcpy(ptr, prefix, sizeof(prefix) - 1);
+		ptr += sizeof(prefix) - 1;
+
+		ptr += formatUnsigned(ptr, stats.timestamp_mS);
+		*ptr++ = ',';
+		ptr += formatUnsigned(ptr, stats.window_mS);
+		*ptr++ = ',';
+		ptr += formatPermille(ptr, stats.idle_permille);
+		*ptr++ = ',';
+		ptr += formatUnsigned(ptr, stats.freeHeap_bytes);
+
+		for (uint8_t i = 0; i < count; i++)
+		{
+			const TaskRuntime_t& task = stats.tasks[i];
+
+			*ptr++ = ',';
+			for (int c = 0; (c < RUNTIME_TASK_NAME_LEN) && task.name[c]; c++)
+				*ptr++ = (task.name[c] == ',') ? ' ' : task.name[c];
+			*ptr++ = ',';
+			ptr += formatPermille(ptr, task.cpu_permille);
+			*ptr++ = ',';
+			ptr += formatUnsigned(ptr, task.stackFree_words);
+		}
+
+		*ptr++ = '\r';
+		*ptr++ = '\n';
+		*ptr = 0;
+
+		return ptr - line;
+	}
+
+	size_t formatTraceLine(const SOAR_PROFILE::TraceSummary& summary, uint32_t dropped, char* line)
+	{
+		static const char prefix[] = "#trace,";
+		const uint32_t fields[6] = { summary.count, summary.min_nS, summary.avg_nS, summary.max_nS, summary.p99_nS, dropped };
+
+		char* ptr = line;
+		memcpy(ptr, prefix, sizeof(prefix) - 1);
+		ptr += sizeof(prefix) - 1;
+
+		const char* name = SOAR_PROFILE::traceStageName(summary.stage);
+		for (int c = 0; (c < 16) && name[c]; c++)
+			*ptr++ = name[c];
+
+		for (int i = 0; i < 6; i++)
+		{
+			*ptr++ = ',';
+			ptr += formatUnsigned(ptr, fields[i]);
+		}
+
+		*ptr++ = '\r';
+		*ptr++ = '\n';
+		*ptr = 0;
+
+		return ptr - line;
+	}
+
+	size_t formatBootLine(const BootTiming_t& timing, char* line)
+	{
+		static const char prefix[] = "#boot";
+		const uint32_t fields[4] = { timing.scheduler_uS, timing.imuReady_uS, timing.tasksResumed_uS, timing.firstOutput_uS };
+
+		char* ptr = line;
+		memcpy(ptr, prefix, sizeof(prefix) - 1);
+		ptr += sizeof(prefix) - 1;
+
+		for (int i = 0; i < 4; i++)
+		{
+			*ptr++ = ',';
+			ptr += formatUnsigned(ptr, fields[i]);
+		}
+
+		*ptr++ = ',';
+		const char* name = calibrationStatusName(timing.calibration);
+		for (int c = 0; (c < 7) && name[c]; c++)
+			*ptr++ = name[c];
+
+		*ptr++ = '\r';
+		*ptr++ = '\n';
+		*ptr = 0;
+
+		return ptr - line;
+	}
+}
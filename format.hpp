@@ -0,0 +1,129 @@
+#pragma once
+#ifndef SOAR_FORMAT_HPP
+#define SOAR_FORMAT_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <memory>
+#include <cstdio>
+
+/* Project Includes */
+#include "dataTypes.hpp"
+#include "trace.hpp"
+
+namespace SOAR_SERIAL
+{
+	/* Formatter to output as std::string...much easier to use */
+	template<typename ... Args>
+	std::string stringFormat(const std::string& format, Args ... args)
+	{
+		size_t size = std::snprintf(nullptr, 0, format.c_str(), args ...) + 1; //Extra space for '\0'
+
+		std::unique_ptr<char[]> buf(new char[size]);
+
+		std::snprintf(buf.get(), size, format.c_str(), args ...);
+		return std::string(buf.get(), buf.get() + size - 1); //Exclude the '\0'
+	}
+
+	/* Float to string conversion using double precision math */
+	extern char * ftoa(double f, char * buf, int precision);
+
+
+	/*----------------------------------
+	* Allocation free formatting
+	*----------------------------------*/
+	/* Longest field formatFixed() can produce: sign, 10 integer digits, '.', 9 decimals */
+	const size_t MAX_FIXED_FIELD_SIZE = 21;
+
+	/* Longest line formatAHRSLine() can produce, including the terminating '\0' */
+	const size_t AHRS_LINE_SIZE = 9 * MAX_FIXED_FIELD_SIZE + 8 + 3;
+
+	/* Longest field formatUnsigned() can produce */
+	const size_t MAX_UNSIGNED_FIELD_SIZE = 10;
+
+	/* Longest line formatRuntimeLine() can produce, including the terminating '\0' */
+	const size_t RUNTIME_LINE_SIZE = 7 + 4 * MAX_UNSIGNED_FIELD_SIZE + 3 + 3 +
+		RUNTIME_STATS_MAX_TASKS * (RUNTIME_TASK_NAME_LEN + MAX_UNSIGNED_FIELD_SIZE + 7) + 3;
+
+	/* Longest line formatTraceLine() can produce, including the terminating '\0' */
+	const size_t TRACE_LINE_SIZE = 7 + 16 + 6 * (MAX_UNSIGNED_FIELD_SIZE + 1) + 3;
+
+	/* Longest line formatBootLine() can produce, including the terminating '\0' */
+	const size_t BOOT_LINE_SIZE = 6 + 4 * (MAX_UNSIGNED_FIELD_SIZE + 1) + 8 + 3;
+
+	/**
+	* @brief Writes an unsigned integer in decimal. No terminating '\0' is written.
+	*
+	* @param [out] out      Destination, must hold MAX_UNSIGNED_FIELD_SIZE characters
+	* @param [in]  value    Value to convert
+	* @returns Number of characters written
+	*/
+	extern size_t formatUnsigned(char* out, uint32_t value);
+
+	/**
+	* @brief Writes a float with a fixed number of decimals using only integer math
+	*
+	* The value is split into an integer part and a 0.32 fixed point fraction, which is then
+	* rounded half away from zero to the requested decimals. Output matches ftoa() apart from
+	* exact binary ties; magnitudes beyond the uint32 range saturate. No terminating '\0' is
+	* written.
+	*
+	* @param [out] out          Destination, must hold MAX_FIXED_FIELD_SIZE characters
+	* @param [in]  value        Value to convert
+	* @param [in]  precision    Number of decimals, 0 to 9
+	* @returns Number of characters written
+	*/
+	extern size_t formatFixed(char* out, float value, int precision);
+
+	/**
+	* @brief Writes the serialTask CSV line for one sample
+	*
+	* Produces "pitch,roll,yaw,ax,ay,az,gx,gy,gz\r\n" with two decimals, identical to the
+	* ftoa + std::string assembly it replaces, without touching the heap.
+	*
+	* @param [in]  data     Sample to print
+	* @param [out] line     Destination, must hold AHRS_LINE_SIZE characters
+	* @returns Length of the line, excluding the terminating '\0'
+	*/
+	extern size_t formatAHRSLine(const AHRSData_t& data, char* line);
+
+	/**
+	* @brief Writes a run time stats record as a CSV line
+	*
+	* Produces "#stats,timestamp,window,idle%,heap,name,cpu%,stack,..." with one name/cpu/stack
+	* triple per task. The leading '#' lets CSV consumers tell these apart from sample lines.
+	*
+	* @param [in]  stats    Stats to print
+	* @param [out] line     Destination, must hold RUNTIME_LINE_SIZE characters
+	* @returns Length of the line, excluding the terminating '\0'
+	*/
+	extern size_t formatRuntimeLine(const RuntimeStats_t& stats, char* line);
+
+	/**
+	* @brief Writes one stage of a trace dump as a CSV line
+	*
+	* Produces "#trace,stage,count,min,avg,max,p99,dropped" with the durations in nS.
+	*
+	* @param [in]  summary  Stage summary
+	* @param [in]  dropped  Trace events lost so far
+	* @param [out] line     Destination, must hold TRACE_LINE_SIZE characters
+	* @returns Length of the line, excluding the terminating '\0'
+	*/
+	extern size_t formatTraceLine(const SOAR_PROFILE::TraceSummary& summary, uint32_t dropped, char* line);
+
+	/**
+	* @brief Writes the boot timeline as a CSV line
+	*
+	* Produces "#boot,scheduler,imuReady,tasksResumed,firstOutput,calibration" with the
+	* milestones in uS and the calibration as a name ("loaded", "missing", ...).
+	*
+	* @param [in]  timing   Boot timeline
+	* @param [out] line     Destination, must hold BOOT_LINE_SIZE characters
+	* @returns Length of the line, excluding the terminating '\0'
+	*/
+	extern size_t formatBootLine(const BootTiming_t& timing, char* line);
+}
+
+#endif
@@ -0,0 +1,259 @@
+/**
+Host side replay of the AHRS filter chain.
+
+Feeds a recorded log through SOAR_AHRS::FilterChain as fast as possible and reports the
+throughput and per-sample latency distribution. Samples are read through a sensor source
+(sensors.hpp), the same interface ahrsTask uses, so the timed region covers the source read
+and the filter chain. Built on a Linux workstation with the same Eigen and Kalman headers the
+firmware uses:
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/ahrs_replay.cpp ahrsFilter.cpp magCalibration.cpp -o ahrs_replay
+
+Adding -DAHRS_TRACE_ENABLED=1 and trace.cpp also prints the per-stage histograms.
+
+Logs are CSV, columnar logs from serial_record if the name ends in ".col", or raw ReplayRecord
+arrays if it ends in ".bin" (--save-bin writes one).
+With --synthetic the input is N samples of SyntheticSource motion instead, and the attitude
+error against the known truth is reported as well. --mag-distortion adds a fixed hard and
+soft iron error to the synthetic magnetometer, and --mag-cal runs every mag reading through
+the online calibrator (magCalibration.hpp) the way ahrsTask does.
+
+Usage:
+	ahrs_replay <log.csv|log.col|log.bin> [--repeat N] [--out filtered.csv] [--save-bin log.bin] [--mag-cal]
+	ahrs_replay --synthetic N [--out filtered.csv] [--mag-distortion] [--mag-cal]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <cmath>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "sensors.hpp"
+#include "magCalibration.hpp"
+#include "trace.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+
+using namespace SOAR_HOST;
+using namespace SOAR_AHRS;
+
+/* Called after every sample, for sources that can check the output */
+struct NoCheck
+{
+	template<typename Source>
+	void operator()(const Source&, const AHRSData_t&) {}
+};
+
+/* Accumulates the attitude error against SyntheticSource's truth */
+struct TruthCheck
+{
+	TruthCheck() : count(0), settle(AHRS_SAMPLE_RATE_HZ * 5), maxError(0.0f) { sumSq.setZero(); }
+
+	template<typename Source>
+	void operator()(const Source& source, AHRSData_t& output)
+	{
+		/* Give the filter time to converge from the identity attitude */
+		if (settle > 0)
+		{
+			settle--;
+			return;
+		}
+
+		Eigen::Vector3f truth, error;
+		source.truthEulerDeg(truth);
+		error = output.eulerDeg() - truth;
+		error(2) = fmodf(error(2) + 540.0f, 360.0f) - 180.0f;
+
+		sumSq += error.cwiseProduct(error).cast<double>();
+		maxError = std::max(maxError, error.cwiseAbs().maxCoeff());
+		count++;
+	}
+
+	size_t count;
+	size_t settle;
+	Eigen::Vector3d sumSq;
+	float maxError;
+};
+
+/* Runs count samples from the source through the filter chain, timing each one. magCal may be NULL. */
+template<typename Source, typename Check>
+static double run(Source& source, std::vector<AHRSData_t>& output, std::vector<uint64_t>& latencies_nS, Check& check,
+	MagCalibrator* magCal)
+{
+	static_assert(IsSensorSource<Source>::value, "ahrs_replay needs a sensor source");
+
+	FilterChain filter;
+	Eigen::Vector3f accel, gyro, mag;
+
+	Clock::time_point runStart = Clock::now();
+	for (size_t n = 0; n < output.size(); n++)
+	{
+		Clock::time_point start = Clock::now();
+		source.readInertial(accel, gyro);
+		source.readMag(mag);
+		if (magCal)
+		{
+			magCal->addSample(mag);
+			magCal->apply(mag);
+		}
+		filter.step(accel, gyro, mag, output[n]);
+		latencies_nS[n] = elapsed_nS(start, Clock::now());
+
+		check(source, output[n]);
+
+		#if (AHRS_TRACE_ENABLED)
+		SOAR_PROFILE::traceDrain();
+		#endif
+	}
+	return elapsed_nS(runStart, Clock::now()) * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <log.csv|log.col|log.bin> [--repeat N] [--out filtered.csv] [--save-bin log.bin] [--mag-cal]\n"
+			"       %s --synthetic N [--out filtered.csv] [--mag-distortion] [--mag-cal]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	std::string logPath;
+	std::string outPath;
+	std::string binPath;
+	int repeat = 1;
+	size_t synthetic = 0;
+	bool magDistortion = false;
+	bool useMagCal = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--out") && (i + 1 < argc))
+			outPath = argv[++i];
+		else if (!strcmp(argv[i], "--save-bin") && (i + 1 < argc))
+			binPath = argv[++i];
+		else if (!strcmp(argv[i], "--synthetic") && (i + 1 < argc))
+			synthetic = (size_t)std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--mag-distortion"))
+			magDistortion = true;
+		else if (!strcmp(argv[i], "--mag-cal"))
+			useMagCal = true;
+		else if (logPath.empty())
+			logPath = argv[i];
+	}
+
+	/* Keep the whole output in memory so file I/O never lands inside the timed region */
+	std::vector<AHRSData_t> output;
+	std::vector<uint64_t> latencies_nS;
+	double runTime_S = 0.0;
+	MagCalibrator magCal;
+	MagCalibrator* magCalPtr = useMagCal ? &magCal : NULL;
+
+	if (synthetic)
+	{
+		output.resize(synthetic);
+		latencies_nS.resize(synthetic);
+
+		SyntheticMotion motion;
+		if (magDistortion)
+		{
+			/* Typical of a board with a battery and steel screws nearby */
+			motion.hardIron_G << 0.12f, -0.08f, 0.2f;
+			motion.softIron <<
+				1.10f, 0.05f, -0.03f,
+				0.05f, 0.92f, 0.04f,
+				-0.03f, 0.04f, 1.02f;
+			motion.magNoise_G = 0.004f;
+		}
+
+		SyntheticSource<> source(motion);
+		TruthCheck check;
+		runTime_S = run(source, output, latencies_nS, check, magCalPtr);
+
+		if (check.count)
+			printf("attitude error vs truth (deg rms): pitch %.3f  roll %.3f  yaw %.3f  max %.3f\n",
+				sqrt(check.sumSq(0) / check.count), sqrt(check.sumSq(1) / check.count),
+				sqrt(check.sumSq(2) / check.count), check.maxError);
+	}
+	else
+	{
+		std::vector<ReplayRecord> records;
+		std::string error;
+		if (!loadReplayLog(logPath, records, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+
+		if (!binPath.empty() && !saveReplayLog(binPath, records))
+		{
+			fprintf(stderr, "could not write %s\n", binPath.c_str());
+			return 1;
+		}
+
+		output.resize(records.size() * repeat);
+		latencies_nS.resize(output.size());
+
+		ReplaySource<> source(records.data(), records.size());
+		NoCheck check;
+		runTime_S = run(source, output, latencies_nS, check, magCalPtr);
+	}
+
+	LatencySummary stats = summarize(latencies_nS);
+
+	printf("samples:      %zu\n", output.size());
+	printf("total time:   %.3f ms\n", runTime_S * 1e3);
+	printf("throughput:   %.0f samples/s\n", output.size() / runTime_S);
+	printf("latency (us): min %.3f  mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+		stats.min_nS * 1e-3, stats.mean_nS * 1e-3, stats.p50_nS * 1e-3, stats.p90_nS * 1e-3,
+		stats.p99_nS * 1e-3, stats.p999_nS * 1e-3, stats.max_nS * 1e-3);
+
+	if (useMagCal)
+	{
+		const Eigen::Vector3f& h = magCal.hardIron();
+		printf("mag cal:      %s, %u accepted, %u rejected, field %.3f G, residual %.4f, hard iron (%.3f %.3f %.3f) G\n",
+			magCal.calibrated() ? "calibrated" : "uncalibrated", magCal.accepted(), magCal.rejected(),
+			magCal.fieldStrength(), magCal.residual(), h(0), h(1), h(2));
+	}
+
+	#if (AHRS_TRACE_ENABLED)
+	printf("\n%-12s %10s %10s %10s %10s %10s  (nS)\n", "stage", "count", "min", "avg", "max", "p99");
+	for (uint8_t stage = 0; stage < SOAR_PROFILE::TRACE_STAGE_COUNT; stage++)
+	{
+		SOAR_PROFILE::TraceSummary t;
+		SOAR_PROFILE::traceSummary(stage, t);
+		if (t.count)
+			printf("%-12s %10u %10u %10u %10u %10u\n", SOAR_PROFILE::traceStageName(stage),
+				t.count, t.min_nS, t.avg_nS, t.max_nS, t.p99_nS);
+	}
+	printf("\n");
+	#endif
+
+	if (!outPath.empty())
+	{
+		FILE* out = fopen(outPath.c_str(), "w");
+		if (!out)
+		{
+			fprintf(stderr, "could not open %s\n", outPath.c_str());
+			return 1;
+		}
+
+		fprintf(out, "pitch (deg),roll (deg),yaw (deg),ax (m/s^2),ay (m/s^2),az (m/s^2),gx (deg/s),gy (deg/s),gz (deg/s)\n");
+		for (size_t n = 0; n < output.size(); n++)
+		{
+			AHRSData_t& d = output[n];
+			fprintf(out, "%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+				d.pitch(), d.roll(), d.yaw(), d.ax(), d.ay(), d.az(), d.gx(), d.gy(), d.gz());
+		}
+		fclose(out);
+	}
+
+	return 0;
+}
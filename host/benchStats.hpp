@@ -0,0 +1,61 @@
+#pragma once
+#ifndef SOAR_HOST_BENCH_STATS_HPP
+#define SOAR_HOST_BENCH_STATS_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+namespace SOAR_HOST
+{
+	typedef std::chrono::steady_clock Clock;
+
+	inline uint64_t elapsed_nS(const Clock::time_point& start, const Clock::time_point& stop)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+	}
+
+	/* Summary of a set of per-sample latencies */
+	struct LatencySummary
+	{
+		uint64_t min_nS;
+		uint64_t p50_nS;
+		uint64_t p90_nS;
+		uint64_t p99_nS;
+		uint64_t p999_nS;
+		uint64_t max_nS;
+		double mean_nS;
+	};
+
+	/**
+	* @brief Sorts the given latencies in place and pulls out the percentiles
+	*
+	* @param [in] latencies_nS   Per-sample latencies; must not be empty
+	* @returns Summary statistics
+	*/
+	inline LatencySummary summarize(std::vector<uint64_t>& latencies_nS)
+	{
+		LatencySummary s;
+		std::sort(latencies_nS.begin(), latencies_nS.end());
+
+		const size_t n = latencies_nS.size();
+		auto pct = [&](double p) { return latencies_nS[std::min(n - 1, (size_t)(p * (n - 1) + 0.5))]; };
+
+		double sum = 0.0;
+		for (size_t i = 0; i < n; i++)
+			sum += latencies_nS[i];
+
+		s.min_nS = latencies_nS.front();
+		s.p50_nS = pct(0.50);
+		s.p90_nS = pct(0.90);
+		s.p99_nS = pct(0.99);
+		s.p999_nS = pct(0.999);
+		s.max_nS = latencies_nS.back();
+		s.mean_nS = sum / n;
+		return s;
+	}
+}
+
+#endif
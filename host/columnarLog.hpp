@@ -0,0 +1,188 @@
+#pragma once
+#ifndef SOAR_HOST_COLUMNAR_LOG_HPP
+#define SOAR_HOST_COLUMNAR_LOG_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+namespace SOAR_HOST
+{
+	/*----------------------------------
+	* Columnar Log Format
+	*----------------------------------*/
+	/*
+	* A header, then blocks of rows stored column by column, all little endian:
+	*
+	*	char     magic[8]                "SOARCOL1"
+	*	uint32   columns
+	*	uint32   reserved                0
+	*	char     names[columns][16]      '\0' padded, as in the CSV header ("pitch (deg)")
+	*
+	*	uint32   rows                    repeated until the end of the file
+	*	float    values[columns][rows]
+	*
+	* Blocks can be any length, so a writer can close one off whenever it likes and a file
+	* cut short by a crash loses at most the block being written.
+	*/
+	static const char COLUMNAR_MAGIC[8] = { 'S', 'O', 'A', 'R', 'C', 'O', 'L', '1' };
+	static const size_t COLUMNAR_NAME_LEN = 16;
+
+	/**
+	* @brief Streams rows of floats to a columnar log in blocks
+	*
+	* All memory is taken in open(), so a recording of any length uses blockRows * columns
+	* floats.
+	*/
+	class ColumnarWriter
+	{
+	public:
+		ColumnarWriter() : file(nullptr), columns(0), blockRows(0), pending(0), written(0) {}
+		~ColumnarWriter() { close(); }
+
+		/**
+		* @brief Creates the file and writes its header
+		*
+		* @param [in] path       File to create
+		* @param [in] names      Column names, truncated to COLUMNAR_NAME_LEN - 1 characters
+		* @param [in] blockRows  Rows buffered before a block is written
+		*/
+		bool open(const std::string& path, const std::vector<std::string>& names, size_t blockRows)
+		{
+			file = fopen(path.c_str(), "wb");
+			if (!file)
+				return false;
+
+			columns = (uint32_t)names.size();
+			this->blockRows = blockRows;
+			block.assign(columns * blockRows, 0.0f);
+			pending = 0;
+			written = 0;
+
+			uint32_t reserved = 0;
+			bool ok = (fwrite(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC), 1, file) == 1) &&
+				(fwrite(&columns, sizeof(columns), 1, file) == 1) &&
+				(fwrite(&reserved, sizeof(reserved), 1, file) == 1);
+
+			for (size_t i = 0; ok && (i < names.size()); i++)
+			{
+				char name[COLUMNAR_NAME_LEN] = {};
+				strncpy(name, names[i].c_str(), COLUMNAR_NAME_LEN - 1);
+				ok = (fwrite(name, sizeof(name), 1, file) == 1);
+			}
+
+			return ok;
+		}
+
+		/* Adds one row of columns() values, writing out the block once it is full */
+		bool append(const float* row)
+		{
+			for (uint32_t c = 0; c < columns; c++)
+				block[c * blockRows + pending] = row[c];
+
+			pending++;
+			return (pending < blockRows) || flush();
+		}
+
+		/* Writes the rows buffered so far as a block of their own */
+		bool flush()
+		{
+			if (!file || (pending == 0))
+				return true;
+
+			uint32_t rows = (uint32_t)pending;
+			bool ok = (fwrite(&rows, sizeof(rows), 1, file) == 1);
+			for (uint32_t c = 0; ok && (c < columns); c++)
+				ok = (fwrite(&block[c * blockRows], sizeof(float), pending, file) == pending);
+
+			written += pending;
+			pending = 0;
+			return ok && (fflush(file) == 0);
+		}
+
+		bool close()
+		{
+			if (!file)
+				return true;
+
+			bool ok = flush();
+			ok = (fclose(file) == 0) && ok;
+			file = nullptr;
+			return ok;
+		}
+
+		uint32_t columnCount() const { return columns; }
+		uint64_t rows() const { return written + pending; }
+
+	private:
+		FILE* file;
+		uint32_t columns;
+		size_t blockRows;
+		std::vector<float> block;		/* Column c of the block at c * blockRows */
+		size_t pending;
+		uint64_t written;
+	};
+
+	/**
+	* @brief Reads a whole columnar log into memory
+	*
+	* @param [out] names    Column names
+	* @param [out] values   One vector per column
+	* @returns false if the file is missing or not a columnar log. A truncated last block is dropped.
+	*/
+	inline bool loadColumnarLog(const std::string& path, std::vector<std::string>& names,
+		std::vector<std::vector<float> >& values, std::string& error)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+		{
+			error = "could not open " + path;
+			return false;
+		}
+
+		char magic[8];
+		uint32_t columns = 0, reserved = 0;
+		if ((fread(magic, sizeof(magic), 1, file) != 1) || memcmp(magic, COLUMNAR_MAGIC, sizeof(magic)) ||
+			(fread(&columns, sizeof(columns), 1, file) != 1) || (fread(&reserved, sizeof(reserved), 1, file) != 1))
+		{
+			fclose(file);
+			error = path + " is not a columnar log";
+			return false;
+		}
+
+		names.clear();
+		values.assign(columns, std::vector<float>());
+		for (uint32_t c = 0; c < columns; c++)
+		{
+			char name[COLUMNAR_NAME_LEN];
+			if (fread(name, sizeof(name), 1, file) != 1)
+			{
+				fclose(file);
+				error = path + " has a truncated header";
+				return false;
+			}
+			name[COLUMNAR_NAME_LEN - 1] = '\0';
+			names.push_back(name);
+		}
+
+		uint32_t rows;
+		std::vector<float> block;
+		while (fread(&rows, sizeof(rows), 1, file) == 1)
+		{
+			block.resize((size_t)rows * columns);
+			if (fread(block.data(), sizeof(float), block.size(), file) != block.size())
+				break;
+
+			for (uint32_t c = 0; c < columns; c++)
+				values[c].insert(values[c].end(), block.begin() + (size_t)c * rows, block.begin() + (size_t)(c + 1) * rows);
+		}
+
+		fclose(file);
+		return true;
+	}
+}
+
+#endif
@@ -0,0 +1,254 @@
+/**
+Host comparison of the fixed rate and variable dt orientation updates.
+
+The fixed rate path assumes every sample is exactly 1/AHRS_SAMPLE_RATE_HZ apart and runs the
+Madgwick filter AHRS_UPDATE_RATE_MULTIPLIER times per sample. The variable dt path integrates
+the measured time between samples in one step (more only when a sample is late). Both are
+scored against a reference that integrates the true dt in 64 small steps.
+
+The true sample times come from the log's timestamp column when it has one. Otherwise the
+nominal period is perturbed with --jitter (fraction of a period, uniform) and --late
+(probability that a sample arrives one period late), the way a busy ahrsTask would see it.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/dt_compare.cpp ahrsFilter.cpp -o dt_compare
+
+Usage:
+	dt_compare <log.csv> [--repeat N] [--jitter F] [--late P] [--seed S]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "orientation.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+
+using namespace SOAR_AHRS;
+using namespace SOAR_HOST;
+
+static const int referenceSteps = 64;
+
+/* Smoothed input to the orientation stage, shared by every variant so only integration differs */
+struct OrientationInput
+{
+	Eigen::Vector3f accel;
+	Eigen::Vector3f gyro;
+	Eigen::Vector3f mag;
+	float dt;
+};
+
+struct OrientationResult
+{
+	std::vector<Eigen::Vector4f> attitude;
+	double nS_perSample;
+	double stepsPerSample;
+};
+
+/* Angle between two attitude quaternions (deg) */
+static float attitudeError(const Eigen::Vector4f& a, const Eigen::Vector4f& b)
+{
+	float dot = fabsf(a.dot(b));
+	return 2.0f * acosf(dot > 1.0f ? 1.0f : dot) * RAD_TO_DEG;
+}
+
+/* Runs the orientation stage over the inputs. steps == 0 picks the adaptive count FilterChainT
+* uses, with the longest step limited to 1/maxStepHz. */
+static OrientationResult runOrientation(const std::vector<OrientationInput>& input, bool useNominalDt, int steps,
+	float maxStepHz = AHRS_MAX_STEP_HZ)
+{
+	const float nominalDt = 1.0f / AHRS_SAMPLE_RATE_HZ;
+
+	OrientationResult result;
+	result.attitude.resize(input.size());
+
+	MadgwickAHRS ahrs(10.0f);
+	uint64_t totalSteps = 0;
+
+	Clock::time_point start = Clock::now();
+	for (size_t n = 0; n < input.size(); n++)
+	{
+		const OrientationInput& in = input[n];
+		const float dt = useNominalDt ? nominalDt : in.dt;
+
+		int count = steps;
+		if (count == 0)
+		{
+			count = (int)(dt * maxStepHz + 0.5f);
+			count = (count < 1) ? 1 : ((count > AHRS_MAX_SUBSTEPS) ? AHRS_MAX_SUBSTEPS : count);
+		}
+
+		for (int i = 0; i < count; i++)
+			ahrs.update(in.accel, in.gyro, in.mag, dt / count);
+
+		totalSteps += count;
+		result.attitude[n] = ahrs.quaternion();
+	}
+
+	result.nS_perSample = (double)elapsed_nS(start, Clock::now()) / input.size();
+	result.stepsPerSample = (double)totalSteps / input.size();
+	return result;
+}
+
+static void report(const char* name, const OrientationResult& r, const OrientationResult& reference, size_t settle)
+{
+	double sumSq = 0.0;
+	float maxError = 0.0f;
+
+	for (size_t n = settle; n < r.attitude.size(); n++)
+	{
+		float e = attitudeError(r.attitude[n], reference.attitude[n]);
+		sumSq += (double)e * e;
+		maxError = std::max(maxError, e);
+	}
+
+	size_t count = r.attitude.size() - settle;
+	printf("%-28s %8.1f ns/sample  %5.2f steps/sample  error rms %7.3f deg  max %7.3f deg\n",
+		name, r.nS_perSample, r.stepsPerSample, count ? sqrt(sumSq / count) : 0.0, maxError);
+}
+
+/* End to end FilterChain cost for each path */
+template<bool VariableDt>
+static double runChain(const std::vector<LogSample>& samples, const std::vector<float>& dt, size_t steps)
+{
+	FilterChain filter;
+	AHRSData_t output;
+	float sink = 0.0f;
+
+	Clock::time_point start = Clock::now();
+	for (size_t n = 0; n < steps; n++)
+	{
+		const LogSample& s = samples[n % samples.size()];
+
+		if (VariableDt)
+			filter.step(s.accel, s.gyro, s.mag, dt[n], output);
+		else
+			filter.step(s.accel, s.gyro, s.mag, output);
+
+		sink += output.pitch();
+	}
+	double nS = (double)elapsed_nS(start, Clock::now()) / steps;
+
+	/* Keep the optimizer from dropping the loop */
+	if (sink == 12345.0f)
+		printf(" ");
+
+	return nS;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <log.csv> [--repeat N] [--jitter F] [--late P] [--seed S]\n", argv[0]);
+		return 1;
+	}
+
+	int repeat = 20;
+	float jitter = 0.2f;
+	float late = 0.02f;
+	unsigned seed = 1;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--jitter") && (i + 1 < argc))
+			jitter = strtof(argv[++i], nullptr);
+		else if (!strcmp(argv[i], "--late") && (i + 1 < argc))
+			late = strtof(argv[++i], nullptr);
+		else if (!strcmp(argv[i], "--seed") && (i + 1 < argc))
+			seed = (unsigned)atoi(argv[++i]);
+	}
+
+	std::vector<LogSample> samples;
+	std::string error;
+	if (!loadCSVLog(argv[1], samples, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	/*----------------------------
+	* True time between samples
+	*---------------------------*/
+	const float nominalDt = 1.0f / AHRS_SAMPLE_RATE_HZ;
+	const size_t total = samples.size() * repeat;
+	const bool timed = (samples.size() > 1) && (samples[0].time_S >= 0.0);
+
+	std::vector<float> dt(total);
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	std::bernoulli_distribution isLate(late);
+
+	for (size_t n = 0; n < total; n++)
+	{
+		size_t i = n % samples.size();
+		if (timed && i > 0)
+			dt[n] = (float)(samples[i].time_S - samples[i - 1].time_S);
+		else if (timed)
+			dt[n] = nominalDt;
+		else
+			dt[n] = nominalDt * (1.0f + jitter * uniform(rng) + (isLate(rng) ? 1.0f : 0.0f));
+	}
+
+	printf("samples: %zu  nominal dt %.3f ms  dt source: %s\n", total, nominalDt * 1e3f,
+		timed ? "log timestamps" : "synthetic jitter");
+
+	/*----------------------------
+	* Orientation stage only
+	*---------------------------*/
+	std::vector<OrientationInput> input(total);
+	{
+		FilterChain smoother;
+		AHRSData_t output;
+		for (size_t n = 0; n < total; n++)
+		{
+			const LogSample& s = samples[n % samples.size()];
+			smoother.step(s.accel, s.gyro, s.mag, dt[n], output);
+
+			input[n].accel = output.accel;
+			input[n].gyro = output.gyro;
+			input[n].mag = output.mag;
+			input[n].dt = dt[n];
+		}
+	}
+
+	OrientationResult reference = runOrientation(input, false, referenceSteps);
+	OrientationResult fixed = runOrientation(input, true, AHRS_UPDATE_RATE_MULTIPLIER);
+	OrientationResult fixedTrueDt = runOrientation(input, false, AHRS_UPDATE_RATE_MULTIPLIER);
+
+	/* Skip the first second while the filter converges from identity */
+	size_t settle = std::min(total, (size_t)AHRS_SAMPLE_RATE_HZ);
+
+	printf("\norientation stage vs %d step reference on the true dt:\n", referenceSteps);
+	report("fixed rate (x5, nominal dt)", fixed, reference, settle);
+	report("x5 sub-steps of true dt", fixedTrueDt, reference, settle);
+
+	/* AHRS_MAX_STEP_HZ trades accuracy for cycles; show the first few multiples of the sample rate */
+	for (int multiple = 1; multiple <= 3; multiple++)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "variable dt, max step %dHz", multiple * AHRS_SAMPLE_RATE_HZ);
+		report(name, runOrientation(input, false, 0, (float)(multiple * AHRS_SAMPLE_RATE_HZ)), reference, settle);
+	}
+
+	/*----------------------------
+	* Whole chain
+	*---------------------------*/
+	double chainFixed = runChain<false>(samples, dt, total);
+	double chainVariable = runChain<true>(samples, dt, total);
+
+	printf("\nFilterChain::step: fixed rate %.1f ns/sample, variable dt (max step %dHz) %.1f ns/sample (%.0f%% saved)\n",
+		chainFixed, AHRS_MAX_STEP_HZ, chainVariable, 100.0 * (chainFixed - chainVariable) / chainFixed);
+
+	return 0;
+}
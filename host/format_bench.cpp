@@ -0,0 +1,112 @@
+/**
+Host benchmark for the serialTask CSV formatter.
+
+Compares the legacy ftoa + std::string line assembly against formatAHRSLine() on the samples
+of a recorded log, counting heap allocations per line and checking both produce the same text.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> host/format_bench.cpp format.cpp -o format_bench
+
+Usage:
+	format_bench <log.csv> [--repeat N]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+/* Project Includes */
+#include "format.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+#include "host/legacyFormat.hpp"
+
+using namespace SOAR_HOST;
+
+/* Every heap allocation in the process goes through here so it can be counted */
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations++;
+	if (void* p = malloc(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <log.csv> [--repeat N]\n", argv[0]);
+		return 1;
+	}
+
+	int repeat = 200;
+	for (int i = 2; i < argc; i++)
+		if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+
+	std::vector<LogSample> log;
+	std::string error;
+	if (!loadCSVLog(argv[1], log, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	/* The log only holds accel/gyro, so make up an attitude from the gyro as well */
+	std::vector<AHRSData_t> samples(log.size());
+	for (size_t i = 0; i < log.size(); i++)
+	{
+		Eigen::Vector4f attitude(1.0f, 0.05f * log[i].gyro(0), 0.05f * log[i].gyro(1), 0.05f * log[i].gyro(2));
+		samples[i](attitude.normalized(), log[i].accel, log[i].gyro, log[i].mag);
+	}
+
+	/* Both paths must produce identical output */
+	char line[SOAR_SERIAL::AHRS_LINE_SIZE];
+	size_t mismatches = 0;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		size_t length = SOAR_SERIAL::formatAHRSLine(samples[i], line);
+		if (legacyFormatAHRSLine(samples[i]) != std::string(line, length))
+			mismatches++;
+	}
+
+	const size_t lines = samples.size() * repeat;
+	size_t bytes = 0;
+
+	allocations = 0;
+	Clock::time_point start = Clock::now();
+	for (size_t n = 0; n < lines; n++)
+		bytes += legacyFormatAHRSLine(samples[n % samples.size()]).size();
+	double legacy_nS = (double)elapsed_nS(start, Clock::now()) / lines;
+	double legacyAllocs = (double)allocations / lines;
+
+	allocations = 0;
+	start = Clock::now();
+	for (size_t n = 0; n < lines; n++)
+		bytes += SOAR_SERIAL::formatAHRSLine(samples[n % samples.size()], line);
+	double fixed_nS = (double)elapsed_nS(start, Clock::now()) / lines;
+	double fixedAllocs = (double)allocations / lines;
+
+	printf("lines: %zu (%zu bytes)\n", lines, bytes);
+	printf("ftoa + std::string:  %8.1f ns/line  %5.2f allocations/line\n", legacy_nS, legacyAllocs);
+	printf("formatAHRSLine:      %8.1f ns/line  %5.2f allocations/line\n", fixed_nS, fixedAllocs);
+	printf("speedup: %.1fx, output mismatches: %zu\n", legacy_nS / fixed_nS, mismatches);
+
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,423 @@
+/**
+Golden output regression check for the AHRS filter chain.
+
+Replays each case through SOAR_AHRS::FilterChain, with the online magnetometer calibration
+in front of it when ahrsTask runs one (MAG_CAL_ONLINE), and compares every output sample
+against the stored golden output:
+
+	pitch, roll, yaw        within --tol-deg (yaw compared across the +-180 wrap)
+	ax, ay, az              within --tol-accel m/s^2
+	gx, gy, gz              within --tol-gyro deg/s
+
+It also times the replay, keeping the fastest of --repeat passes, and fails if a case runs
+more than --throughput-margin percent below its stored samples/s. Throughput only compares
+on the machine the baseline was taken on, so set the margin to 100 to leave it out
+elsewhere.
+
+The cases are the logs named on the command line, each golden at
+<golden dir>/<log name>.golden.csv, and --synthetic N samples of SyntheticSource motion
+with a distorted magnetometer, golden at <golden dir>/synthetic.golden.csv. With neither,
+ahrs_recorded_output.csv and 30 s of synthetic samples at AHRS_SAMPLE_RATE_HZ are checked,
+which is what host/golden holds. The synthetic case is the only one that exercises the
+magnetometer update, since the recorded log has no mag columns.
+
+--update-golden rewrites the golden outputs and throughput.json from this run instead of
+checking them. Do that only for a change that is meant to alter the output, and say why in
+the commit.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/golden_check.cpp ahrsFilter.cpp magCalibration.cpp -o golden_check
+
+Usage:
+	golden_check [log.csv|log.col|log.bin ...] [--synthetic N] [--golden-dir DIR] [--update-golden]
+		[--tol-deg D] [--tol-accel A] [--tol-gyro G] [--throughput-margin PCT] [--repeat N]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "sensors.hpp"
+#include "magCalibration.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+
+using namespace SOAR_HOST;
+using namespace SOAR_AHRS;
+
+static const int GOLDEN_COLUMNS = 9;
+static const char* const goldenNames[GOLDEN_COLUMNS] = {
+	"pitch", "roll", "yaw", "ax", "ay", "az", "gx", "gy", "gz"
+};
+
+struct Tolerances
+{
+	Tolerances() : angle_deg(0.05), accel_ms2(0.001), gyro_dps(0.001) {}
+
+	double angle_deg;
+	double accel_ms2;
+	double gyro_dps;
+};
+
+/* One replay input, with its raw samples in memory */
+struct GoldenCase
+{
+	std::string name;
+	std::vector<ReplayRecord> records;
+};
+
+typedef Eigen::Matrix<float, GOLDEN_COLUMNS, 1> OutputRow;
+
+static OutputRow toRow(AHRSData_t& d)
+{
+	OutputRow row;
+	row << d.pitch(), d.roll(), d.yaw(), d.ax(), d.ay(), d.az(), d.gx(), d.gy(), d.gz();
+	return row;
+}
+
+
+/*----------------------------------
+* Replay
+*----------------------------------*/
+/* Runs a case through a fresh filter chain, as ahrsTask would from boot. Returns the run time. */
+static double replay(const GoldenCase& c, std::vector<OutputRow>& rows)
+{
+	FilterChain filter;
+	MagCalibrator magCal;
+	ReplaySource<> source(c.records.data(), c.records.size());
+	Eigen::Vector3f accel, gyro, mag;
+	AHRSData_t output;
+
+	rows.resize(c.records.size());
+
+	Clock::time_point start = Clock::now();
+	for (size_t n = 0; n < rows.size(); n++)
+	{
+		source.readInertial(accel, gyro);
+		source.readMag(mag);
+
+		#if (MAG_CAL_ONLINE)
+		magCal.addSample(mag);
+		magCal.apply(mag);
+		#endif
+
+		filter.step(accel, gyro, mag, output);
+		rows[n] = toRow(output);
+	}
+	return elapsed_nS(start, Clock::now()) * 1e-9;
+}
+
+/* SyntheticSource motion with the hard and soft iron error ahrs_replay --mag-distortion uses */
+static GoldenCase syntheticCase(size_t count)
+{
+	SyntheticMotion motion;
+	motion.hardIron_G << 0.12f, -0.08f, 0.2f;
+	motion.softIron <<
+		1.10f, 0.05f, -0.03f,
+		0.05f, 0.92f, 0.04f,
+		-0.03f, 0.04f, 1.02f;
+	motion.magNoise_G = 0.004f;
+
+	SyntheticSource<> source(motion);
+	std::vector<LogSample> samples(count);
+	for (size_t n = 0; n < count; n++)
+	{
+		source.readInertial(samples[n].accel, samples[n].gyro);
+		source.readMag(samples[n].mag);
+	}
+
+	GoldenCase c;
+	c.name = "synthetic";
+	c.records = toReplayRecords(samples);
+	return c;
+}
+
+/* Log file name without directory or extension */
+static std::string caseName(const std::string& path)
+{
+	size_t slash = path.find_last_of('/');
+	std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+
+
+/*----------------------------------
+* Golden Files
+*----------------------------------*/
+/* Written with enough digits to read back the exact float */
+static bool writeGolden(const std::string& path, const std::vector<OutputRow>& rows)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "pitch (deg),roll (deg),yaw (deg),ax (m/s^2),ay (m/s^2),az (m/s^2),gx (deg/s),gy (deg/s),gz (deg/s)\n");
+	for (size_t n = 0; n < rows.size(); n++)
+	{
+		const OutputRow& r = rows[n];
+		fprintf(file, "%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", r(0), r(1), r(2), r(3), r(4), r(5), r(6), r(7), r(8));
+	}
+	return fclose(file) == 0;
+}
+
+static bool readGolden(const std::string& path, std::vector<OutputRow>& rows)
+{
+	std::ifstream file(path.c_str());
+	if (!file)
+		return false;
+
+	std::string line;
+	std::getline(file, line);
+
+	rows.clear();
+	while (std::getline(file, line))
+	{
+		OutputRow r;
+		if (sscanf(line.c_str(), "%f,%f,%f,%f,%f,%f,%f,%f,%f", &r(0), &r(1), &r(2), &r(3), &r(4), &r(5), &r(6), &r(7), &r(8)) != 9)
+			return false;
+		rows.push_back(r);
+	}
+	return true;
+}
+
+/* throughput.json, one case per line */
+static bool writeThroughput(const std::string& path, const std::vector<std::string>& names, const std::vector<double>& rates)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n\t\"compiler\": \"%s\",\n\t\"cases\": [\n", __VERSION__);
+	for (size_t i = 0; i < names.size(); i++)
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"samples_per_s\": %.0f }%s\n", names[i].c_str(), rates[i],
+			(i + 1 < names.size()) ? "," : "");
+	fprintf(file, "\t]\n}\n");
+	return fclose(file) == 0;
+}
+
+/* Stored samples/s for a case, 0 if there is none */
+static double readThroughput(const std::string& path, const std::string& name)
+{
+	std::ifstream file(path.c_str());
+	std::string line;
+	while (std::getline(file, line))
+	{
+		char found[128];
+		double rate;
+		if ((sscanf(line.c_str(), " { \"name\": \"%127[^\"]\", \"samples_per_s\": %lf", found, &rate) == 2) && (name == found))
+			return rate;
+	}
+	return 0.0;
+}
+
+
+/*----------------------------------
+* Comparison
+*----------------------------------*/
+struct Mismatch
+{
+	Mismatch() : count(0), firstSample(0), worst(0.0), worstColumn(0), worstSample(0) {}
+
+	size_t count;			/* Samples with any column out of tolerance */
+	size_t firstSample;
+	double worst;			/* Largest difference as a multiple of its tolerance */
+	int worstColumn;
+	size_t worstSample;
+};
+
+static Mismatch compare(const std::vector<OutputRow>& rows, const std::vector<OutputRow>& golden, const Tolerances& tol)
+{
+	const double limits[GOLDEN_COLUMNS] = {
+		tol.angle_deg, tol.angle_deg, tol.angle_deg,
+		tol.accel_ms2, tol.accel_ms2, tol.accel_ms2,
+		tol.gyro_dps, tol.gyro_dps, tol.gyro_dps
+	};
+
+	Mismatch m;
+	for (size_t n = 0; n < rows.size(); n++)
+	{
+		bool bad = false;
+		for (int c = 0; c < GOLDEN_COLUMNS; c++)
+		{
+			double diff = fabs((double)rows[n](c) - golden[n](c));
+			if (c == 2)
+				diff = std::min(diff, 360.0 - diff);
+
+			double ratio = diff / limits[c];
+			if (ratio > m.worst)
+			{
+				m.worst = ratio;
+				m.worstColumn = c;
+				m.worstSample = n;
+			}
+			bad = bad || (ratio > 1.0);
+		}
+
+		if (bad && (m.count++ == 0))
+			m.firstSample = n;
+	}
+	return m;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> logPaths;
+	std::string goldenDir = "host/golden";
+	size_t synthetic = 0;
+	bool update = false;
+	Tolerances tol;
+	double throughputMargin = 20.0;
+	int repeat = 5;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--synthetic") && (i + 1 < argc))
+			synthetic = (size_t)std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--golden-dir") && (i + 1 < argc))
+			goldenDir = argv[++i];
+		else if (!strcmp(argv[i], "--update-golden"))
+			update = true;
+		else if (!strcmp(argv[i], "--tol-deg") && (i + 1 < argc))
+			tol.angle_deg = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--tol-accel") && (i + 1 < argc))
+			tol.accel_ms2 = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--tol-gyro") && (i + 1 < argc))
+			tol.gyro_dps = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--throughput-margin") && (i + 1 < argc))
+			throughputMargin = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "usage: %s [log.csv|log.col|log.bin ...] [--synthetic N] [--golden-dir DIR] [--update-golden]\n"
+				"       [--tol-deg D] [--tol-accel A] [--tol-gyro G] [--throughput-margin PCT] [--repeat N]\n", argv[0]);
+			return 1;
+		}
+		else
+			logPaths.push_back(argv[i]);
+	}
+
+	if (logPaths.empty() && !synthetic)
+	{
+		logPaths.push_back("ahrs_recorded_output.csv");
+		synthetic = AHRS_SAMPLE_RATE_HZ * 30;
+	}
+
+	std::vector<GoldenCase> cases;
+	for (size_t i = 0; i < logPaths.size(); i++)
+	{
+		GoldenCase c;
+		std::string error;
+		c.name = caseName(logPaths[i]);
+		if (!loadReplayLog(logPaths[i], c.records, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		cases.push_back(c);
+	}
+	if (synthetic)
+		cases.push_back(syntheticCase(synthetic));
+
+	const std::string throughputPath = goldenDir + "/throughput.json";
+	std::vector<std::string> names;
+	std::vector<double> rates;
+	size_t failures = 0;
+
+	printf("%-24s %8s  %-48s %14s %14s\n", "case", "samples", "output", "samples/s", "baseline");
+	for (size_t i = 0; i < cases.size(); i++)
+	{
+		const GoldenCase& c = cases[i];
+		const std::string goldenPath = goldenDir + "/" + c.name + ".golden.csv";
+
+		/* Every pass starts from a fresh chain, so they all produce the same output */
+		std::vector<OutputRow> rows;
+		double best_S = replay(c, rows);
+		for (int pass = 1; pass < repeat; pass++)
+		{
+			std::vector<OutputRow> again;
+			best_S = std::min(best_S, replay(c, again));
+		}
+		double rate = rows.size() / best_S;
+		names.push_back(c.name);
+		rates.push_back(rate);
+
+		char result[128];
+		bool failed = false;
+		if (update)
+		{
+			if (!writeGolden(goldenPath, rows))
+			{
+				fprintf(stderr, "could not write %s\n", goldenPath.c_str());
+				return 1;
+			}
+			snprintf(result, sizeof(result), "written");
+		}
+		else
+		{
+			std::vector<OutputRow> golden;
+			if (!readGolden(goldenPath, golden))
+			{
+				snprintf(result, sizeof(result), "no golden output");
+				failed = true;
+			}
+			else if (golden.size() != rows.size())
+			{
+				snprintf(result, sizeof(result), "%zu samples, golden has %zu", rows.size(), golden.size());
+				failed = true;
+			}
+			else
+			{
+				Mismatch m = compare(rows, golden, tol);
+				if (m.count)
+					snprintf(result, sizeof(result), "%zu differ from %zu, worst %s %.1fx tol @%zu",
+						m.count, m.firstSample, goldenNames[m.worstColumn], m.worst, m.worstSample);
+				else
+					snprintf(result, sizeof(result), "match (worst %.2fx tol)", m.worst);
+				failed = (m.count > 0);
+			}
+		}
+
+		double baseline = update ? 0.0 : readThroughput(throughputPath, c.name);
+		printf("%-24s %8zu  %-48s %14.0f", c.name.c_str(), rows.size(), result, rate);
+		if (baseline > 0.0)
+		{
+			printf(" %14.0f", baseline);
+			if (rate < baseline * (1.0 - throughputMargin / 100.0))
+			{
+				printf("  %.0f%% SLOWER", 100.0 * (1.0 - rate / baseline));
+				failed = true;
+			}
+		}
+		else
+			printf(" %14s", "-");
+		printf("\n");
+
+		if (failed)
+			failures++;
+	}
+
+	if (update)
+	{
+		if (!writeThroughput(throughputPath, names, rates))
+		{
+			fprintf(stderr, "could not write %s\n", throughputPath.c_str());
+			return 1;
+		}
+		printf("golden outputs and throughput updated in %s\n", goldenDir.c_str());
+		return 0;
+	}
+
+	printf("%zu of %zu cases failed\n", failures, cases.size());
+	return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef SOAR_HOST_LEGACY_FORMAT_HPP
+#define SOAR_HOST_LEGACY_FORMAT_HPP
+
+/* C/C++ Includes */
+#include <string>
+
+/* Project Includes */
+#include "format.hpp"
+
+namespace SOAR_HOST
+{
+	/**
+	* @brief The ftoa + std::string CSV line assembly serialTask used before formatAHRSLine()
+	*
+	* Kept only as a benchmark reference. The scratch buffer is a proper array here; the
+	* original wrote into a single byte from new char(100).
+	*/
+	inline std::string legacyFormatAHRSLine(AHRSData_t& ahrs)
+	{
+		using SOAR_SERIAL::ftoa;
+
+		const int precision = 2;
+		char buff[100];
+
+		std::string gx, gy, gz;
+		std::string ax, ay, az;
+		std::string pitch, roll, yaw;
+
+		gx = ftoa(ahrs.gx(), buff, precision);
+		gy = ftoa(ahrs.gy(), buff, precision);
+		gz = ftoa(ahrs.gz(), buff, precision);
+
+		ax = ftoa(ahrs.ax(), buff, precision);
+		ay = ftoa(ahrs.ay(), buff, precision);
+		az = ftoa(ahrs.az(), buff, precision);
+
+		pitch = ftoa(ahrs.pitch(), buff, precision);
+		roll = ftoa(ahrs.roll(), buff, precision);
+		yaw = ftoa(ahrs.yaw(), buff, precision);
+
+		std::string line =
+			pitch + ',' + roll + ',' + yaw + ',' + \
+			ax + ',' + ay + ',' + az + ',' + \
+			gx + ',' + gy + ',' + gz + "\r\n";
+		return line;
+	}
+}
+
+#endif
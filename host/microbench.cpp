@@ -0,0 +1,599 @@
+/**
+Microbenchmarks for the kernels the firmware runs on every sample.
+
+	srukf/...          Kalman::SquareRootUnscentedKalmanFilter predict/update, ahrsTask noise setup
+	workspace_ukf/...  IMU::WorkspaceSquareRootUKF, same setup
+	closed_form/...    IMU::IdentityKalmanFilter, same setup
+	madgwick/...       MadgwickAHRS::update (IMU and MARG forms), getEulerDeg
+	mahony/...         MahonyAHRST<float>::update, and complementary/... ComplementaryAHRST<float>
+	chain/step         FilterChain::step, the whole per-sample filter
+	eskf/step          ErrorStateChainT<float>::step, the AHRS_PIPELINE_ESKF alternative to it
+	format/...         SOAR_SERIAL::ftoa, stringFormat, the old ftoa + std::string serialTask line
+	                   and formatAHRSLine
+	telemetry/...      encodeAHRSFrame, the binary console's per-sample work
+
+Inputs cycle through the samples of a recorded log. Each benchmark runs in batches until
+--min-time has passed and reports the median ns/op over the batches, heap allocations/op
+(operator new is counted) and, where the kernel lets a process read its own hardware
+counters, user space instructions/op. Update benchmarks put the filter back to the same
+prior before every update, a copy of a few dozen floats that is counted in the result.
+
+--json writes the results one benchmark per line. host/microbench_baseline.json is one such
+file; rerun with --baseline against it to see what a change did. A benchmark regresses when
+its ns/op grows by more than --threshold percent (default 10), its instructions/op by more
+than 2% or its allocations/op at all, and the exit code is then 1. ns/op only compares on the
+same machine; instructions and allocations carry across machines.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/microbench.cpp ahrsFilter.cpp format.cpp telemetry.cpp -o microbench
+
+Usage:
+	microbench [log.csv] [--filter TEXT] [--skip TEXT] [--min-time S] [--json out.json]
+		[--baseline base.json] [--threshold PCT]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+/* Linux Includes */
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "format.hpp"
+#include "telemetry.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+#include "host/legacyFormat.hpp"
+
+using namespace SOAR_AHRS;
+using namespace SOAR_HOST;
+
+/* Every heap allocation in the process goes through here so it can be counted */
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations++;
+	if (void* p = malloc(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	allocations++;
+	if (void* p = malloc(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+/* Stops the compiler from dropping a result nothing reads */
+template<typename T>
+static inline void keep(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+/*----------------------------------
+* Instruction Counter
+*----------------------------------*/
+/* User space instructions retired by this thread, through perf_event_open. Unavailable in
+* most containers and VMs, in which case every count reads back as missing. */
+class InstructionCounter
+{
+public:
+	InstructionCounter() : fd(-1)
+	{
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+
+	~InstructionCounter()
+	{
+		if (fd >= 0)
+			close(fd);
+	}
+
+	bool available() const { return fd >= 0; }
+
+	void start()
+	{
+		if (fd < 0)
+			return;
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	uint64_t stop()
+	{
+		uint64_t count = 0;
+		if (fd < 0)
+			return 0;
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(fd, &count, sizeof(count)) != sizeof(count))
+			count = 0;
+		return count;
+	}
+
+private:
+	int fd;
+};
+
+
+/*----------------------------------
+* Runner
+*----------------------------------*/
+/* Runs op(i) for i = 0 .. count-1. Batching through a std::function keeps the call overhead
+* out of the per op cost. */
+typedef std::function<void(size_t first, size_t count)> Batch;
+
+struct BenchResult
+{
+	std::string name;
+	double ns_per_op;
+	double allocs_per_op;
+	double instructions_per_op;		/* < 0 where there is no counter */
+};
+
+static BenchResult measure(const std::string& name, const Batch& batch, double minTime_S, InstructionCounter& counter)
+{
+	/* Grow the batch until it takes about a millisecond, so clock reads are noise */
+	size_t batchOps = 1;
+	for (;;)
+	{
+		Clock::time_point start = Clock::now();
+		batch(0, batchOps);
+		if ((elapsed_nS(start, Clock::now()) > 1000000) || (batchOps >= ((size_t)1 << 30)))
+			break;
+		batchOps *= 2;
+	}
+
+	std::vector<uint64_t> perOp_pS;
+	size_t ops = 0;
+	size_t allocationsAtStart = allocations;
+	uint64_t instructions = 0;
+	Clock::time_point runStart = Clock::now();
+
+	while ((perOp_pS.size() < 5) || (elapsed_nS(runStart, Clock::now()) < minTime_S * 1e9))
+	{
+		counter.start();
+		Clock::time_point start = Clock::now();
+		batch(ops, batchOps);
+		uint64_t batch_nS = elapsed_nS(start, Clock::now());
+		instructions += counter.stop();
+
+		perOp_pS.push_back(batch_nS * 1000 / batchOps);
+		ops += batchOps;
+	}
+
+	BenchResult r;
+	r.name = name;
+	r.ns_per_op = summarize(perOp_pS).p50_nS / 1000.0;
+	r.allocs_per_op = (double)(allocations - allocationsAtStart) / ops;
+	r.instructions_per_op = counter.available() ? ((double)instructions / ops) : -1.0;
+	return r;
+}
+
+
+/*----------------------------------
+* Baseline
+*----------------------------------*/
+/* CPU the numbers were taken on, from /proc/cpuinfo */
+static std::string cpuModel()
+{
+	std::ifstream cpuinfo("/proc/cpuinfo");
+	std::string line;
+	while (std::getline(cpuinfo, line))
+	{
+		size_t colon = line.find(':');
+		if ((line.compare(0, 10, "model name") == 0) && (colon != std::string::npos) && (colon + 2 <= line.size()))
+			return line.substr(colon + 2);
+	}
+	return "unknown";
+}
+
+static bool writeJSON(const std::string& path, const std::vector<BenchResult>& results, const std::string& logPath)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n\t\"cpu\": \"%s\",\n\t\"compiler\": \"%s\",\n\t\"log\": \"%s\",\n\t\"benchmarks\": [\n",
+		cpuModel().c_str(), __VERSION__, logPath.c_str());
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"ns_per_op\": %.2f, \"allocs_per_op\": %.2f, \"instructions_per_op\": ",
+			r.name.c_str(), r.ns_per_op, r.allocs_per_op);
+		if (r.instructions_per_op < 0.0)
+			fprintf(file, "null }");
+		else
+			fprintf(file, "%.1f }", r.instructions_per_op);
+		fprintf(file, "%s\n", (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+	return fclose(file) == 0;
+}
+
+/* Reads back what writeJSON() wrote, one benchmark per line */
+static bool readJSON(const std::string& path, std::vector<BenchResult>& results)
+{
+	std::ifstream file(path.c_str());
+	if (!file)
+		return false;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		char name[128];
+		BenchResult r;
+		if (sscanf(line.c_str(), " { \"name\": \"%127[^\"]\", \"ns_per_op\": %lf, \"allocs_per_op\": %lf,",
+			name, &r.ns_per_op, &r.allocs_per_op) != 3)
+			continue;
+
+		size_t instructions = line.find("\"instructions_per_op\": ");
+		r.name = name;
+		r.instructions_per_op = -1.0;
+		if (instructions != std::string::npos)
+			sscanf(line.c_str() + instructions, "\"instructions_per_op\": %lf", &r.instructions_per_op);
+		results.push_back(r);
+	}
+	return true;
+}
+
+static const BenchResult* find(const std::vector<BenchResult>& results, const std::string& name)
+{
+	for (size_t i = 0; i < results.size(); i++)
+		if (results[i].name == name)
+			return &results[i];
+	return nullptr;
+}
+
+
+/*----------------------------------
+* Benchmarks
+*----------------------------------*/
+struct Benchmark
+{
+	std::string name;
+	Batch batch;
+};
+
+/* Puts a filter back to an earlier copy of itself. The workspace SR-UKF holds a reference to
+* its scratch, so it can be copy constructed but not assigned. */
+template<class Filter>
+static inline void restore(Filter& filter, const Filter& prior)
+{
+	filter.~Filter();
+	new (&filter) Filter(prior);
+}
+
+/* predict() and a restore-then-update() for one smoother type, from the state it reaches on the log */
+template<template<class> class Smoother>
+static void addSmoother(std::vector<Benchmark>& list, const std::string& prefix, const std::vector<LogSample>& samples)
+{
+	struct Setup
+	{
+		Setup() : filter(0.5f, 3.0f, 0.0f)
+		{
+			State x;
+			x.setZero();
+			initNoiseModels(sys, om);
+			filter.init(x);
+		}
+
+		SystemModel sys;
+		MeasurementModel om;
+		Smoother<State> filter;
+	};
+
+	std::shared_ptr<Setup> setup = std::make_shared<Setup>();
+	for (size_t n = 0; n < samples.size(); n++)
+	{
+		Measurement meas;
+		meas << samples[n].accel, samples[n].gyro;
+		setup->filter.predict(setup->sys);
+		setup->filter.update(setup->om, meas);
+	}
+	std::shared_ptr<Smoother<State> > prior = std::make_shared<Smoother<State> >(setup->filter);
+	const std::vector<LogSample>* log = &samples;
+
+	list.push_back({ prefix + "/predict", [setup, prior](size_t, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			keep(setup->filter.predict(setup->sys));
+		restore(setup->filter, *prior);
+	} });
+
+	list.push_back({ prefix + "/update", [setup, prior, log](size_t first, size_t count)
+	{
+		Measurement meas;
+		for (size_t i = first; i < first + count; i++)
+		{
+			const LogSample& s = (*log)[i % log->size()];
+			meas << s.accel, s.gyro;
+			restore(setup->filter, *prior);
+			keep(setup->filter.update(setup->om, meas));
+		}
+	} });
+}
+
+/* One update of an orientation filter, in the IMU-only and MARG forms */
+template<class Filter>
+static void addOrientation(std::vector<Benchmark>& list, const std::string& prefix, std::shared_ptr<Filter> filter,
+	const std::vector<LogSample>& samples, float dt)
+{
+	const std::vector<LogSample>* log = &samples;
+
+	list.push_back({ prefix + "/update_imu", [filter, log, dt](size_t first, size_t count)
+	{
+		const Eigen::Vector3f noMag = Eigen::Vector3f::Zero();
+		for (size_t i = first; i < first + count; i++)
+		{
+			const LogSample& s = (*log)[i % log->size()];
+			filter->update(s.accel, s.gyro, noMag, dt);
+		}
+		keep(*filter);
+	} });
+
+	list.push_back({ prefix + "/update_marg", [filter, log, dt](size_t first, size_t count)
+	{
+		/* A fixed field 60 deg below the horizon stands in for the mag the log does not have */
+		const Eigen::Vector3f mag(0.2f, 0.05f, -0.45f);
+		for (size_t i = first; i < first + count; i++)
+		{
+			const LogSample& s = (*log)[i % log->size()];
+			filter->update(s.accel, s.gyro, mag, dt);
+		}
+		keep(*filter);
+	} });
+}
+
+static std::vector<Benchmark> benchmarks(const std::vector<LogSample>& samples)
+{
+	std::vector<Benchmark> list;
+	const std::vector<LogSample>* log = &samples;
+
+	addSmoother<Kalman::SquareRootUnscentedKalmanFilter>(list, "srukf", samples);
+	addSmoother<IMU::WorkspaceSquareRootUKF>(list, "workspace_ukf", samples);
+	addSmoother<IMU::IdentityKalmanFilter>(list, "closed_form", samples);
+
+	/* One Madgwick step at the fixed rate path's step length */
+	const float madgwickDt = 1.0f / (AHRS_SAMPLE_RATE_HZ * AHRS_UPDATE_RATE_MULTIPLIER);
+	std::shared_ptr<MadgwickAHRS> ahrs = std::make_shared<MadgwickAHRS>(madgwickBeta);
+	addOrientation(list, "madgwick", ahrs, samples, madgwickDt);
+
+	/* The others take one step per sample */
+	const float sampleDt = 1.0f / AHRS_SAMPLE_RATE_HZ;
+	addOrientation(list, "mahony", std::make_shared<MahonyAHRST<float> >(mahonyKp, mahonyKi), samples, sampleDt);
+	addOrientation(list, "complementary", std::make_shared<ComplementaryAHRST<float> >(complementaryAccelGain,
+		complementaryMagGain), samples, sampleDt);
+
+	list.push_back({ "madgwick/get_euler_deg", [ahrs](size_t, size_t count)
+	{
+		Eigen::Vector3f euler;
+		for (size_t i = 0; i < count; i++)
+		{
+			ahrs->getEulerDeg(euler);
+			keep(euler);
+		}
+	} });
+
+	std::shared_ptr<FilterChain> chain = std::make_shared<FilterChain>();
+	list.push_back({ "chain/step", [chain, log](size_t first, size_t count)
+	{
+		AHRSData_t output;
+		for (size_t i = first; i < first + count; i++)
+		{
+			const LogSample& s = (*log)[i % log->size()];
+			chain->step(s.accel, s.gyro, s.mag, output);
+			keep(output);
+		}
+	} });
+
+	std::shared_ptr<ErrorStateChainT<float> > eskf = std::make_shared<ErrorStateChainT<float> >();
+	list.push_back({ "eskf/step", [eskf, log](size_t first, size_t count)
+	{
+		AHRSData_t output;
+		for (size_t i = first; i < first + count; i++)
+		{
+			const LogSample& s = (*log)[i % log->size()];
+			eskf->step(s.accel, s.gyro, s.mag, output);
+			keep(output);
+		}
+	} });
+
+	/* The formatters print filter output, so feed them the chain's output for the log */
+	std::shared_ptr<std::vector<AHRSData_t> > outputs = std::make_shared<std::vector<AHRSData_t> >(samples.size());
+	{
+		FilterChain filter;
+		for (size_t n = 0; n < samples.size(); n++)
+			filter.step(samples[n].accel, samples[n].gyro, samples[n].mag, (*outputs)[n]);
+	}
+
+	list.push_back({ "format/ftoa", [outputs](size_t first, size_t count)
+	{
+		char buffer[32];
+		for (size_t i = first; i < first + count; i++)
+			keep(SOAR_SERIAL::ftoa((*outputs)[i % outputs->size()].gyro(0), buffer, 2));
+	} });
+
+	list.push_back({ "format/string_format", [outputs](size_t first, size_t count)
+	{
+		for (size_t i = first; i < first + count; i++)
+		{
+			const AHRSData_t& d = (*outputs)[i % outputs->size()];
+			std::string line = SOAR_SERIAL::stringFormat("%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\r\n",
+				d.pitch(), d.roll(), d.yaw(), d.accel(0), d.accel(1), d.accel(2), d.gyro(0), d.gyro(1), d.gyro(2));
+			keep(line.size());
+		}
+	} });
+
+	list.push_back({ "format/legacy_line", [outputs](size_t first, size_t count)
+	{
+		for (size_t i = first; i < first + count; i++)
+			keep(legacyFormatAHRSLine((*outputs)[i % outputs->size()]).size());
+	} });
+
+	list.push_back({ "format/ahrs_line", [outputs](size_t first, size_t count)
+	{
+		char line[SOAR_SERIAL::AHRS_LINE_SIZE];
+		for (size_t i = first; i < first + count; i++)
+			keep(SOAR_SERIAL::formatAHRSLine((*outputs)[i % outputs->size()], line));
+	} });
+
+	list.push_back({ "telemetry/ahrs_frame", [outputs](size_t first, size_t count)
+	{
+		uint8_t frame[SOAR_TELEMETRY::AHRS_FRAME_SIZE];
+		for (size_t i = first; i < first + count; i++)
+			keep(SOAR_TELEMETRY::encodeAHRSFrame((*outputs)[i % outputs->size()], (uint16_t)i, frame));
+	} });
+
+	return list;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string logPath = "ahrs_recorded_output.csv";
+	std::string jsonPath, baselinePath;
+	std::vector<std::string> filters, skips;
+	double minTime_S = 0.3;
+	double threshold = 10.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--filter") && (i + 1 < argc))
+			filters.push_back(argv[++i]);
+		else if (!strcmp(argv[i], "--skip") && (i + 1 < argc))
+			skips.push_back(argv[++i]);
+		else if (!strcmp(argv[i], "--min-time") && (i + 1 < argc))
+			minTime_S = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--json") && (i + 1 < argc))
+			jsonPath = argv[++i];
+		else if (!strcmp(argv[i], "--baseline") && (i + 1 < argc))
+			baselinePath = argv[++i];
+		else if (!strcmp(argv[i], "--threshold") && (i + 1 < argc))
+			threshold = atof(argv[++i]);
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "usage: %s [log.csv] [--filter TEXT] [--skip TEXT] [--min-time S] [--json out.json]\n"
+				"       [--baseline base.json] [--threshold PCT]\n", argv[0]);
+			return 1;
+		}
+		else
+			logPath = argv[i];
+	}
+
+	std::vector<LogSample> samples;
+	std::string error;
+	if (!loadCSVLog(logPath, samples, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	std::vector<BenchResult> baseline;
+	if (!baselinePath.empty() && !readJSON(baselinePath, baseline))
+	{
+		fprintf(stderr, "could not read %s\n", baselinePath.c_str());
+		return 1;
+	}
+
+	InstructionCounter counter;
+	if (!counter.available())
+		printf("no hardware instruction counter here, instructions/op left out\n");
+
+	printf("%-28s %10s %10s %14s", "benchmark", "ns/op", "allocs/op", "instructions");
+	if (!baseline.empty())
+		printf(" %10s %10s", "ns vs base", "ins vs base");
+	printf("\n");
+
+	std::vector<BenchResult> results;
+	size_t regressions = 0;
+	std::vector<Benchmark> list = benchmarks(samples);
+	for (size_t b = 0; b < list.size(); b++)
+	{
+		const std::string& name = list[b].name;
+		bool selected = filters.empty();
+		for (size_t i = 0; i < filters.size(); i++)
+			selected = selected || (name.find(filters[i]) != std::string::npos);
+		for (size_t i = 0; i < skips.size(); i++)
+			selected = selected && (name.find(skips[i]) == std::string::npos);
+		if (!selected)
+			continue;
+
+		BenchResult r = measure(name, list[b].batch, minTime_S, counter);
+		results.push_back(r);
+
+		printf("%-28s %10.2f %10.2f", r.name.c_str(), r.ns_per_op, r.allocs_per_op);
+		if (r.instructions_per_op < 0.0)
+			printf(" %14s", "-");
+		else
+			printf(" %14.1f", r.instructions_per_op);
+
+		if (const BenchResult* base = find(baseline, name))
+		{
+			double nsChange = 100.0 * (r.ns_per_op / base->ns_per_op - 1.0);
+			bool regressed = (nsChange > threshold) || (r.allocs_per_op > base->allocs_per_op + 0.005);
+			printf(" %+9.1f%%", nsChange);
+
+			if ((r.instructions_per_op >= 0.0) && (base->instructions_per_op > 0.0))
+			{
+				double insChange = 100.0 * (r.instructions_per_op / base->instructions_per_op - 1.0);
+				regressed = regressed || (insChange > 2.0);
+				printf(" %+9.1f%%", insChange);
+			}
+			else
+				printf(" %10s", "-");
+
+			if (regressed)
+			{
+				printf("  REGRESSED");
+				regressions++;
+			}
+		}
+		else if (!baseline.empty())
+			printf(" %10s %10s", "new", "");
+		printf("\n");
+	}
+
+	if (!jsonPath.empty() && !writeJSON(jsonPath, results, logPath))
+	{
+		fprintf(stderr, "could not write %s\n", jsonPath.c_str());
+		return 1;
+	}
+
+	if (!baseline.empty())
+		printf("%zu regression%s against %s\n", regressions, (regressions == 1) ? "" : "s", baselinePath.c_str());
+
+	return (regressions > 0) ? 1 : 0;
+}
@@ -0,0 +1,332 @@
+/**
+Host cost and accuracy report for the orientation filters the chain can run.
+
+Runs the same input through FilterChainT<IMU::IdentityKalmanFilter, float, float, Orientation>
+for each of MadgwickAHRST, MahonyAHRST and ComplementaryAHRST, with the gains and steps per
+sample the firmware would use (OrientationSetup in ahrsFilter.hpp, AHRS_VARIABLE_DT), and
+reports the cycles the orientation stage takes per sample and per update alongside its
+accuracy. The same filters are then run alone on the unsmoothed samples, which separates
+what the filter costs in accuracy from what the pre-smoother's lag does.
+
+	recorded log    IMU only, no truth. Tilt (the attitude with heading left out) against the
+					Madgwick filter, which is what the firmware has always printed, and against
+					the tilt the accelerometer gives. The log is stationary, so the latter is
+					close to a truth.
+	--synthetic N   SyntheticSource motion with sensor noise, MARG. Pitch/roll and heading
+					error against the known truth. It has no linear acceleration, which
+					flatters low gains.
+
+Errors are scored after the first 5 s, once every filter has converged from the identity.
+
+Cycles are TSC counts (cycleCounter.hpp), which rank the filters but are not M4F cycles.
+On one x86 development machine, with the default gains, --repeat 20 and AHRS_VARIABLE_DT
+(2 updates per sample for every filter):
+
+	                 cycles/sample p50    recorded, chain      synthetic 9000 (deg rms)
+	                 IMU      MARG        tilt vs accel        chain            alone
+	filter                                (deg rms)            tilt   heading   tilt   heading
+	Madgwick         244      368         1.65                 5.59   12.38     1.59   1.19
+	Mahony           164      262         1.43                 4.66    7.24     0.31   0.22
+	Complementary    278      518         1.38                 5.40    5.18     0.32   0.17
+
+So Mahony is the cheapest and, at these gains, at least as accurate as Madgwick. Most of
+the chain's error comes from the pre-smoother's lag, not from the orientation filter. On the
+fixed rate path (AHRS_VARIABLE_DT 0) Madgwick runs AHRS_UPDATE_RATE_MULTIPLIER updates per
+sample and the others one, which widens the gap.
+
+Rerun after touching a filter or its gains; build the firmware with AHRS_TRACE_ENABLED and
+read the orientation stage histogram for the board's own numbers.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/orientation_bench.cpp ahrsFilter.cpp -o orientation_bench
+
+Usage:
+	orientation_bench [log.csv] [--synthetic N] [--repeat N]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "cycleCounter.hpp"
+#include "sensors.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+
+using namespace SOAR_AHRS;
+using namespace SOAR_HOST;
+
+/* Input samples, and the true attitude behind each for synthetic runs */
+struct BenchInput
+{
+	std::vector<LogSample> samples;
+	std::vector<Eigen::Vector3f> truthEulerDeg;
+};
+
+struct FilterResult
+{
+	std::vector<Eigen::Vector4f> attitude;	/* From the first pass */
+	std::vector<Eigen::Vector3f> accel;		/* Accelerometer the filter was given, from the first pass */
+	LatencySummary sampleCycles;			/* Orientation stage per sample */
+	double updateCycles;					/* Mean per orientation update */
+	double updatesPerSample;
+};
+
+/* Orientation updates per sample, as FilterChainT::step() splits them */
+template<class Filter>
+static uint32_t updatesPerSample(float dt)
+{
+	#if (AHRS_VARIABLE_DT)
+	uint32_t steps = (uint32_t)(dt * AHRS_MAX_STEP_HZ + 0.5f);
+	return std::max((uint32_t)1, std::min(steps, (uint32_t)AHRS_MAX_SUBSTEPS));
+	#else
+	(void)dt;
+	return OrientationSetup<Filter>::fixedRateSteps;
+	#endif
+}
+
+/* The whole chain, smoother first, the way the firmware runs it */
+template<template<class> class Orientation>
+static FilterResult runChain(const BenchInput& input, int repeat)
+{
+	typedef FilterChainT<IMU::IdentityKalmanFilter, float, float, Orientation> Chain;
+
+	const size_t count = input.samples.size();
+	const float dt = 1.0f / AHRS_SAMPLE_RATE_HZ;
+	FilterResult result;
+	result.attitude.resize(count);
+	result.accel.resize(count);
+	std::vector<uint64_t> sampleCycles(count * repeat);
+	uint64_t totalCycles = 0, totalUpdates = 0;
+
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		Chain filter;
+		typename Chain::Output output;
+
+		for (size_t n = 0; n < count; n++)
+		{
+			const LogSample& s = input.samples[n];
+
+			#if (AHRS_VARIABLE_DT)
+			filter.step(s.accel, s.gyro, s.mag, dt, output);
+			#else
+			filter.step(s.accel, s.gyro, s.mag, output);
+			#endif
+
+			sampleCycles[pass * count + n] = filter.orientationCycles();
+			totalCycles += filter.orientationCycles();
+			totalUpdates += filter.orientationSteps();
+
+			if (pass == 0)
+			{
+				result.attitude[n] = output.quaternion;
+				result.accel[n] = output.accel;
+			}
+		}
+	}
+
+	result.sampleCycles = summarize(sampleCycles);
+	result.updateCycles = (double)totalCycles / totalUpdates;
+	result.updatesPerSample = (double)totalUpdates / (count * repeat);
+	return result;
+}
+
+/* The orientation filter alone on the unsmoothed samples, same gains and updates per sample */
+template<template<class> class Orientation>
+static FilterResult runAlone(const BenchInput& input, int repeat)
+{
+	typedef Orientation<float> Filter;
+
+	const size_t count = input.samples.size();
+	const float dt = 1.0f / AHRS_SAMPLE_RATE_HZ;
+	const uint32_t steps = updatesPerSample<Filter>(dt);
+	const float stepDt = dt / steps;
+	FilterResult result;
+	result.attitude.resize(count);
+	result.accel.resize(count);
+	std::vector<uint64_t> sampleCycles(count * repeat);
+	uint64_t totalCycles = 0;
+
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		Filter filter = OrientationSetup<Filter>::create();
+
+		for (size_t n = 0; n < count; n++)
+		{
+			const LogSample& s = input.samples[n];
+
+			uint32_t start = SOAR_PROFILE::cycleCount();
+			for (uint32_t i = 0; i < steps; i++)
+				filter.update(s.accel, s.gyro, s.mag, stepDt);
+			uint32_t cycles = SOAR_PROFILE::cycleCount() - start;
+
+			sampleCycles[pass * count + n] = cycles;
+			totalCycles += cycles;
+
+			if (pass == 0)
+			{
+				result.attitude[n] = filter.quaternion();
+				result.accel[n] = s.accel;
+			}
+		}
+	}
+
+	result.sampleCycles = summarize(sampleCycles);
+	result.updateCycles = (double)totalCycles / ((uint64_t)count * repeat * steps);
+	result.updatesPerSample = steps;
+	return result;
+}
+
+/* Direction of gravity in the sensor frame for an attitude quaternion */
+static Eigen::Vector3f gravityDirection(const Eigen::Vector4f& q)
+{
+	return Eigen::Vector3f(2.0f * (q(1) * q(3) - q(0) * q(2)), 2.0f * (q(0) * q(1) + q(2) * q(3)),
+		q(0) * q(0) - q(1) * q(1) - q(2) * q(2) + q(3) * q(3));
+}
+
+/* Angle (deg) between two directions */
+static double angleBetween(const Eigen::Vector3f& a, const Eigen::Vector3f& b)
+{
+	double cosine = a.cast<double>().dot(b.cast<double>()) / (a.cast<double>().norm() * b.cast<double>().norm());
+	return acos(std::max(-1.0, std::min(1.0, cosine))) * (180.0 / M_PI);
+}
+
+struct Score
+{
+	Score() : sumSq(0.0), max(0.0), count(0) {}
+
+	void add(double error)
+	{
+		sumSq += error * error;
+		max = std::max(max, fabs(error));
+		count++;
+	}
+
+	double rms() const { return count ? sqrt(sumSq / count) : 0.0; }
+
+	double sumSq;
+	double max;
+	size_t count;
+};
+
+static void report(const char* name, const FilterResult& r, const FilterResult& madgwick, const BenchInput& input,
+	size_t settle)
+{
+	printf("%-16s %8.1f %8llu %8llu %8.1f %6.1f", name, r.sampleCycles.mean_nS, (unsigned long long)r.sampleCycles.p50_nS,
+		(unsigned long long)r.sampleCycles.p99_nS, r.updateCycles, r.updatesPerSample);
+
+	if (input.truthEulerDeg.empty())
+	{
+		Score vsMadgwick, vsAccel;
+		for (size_t n = settle; n < r.attitude.size(); n++)
+		{
+			Eigen::Vector3f tilt = gravityDirection(r.attitude[n]);
+			vsMadgwick.add(angleBetween(tilt, gravityDirection(madgwick.attitude[n])));
+			vsAccel.add(angleBetween(tilt, r.accel[n]));
+		}
+		printf("   %8.3f %8.3f   %8.3f %8.3f\n", vsMadgwick.rms(), vsMadgwick.max, vsAccel.rms(), vsAccel.max);
+	}
+	else
+	{
+		Score tilt, heading;
+		for (size_t n = settle; n < r.attitude.size(); n++)
+		{
+			Eigen::Vector3f euler;
+			quaternionToEulerDeg(r.attitude[n], euler);
+
+			Eigen::Vector3f error = euler - input.truthEulerDeg[n];
+			error(2) = fmodf(error(2) + 540.0f, 360.0f) - 180.0f;
+			tilt.add(error(0));
+			tilt.add(error(1));
+			heading.add(error(2));
+		}
+		printf("   %8.3f %8.3f   %8.3f %8.3f\n", tilt.rms(), tilt.max, heading.rms(), heading.max);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string logPath = "ahrs_recorded_output.csv";
+	int repeat = 20;
+	size_t synthetic = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--synthetic") && (i + 1 < argc))
+			synthetic = (size_t)std::max(1, atoi(argv[++i]));
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "usage: %s [log.csv] [--synthetic N] [--repeat N]\n", argv[0]);
+			return 1;
+		}
+		else
+			logPath = argv[i];
+	}
+
+	BenchInput input;
+	if (synthetic)
+	{
+		/* Noise on every sensor, so the gains trade smoothness against lag */
+		SyntheticMotion motion;
+		motion.accelNoise_ms2 = 0.5f;
+		motion.gyroNoise_dps = 0.5f;
+		motion.magNoise_G = 0.01f;
+
+		SyntheticSource<> source(motion);
+		input.samples.resize(synthetic);
+		input.truthEulerDeg.resize(synthetic);
+		for (size_t n = 0; n < synthetic; n++)
+		{
+			source.readInertial(input.samples[n].accel, input.samples[n].gyro);
+			source.readMag(input.samples[n].mag);
+			source.truthEulerDeg(input.truthEulerDeg[n]);
+		}
+	}
+	else
+	{
+		std::string error;
+		if (!loadCSVLog(logPath, input.samples, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+	}
+
+	const size_t settle = std::min(input.samples.size() / 2, (size_t)(AHRS_SAMPLE_RATE_HZ * 5));
+
+	printf("samples: %zu x %d  %s  %s  counter %llu Hz  error scored after sample %zu\n", input.samples.size(), repeat,
+		synthetic ? "synthetic (MARG)" : "recorded (IMU only)", AHRS_VARIABLE_DT ? "variable dt" : "fixed rate",
+		(unsigned long long)SOAR_PROFILE::cycleCounterHz(), settle);
+
+	for (int alone = 0; alone < 2; alone++)
+	{
+		FilterResult madgwick = alone ? runAlone<MadgwickAHRST>(input, repeat) : runChain<MadgwickAHRST>(input, repeat);
+		FilterResult mahony = alone ? runAlone<MahonyAHRST>(input, repeat) : runChain<MahonyAHRST>(input, repeat);
+		FilterResult complementary = alone ? runAlone<ComplementaryAHRST>(input, repeat) : runChain<ComplementaryAHRST>(input, repeat);
+
+		printf("\n%s\n", alone ? "filter alone, unsmoothed samples" : "chain, after the pre-smoother (what the firmware runs)");
+		printf("%-16s %8s %8s %8s %8s %6s", "filter", "sample", "p50", "p99", "update", "upd/");
+		if (synthetic)
+			printf("   %17s   %17s\n", "pitch/roll (deg)", "heading (deg)");
+		else
+			printf("   %17s   %17s\n", "tilt vs Madgwick", "tilt vs accel");
+		printf("%-16s %8s %8s %8s %8s %6s   %8s %8s   %8s %8s\n", "", "cycles", "", "", "cycles", "sample",
+			"rms", "max", "rms", "max");
+
+		report("Madgwick", madgwick, madgwick, input, settle);
+		report("Mahony", mahony, madgwick, input, settle);
+		report("Complementary", complementary, madgwick, input, settle);
+	}
+
+	return 0;
+}
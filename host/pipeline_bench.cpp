@@ -0,0 +1,434 @@
+/**
+Host cost and accuracy report for the two AHRS pipelines (AHRS_PIPELINE in config.hpp).
+
+	cascade         FilterChainT: the closed form pre-smoother, then the orientation filter,
+					with the gains and steps per sample the firmware uses. Run with Madgwick
+					(the default) and Mahony (the cheapest, see host/orientation_bench.cpp).
+	eskf            ErrorStateChainT: one error-state EKF for attitude and gyro bias on the
+					raw readings.
+
+Both go through step(), with dt unless --fixed-rate (the default follows AHRS_VARIABLE_DT).
+Cost is the whole pipeline per sample, as TSC cycles (smootherCycles() + orientationCycles())
+and as floating point operations, counted by running the same pipeline on CountedFloat.
+The operation counts are exact and carry over to the M4F, where add/sub/mul are single cycle
+and div/sqrt take 14; the cycles only rank the pipelines on the host.
+
+	recorded log    IMU only and stationary, with a gyro bias of ~14 dps. Tilt against the
+					raw accelerometer, which is close to a truth, and the rate each pipeline
+					outputs, which should be zero.
+	--synthetic N   SyntheticSource motion with sensor noise, MARG, the mag refreshed every
+					second sample as the mag group does. Run once as it is and once with a
+					constant gyro bias like the recorded log's. Pitch/roll and heading error
+					against the truth, and the output rate error.
+
+Errors are scored after the first 5 s (half the log if it is shorter).
+
+On one x86 development machine, --repeat 20, operations per sample as add+mul / div+sqrt:
+
+	                     variable dt                 fixed rate
+	                     IMU         MARG            IMU         MARG
+	cascade Madgwick     244 / 20    536 / 26        537 / 38    1267 / 53
+	cascade Mahony       194 / 16    352 / 22        116 / 12     195 / 15
+	eskf                 497 / 11    571 / 13        496 / 10     570 / 12
+
+and accuracy, variable dt (fixed rate is within a few percent, except Madgwick's recorded
+tilt, which its five updates per sample bring down to 0.74):
+
+	                     recorded                    synthetic 9000, biased gyro
+	                     tilt        rate            tilt        heading     rate
+	                     (deg rms)   (dps rms)       (deg rms)   (deg rms)   (dps rms)
+	cascade Madgwick     1.64        14.3            5.57        12.25       17.6
+	cascade Mahony       1.43        14.3            4.88        11.59       17.6
+	eskf                 0.09         1.46           0.11         0.22        0.50
+
+The EKF ends the biased synthetic run with a bias estimate within 0.05 dps of the truth, and
+the unbiased run with the same attitude error. On the recorded log it learns the two
+horizontal axes of the bias; the third is about the vertical, which an IMU only run cannot
+see. The cascades pass the bias straight through to their output rate, and their attitude
+error is mostly the pre-smoother's lag.
+
+The EKF does half the divides and square roots of the Madgwick cascade. Weighting them at
+14 cycles, it comes to ~750 M4F cycles a MARG sample against the cascade's ~900 with dt and
+~2000 at a fixed rate, where Madgwick needs AHRS_UPDATE_RATE_MULTIPLIER updates per sample. Against the IMU only
+cascade, or Mahony, it costs more. Its cost does not depend on how often it runs, so the
+sample rate can go up without the multiplier going up with it.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/pipeline_bench.cpp ahrsFilter.cpp -o pipeline_bench
+
+Usage:
+	pipeline_bench [log.csv] [--synthetic N] [--repeat N] [--fixed-rate | --variable-dt]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "cycleCounter.hpp"
+#include "sensors.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+
+/*----------------------------------
+* Operation Counting Scalar
+*----------------------------------*/
+namespace SOAR_HOST
+{
+	/* Floating point operations, by what they cost on the M4F: add/sub and mul are single
+	* cycle, div and sqrt take 14 */
+	struct OpCounts
+	{
+		uint64_t add, mul, div, sqrt, atan2;
+	};
+
+	static OpCounts ops;
+
+	/**
+	* @brief A float that counts the arithmetic done on it in ops
+	*
+	* The pipelines are templates on their scalar, so running one on CountedFloat gives the
+	* exact operations per sample without reading the compiler's output. Comparisons and
+	* negation are not counted.
+	*/
+	struct CountedFloat
+	{
+		float v;
+
+		CountedFloat() : v(0.0f) {}
+		CountedFloat(float v) : v(v) {}
+		CountedFloat(double v) : v((float)v) {}
+		CountedFloat(int v) : v((float)v) {}
+		CountedFloat(unsigned v) : v((float)v) {}
+		template<typename U> explicit operator U() const { return U(v); }
+
+		friend CountedFloat operator+(CountedFloat a, CountedFloat b) { ops.add++; return a.v + b.v; }
+		friend CountedFloat operator-(CountedFloat a, CountedFloat b) { ops.add++; return a.v - b.v; }
+		friend CountedFloat operator*(CountedFloat a, CountedFloat b) { ops.mul++; return a.v * b.v; }
+		friend CountedFloat operator/(CountedFloat a, CountedFloat b) { ops.div++; return a.v / b.v; }
+		friend CountedFloat operator-(CountedFloat a) { return -a.v; }
+		CountedFloat& operator+=(CountedFloat b) { return *this = *this + b; }
+		CountedFloat& operator-=(CountedFloat b) { return *this = *this - b; }
+		CountedFloat& operator*=(CountedFloat b) { return *this = *this * b; }
+		CountedFloat& operator/=(CountedFloat b) { return *this = *this / b; }
+
+		friend bool operator==(CountedFloat a, CountedFloat b) { return a.v == b.v; }
+		friend bool operator!=(CountedFloat a, CountedFloat b) { return a.v != b.v; }
+		friend bool operator<(CountedFloat a, CountedFloat b) { return a.v < b.v; }
+		friend bool operator>(CountedFloat a, CountedFloat b) { return a.v > b.v; }
+		friend bool operator<=(CountedFloat a, CountedFloat b) { return a.v <= b.v; }
+		friend bool operator>=(CountedFloat a, CountedFloat b) { return a.v >= b.v; }
+
+		/* Found by argument dependent lookup from the filters and from Eigen */
+		friend CountedFloat sqrt(CountedFloat a) { ops.sqrt++; return std::sqrt(a.v); }
+		friend CountedFloat squareRoot(CountedFloat a) { return sqrt(a); }
+		friend CountedFloat abs(CountedFloat a) { return std::fabs(a.v); }
+		friend CountedFloat arcTangent2(CountedFloat y, CountedFloat x) { ops.atan2++; return std::atan2(y.v, x.v); }
+		friend CountedFloat cos(CountedFloat a) { return std::cos(a.v); }
+		friend CountedFloat sin(CountedFloat a) { return std::sin(a.v); }
+	};
+}
+
+namespace Eigen
+{
+	template<>
+	struct NumTraits<SOAR_HOST::CountedFloat> : NumTraits<float>
+	{
+		typedef SOAR_HOST::CountedFloat Real;
+		typedef SOAR_HOST::CountedFloat NonInteger;
+		typedef SOAR_HOST::CountedFloat Nested;
+		typedef SOAR_HOST::CountedFloat Literal;
+
+		enum
+		{
+			IsComplex = 0,
+			IsInteger = 0,
+			IsSigned = 1,
+			RequireInitialization = 1,
+			ReadCost = 1,
+			AddCost = 1,
+			MulCost = 1
+		};
+	};
+}
+
+using namespace SOAR_AHRS;
+using namespace SOAR_HOST;
+
+/* The pipelines compared, as templates on their scalar */
+template<typename Real> using MadgwickCascade = FilterChainT<IMU::IdentityKalmanFilter, Real, Real, MadgwickAHRST>;
+template<typename Real> using MahonyCascade = FilterChainT<IMU::IdentityKalmanFilter, Real, Real, MahonyAHRST>;
+template<typename Real> using ErrorStatePipeline = ErrorStateChainT<Real>;
+
+/* Input samples, and the true attitude and rate behind each for synthetic runs */
+struct BenchInput
+{
+	std::vector<LogSample> samples;
+	std::vector<Eigen::Vector3f> truthEulerDeg;
+	std::vector<Eigen::Vector3f> truthGyro;
+};
+
+struct PipelineResult
+{
+	std::vector<Eigen::Vector4f> attitude;	/* From the first pass */
+	std::vector<Eigen::Vector3f> gyro;		/* Rate the pipeline output, from the first pass */
+	LatencySummary sampleCycles;			/* Whole pipeline per sample */
+	OpCounts opsPerSample;					/* Mean, x1000 */
+};
+
+template<class Pipeline>
+static void step(Pipeline& filter, const LogSample& s, bool fixedRate, typename Pipeline::Output& output)
+{
+	typedef typename Pipeline::Vector3 Vector3;
+	typedef typename Vector3::Scalar Real;
+
+	const Vector3 accel = s.accel.cast<Real>(), gyro = s.gyro.cast<Real>(), mag = s.mag.cast<Real>();
+	if (fixedRate)
+		filter.step(accel, gyro, mag, output);
+	else
+		filter.step(accel, gyro, mag, Real(1.0f / AHRS_SAMPLE_RATE_HZ), output);
+}
+
+template<template<typename> class Pipeline>
+static PipelineResult runPipeline(const BenchInput& input, int repeat, bool fixedRate)
+{
+	const size_t count = input.samples.size();
+	PipelineResult result;
+	result.attitude.resize(count);
+	result.gyro.resize(count);
+	std::vector<uint64_t> sampleCycles(count * repeat);
+
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		Pipeline<float> filter;
+		typename Pipeline<float>::Output output;
+
+		for (size_t n = 0; n < count; n++)
+		{
+			step(filter, input.samples[n], fixedRate, output);
+			sampleCycles[pass * count + n] = filter.smootherCycles() + filter.orientationCycles();
+
+			if (pass == 0)
+			{
+				result.attitude[n] = output.quaternion;
+				result.gyro[n] = output.gyro;
+			}
+		}
+	}
+
+	result.sampleCycles = summarize(sampleCycles);
+
+	/* Once more on CountedFloat, for the arithmetic */
+	Pipeline<CountedFloat> counted;
+	typename Pipeline<CountedFloat>::Output output;
+	ops = OpCounts();
+
+	for (size_t n = 0; n < count; n++)
+		step(counted, input.samples[n], fixedRate, output);
+
+	result.opsPerSample.add = ops.add * 1000 / count;
+	result.opsPerSample.mul = ops.mul * 1000 / count;
+	result.opsPerSample.div = ops.div * 1000 / count;
+	result.opsPerSample.sqrt = ops.sqrt * 1000 / count;
+	result.opsPerSample.atan2 = ops.atan2 * 1000 / count;
+	return result;
+}
+
+/* Direction of gravity in the sensor frame for an attitude quaternion */
+static Eigen::Vector3f gravityDirection(const Eigen::Vector4f& q)
+{
+	return Eigen::Vector3f(2.0f * (q(1) * q(3) - q(0) * q(2)), 2.0f * (q(0) * q(1) + q(2) * q(3)),
+		q(0) * q(0) - q(1) * q(1) - q(2) * q(2) + q(3) * q(3));
+}
+
+/* Angle (deg) between two directions */
+static double angleBetween(const Eigen::Vector3f& a, const Eigen::Vector3f& b)
+{
+	double cosine = a.cast<double>().dot(b.cast<double>()) / (a.cast<double>().norm() * b.cast<double>().norm());
+	return acos(std::max(-1.0, std::min(1.0, cosine))) * (180.0 / M_PI);
+}
+
+struct Score
+{
+	Score() : sumSq(0.0), max(0.0), count(0) {}
+
+	void add(double error)
+	{
+		sumSq += error * error;
+		max = std::max(max, fabs(error));
+		count++;
+	}
+
+	double rms() const { return count ? sqrt(sumSq / count) : 0.0; }
+
+	double sumSq;
+	double max;
+	size_t count;
+};
+
+static void report(const char* name, const PipelineResult& r, const BenchInput& input, size_t settle)
+{
+	const OpCounts& o = r.opsPerSample;
+	printf("%-20s %8llu %8llu %8.1f %8.1f", name, (unsigned long long)r.sampleCycles.p50_nS,
+		(unsigned long long)r.sampleCycles.p99_nS, (o.add + o.mul) / 1000.0, (o.div + o.sqrt + o.atan2) / 1000.0);
+
+	Score rate;
+	for (size_t n = settle; n < r.gyro.size(); n++)
+	{
+		/* The recorded log is stationary, so its true rate is zero */
+		Eigen::Vector3f error = input.truthGyro.empty() ? r.gyro[n] : Eigen::Vector3f(r.gyro[n] - input.truthGyro[n]);
+		rate.add(error.norm());
+	}
+
+	if (input.truthEulerDeg.empty())
+	{
+		Score vsAccel;
+		for (size_t n = settle; n < r.attitude.size(); n++)
+			vsAccel.add(angleBetween(gravityDirection(r.attitude[n]), input.samples[n].accel));
+
+		printf("   %8.3f %8.3f   %8.3f\n", vsAccel.rms(), vsAccel.max, rate.rms());
+	}
+	else
+	{
+		Score tilt, heading;
+		for (size_t n = settle; n < r.attitude.size(); n++)
+		{
+			Eigen::Vector3f euler;
+			quaternionToEulerDeg(r.attitude[n], euler);
+
+			Eigen::Vector3f error = euler - input.truthEulerDeg[n];
+			error(2) = fmodf(error(2) + 540.0f, 360.0f) - 180.0f;
+			tilt.add(error(0));
+			tilt.add(error(1));
+			heading.add(error(2));
+		}
+		printf("   %8.3f %8.3f   %8.3f %8.3f   %8.3f\n", tilt.rms(), tilt.max, heading.rms(), heading.max, rate.rms());
+	}
+}
+
+static void runAll(const BenchInput& input, int repeat, size_t settle, bool synthetic, bool fixedRate)
+{
+	printf("%-20s %8s %8s %8s %8s", "pipeline", "cycles", "", "ops/sample", "");
+	if (synthetic)
+		printf("   %17s   %17s   %8s\n", "pitch/roll (deg)", "heading (deg)", "rate");
+	else
+		printf("   %17s   %8s\n", "tilt vs accel", "rate");
+	printf("%-20s %8s %8s %8s %8s   %8s %8s   %8s", "", "p50", "p99", "add/mul", "div/sqrt", "rms", "max", synthetic ? "rms" : "(dps)");
+	if (synthetic)
+		printf(" %8s   %8s", "max", "(dps)");
+	printf("\n");
+
+	report("cascade Madgwick", runPipeline<MadgwickCascade>(input, repeat, fixedRate), input, settle);
+	report("cascade Mahony", runPipeline<MahonyCascade>(input, repeat, fixedRate), input, settle);
+	report("eskf", runPipeline<ErrorStatePipeline>(input, repeat, fixedRate), input, settle);
+
+	ErrorStateChainT<float> eskf;
+	ErrorStateChainT<float>::Output output;
+	for (size_t n = 0; n < input.samples.size(); n++)
+		step(eskf, input.samples[n], fixedRate, output);
+
+	Eigen::Vector3f bias = eskf.gyroBiasDps();
+	printf("%-20s gyro bias estimate at the end (%.2f, %.2f, %.2f) dps\n", "", bias(0), bias(1), bias(2));
+}
+
+static void generate(const SyntheticMotion& motion, size_t count, BenchInput& input)
+{
+	SyntheticSource<> source(motion);
+	input.samples.resize(count);
+	input.truthEulerDeg.resize(count);
+	input.truthGyro.resize(count);
+
+	/* A noiseless copy gives the true rate behind each reading */
+	SyntheticMotion clean;
+	SyntheticSource<> truth(clean);
+	Eigen::Vector3f unusedAccel;
+
+	for (size_t n = 0; n < count; n++)
+	{
+		source.readInertial(input.samples[n].accel, input.samples[n].gyro);
+		truth.readInertial(unusedAccel, input.truthGyro[n]);
+
+		/* The mag group runs at half the inertial rate, so a reading is seen twice */
+		if ((n % 2) == 0)
+			source.readMag(input.samples[n].mag);
+		else
+			input.samples[n].mag = input.samples[n - 1].mag;
+
+		source.truthEulerDeg(input.truthEulerDeg[n]);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string logPath = "ahrs_recorded_output.csv";
+	int repeat = 20;
+	size_t synthetic = 0;
+	bool fixedRate = !AHRS_VARIABLE_DT;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--synthetic") && (i + 1 < argc))
+			synthetic = (size_t)std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--fixed-rate"))
+			fixedRate = true;
+		else if (!strcmp(argv[i], "--variable-dt"))
+			fixedRate = false;
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "usage: %s [log.csv] [--synthetic N] [--repeat N] [--fixed-rate | --variable-dt]\n", argv[0]);
+			return 1;
+		}
+		else
+			logPath = argv[i];
+	}
+
+	if (synthetic)
+	{
+		const size_t settle = std::min(synthetic / 2, (size_t)(AHRS_SAMPLE_RATE_HZ * 5));
+		printf("samples: %zu x %d  synthetic (MARG)  %s  counter %llu Hz  error scored after sample %zu\n", synthetic, repeat,
+			fixedRate ? "fixed rate" : "variable dt", (unsigned long long)SOAR_PROFILE::cycleCounterHz(), settle);
+
+		/* Noise on every sensor, as in host/orientation_bench.cpp */
+		SyntheticMotion motion;
+		motion.accelNoise_ms2 = 0.5f;
+		motion.gyroNoise_dps = 0.5f;
+		motion.magNoise_G = 0.01f;
+
+		BenchInput input;
+		generate(motion, synthetic, input);
+		printf("\nunbiased gyro\n");
+		runAll(input, repeat, settle, true, fixedRate);
+
+		/* About what the recorded log's gyro carries */
+		motion.gyroBias_dps << 0.5f, -12.0f, -7.5f;
+		generate(motion, synthetic, input);
+		printf("\ngyro bias (%.1f, %.1f, %.1f) dps\n", motion.gyroBias_dps(0), motion.gyroBias_dps(1), motion.gyroBias_dps(2));
+		runAll(input, repeat, settle, true, fixedRate);
+	}
+	else
+	{
+		BenchInput input;
+		std::string error;
+		if (!loadCSVLog(logPath, input.samples, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+
+		const size_t settle = std::min(input.samples.size() / 2, (size_t)(AHRS_SAMPLE_RATE_HZ * 5));
+		printf("samples: %zu x %d  recorded (IMU only)  %s  counter %llu Hz  error scored after sample %zu\n\n",
+			input.samples.size(), repeat, fixedRate ? "fixed rate" : "variable dt",
+			(unsigned long long)SOAR_PROFILE::cycleCounterHz(), settle);
+		runAll(input, repeat, settle, false, fixedRate);
+	}
+
+	return 0;
+}
@@ -0,0 +1,258 @@
+#pragma once
+#ifndef SOAR_HOST_REPLAY_LOG_HPP
+#define SOAR_HOST_REPLAY_LOG_HPP
+
+/* C/C++ Includes */
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+/* Project Includes */
+#include "sensors.hpp"
+#include "host/columnarLog.hpp"
+
+namespace SOAR_HOST
+{
+	/* One row of a recorded IMU log */
+	struct LogSample
+	{
+		Eigen::Vector3f accel;
+		Eigen::Vector3f gyro;
+		Eigen::Vector3f mag;
+		double time_S;			/* Sample time, or -1 if the log has no timestamp column */
+	};
+
+	/* Columns a log can have, in LogSample order */
+	static const char* const logColumnNames[10] = { "ax", "ay", "az", "gx", "gy", "gz", "mx", "my", "mz", "timestamp" };
+
+	/* Position of a header ("ax (m/s^2)", "ax", ...) in logColumnNames, or -1 */
+	inline int logColumn(const std::string& header)
+	{
+		std::string name = header.substr(0, header.find_first_of(" (\r"));
+		for (int i = 0; i < 10; i++)
+			if (name == logColumnNames[i])
+				return i;
+		return -1;
+	}
+
+	/**
+	* @brief Loads a CSV log into memory
+	*
+	* Columns are matched by name rather than position, so serial_to_csv.py and serial_record
+	* output (index + "ax (m/s^2)" style headers) works as well as plain "ax,ay,az,..." logs.
+	* The accel and gyro columns are required; magnetometer columns are optional
+	* and read back as zero when missing. An optional "timestamp" column (mS, as written
+	* by telemetry_decode) gives each sample's time.
+	*
+	* @param [in]  path     Path to the CSV file
+	* @param [out] samples  Parsed samples, in file order
+	* @param [out] error    Reason for failure, if any
+	* @returns true on success
+	*/
+	inline bool loadCSVLog(const std::string& path, std::vector<LogSample>& samples, std::string& error)
+	{
+		std::ifstream file(path.c_str());
+		if (!file)
+		{
+			error = "could not open " + path;
+			return false;
+		}
+
+		/* Map each known column name onto its position in the header */
+		std::string line;
+		if (!std::getline(file, line))
+		{
+			error = "empty log " + path;
+			return false;
+		}
+
+		int column[10] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+		std::stringstream header(line);
+		std::string cell;
+
+		for (int idx = 0; std::getline(header, cell, ','); idx++)
+		{
+			int i = logColumn(cell);
+			if (i >= 0)
+				column[i] = idx;
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			if (column[i] < 0)
+			{
+				error = std::string("log is missing the ") + logColumnNames[i] + " column";
+				return false;
+			}
+		}
+
+		/* Parse the data rows */
+		std::vector<double> row;
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '\r')
+				continue;
+
+			row.clear();
+			std::stringstream fields(line);
+			while (std::getline(fields, cell, ','))
+				row.push_back(strtod(cell.c_str(), nullptr));
+
+			double value[10];
+			for (int i = 0; i < 10; i++)
+				value[i] = (column[i] >= 0 && column[i] < (int)row.size()) ? row[column[i]] : 0.0;
+
+			LogSample sample;
+			sample.accel << value[0], value[1], value[2];
+			sample.gyro << value[3], value[4], value[5];
+			sample.mag << value[6], value[7], value[8];
+			sample.time_S = (column[9] >= 0) ? (value[9] * 1.0e-3) : -1.0;
+			samples.push_back(sample);
+		}
+
+		if (samples.empty())
+		{
+			error = "no samples in " + path;
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	* @brief Loads a columnar log (columnarLog.hpp), such as serial_record writes
+	*
+	* Columns are matched by name the same way as loadCSVLog().
+	*/
+	inline bool loadColumnarSamples(const std::string& path, std::vector<LogSample>& samples, std::string& error)
+	{
+		std::vector<std::string> headers;
+		std::vector<std::vector<float> > values;
+		if (!loadColumnarLog(path, headers, values, error))
+			return false;
+
+		const std::vector<float>* column[10] = {};
+		for (size_t c = 0; c < headers.size(); c++)
+		{
+			int i = logColumn(headers[c]);
+			if (i >= 0)
+				column[i] = &values[c];
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			if (!column[i])
+			{
+				error = std::string("log is missing the ") + logColumnNames[i] + " column";
+				return false;
+			}
+		}
+
+		const size_t count = column[0]->size();
+		samples.resize(count);
+		for (size_t n = 0; n < count; n++)
+		{
+			float value[10];
+			for (int i = 0; i < 10; i++)
+				value[i] = column[i] ? (*column[i])[n] : 0.0f;
+
+			samples[n].accel << value[0], value[1], value[2];
+			samples[n].gyro << value[3], value[4], value[5];
+			samples[n].mag << value[6], value[7], value[8];
+			samples[n].time_S = column[9] ? (value[9] * 1.0e-3) : -1.0;
+		}
+
+		if (samples.empty())
+		{
+			error = "no samples in " + path;
+			return false;
+		}
+
+		return true;
+	}
+
+	/* True if path ends in the given extension (".bin") */
+	inline bool hasExtension(const std::string& path, const char* extension)
+	{
+		size_t length = strlen(extension);
+		return (path.size() >= length) && (path.compare(path.size() - length, length, extension) == 0);
+	}
+
+	/**
+	* @brief Converts loaded samples into the binary record layout SOAR_AHRS::ReplaySource plays
+	*/
+	inline std::vector<SOAR_AHRS::ReplayRecord> toReplayRecords(const std::vector<LogSample>& samples)
+	{
+		std::vector<SOAR_AHRS::ReplayRecord> records(samples.size());
+		for (size_t n = 0; n < samples.size(); n++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				records[n].accel[i] = samples[n].accel(i);
+				records[n].gyro[i] = samples[n].gyro(i);
+				records[n].mag[i] = samples[n].mag(i);
+			}
+		}
+		return records;
+	}
+
+	/**
+	* @brief Loads a log for replay. Files ending in ".bin" are raw ReplayRecord arrays in host
+	* byte order, ".col" are columnar logs, and anything else is parsed as CSV with loadCSVLog().
+	*/
+	inline bool loadReplayLog(const std::string& path, std::vector<SOAR_AHRS::ReplayRecord>& records, std::string& error)
+	{
+		if (!hasExtension(path, ".bin"))
+		{
+			std::vector<LogSample> samples;
+			bool ok = hasExtension(path, ".col") ? loadColumnarSamples(path, samples, error) : loadCSVLog(path, samples, error);
+			if (!ok)
+				return false;
+
+			records = toReplayRecords(samples);
+			return true;
+		}
+
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+		{
+			error = "could not open " + path;
+			return false;
+		}
+
+		SOAR_AHRS::ReplayRecord record;
+		records.clear();
+		while (fread(&record, sizeof(record), 1, file) == 1)
+			records.push_back(record);
+		fclose(file);
+
+		if (records.empty())
+		{
+			error = "no samples in " + path;
+			return false;
+		}
+
+		return true;
+	}
+
+	/* Writes records as a raw ".bin" replay log */
+	inline bool saveReplayLog(const std::string& path, const std::vector<SOAR_AHRS::ReplayRecord>& records)
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+
+		size_t written = fwrite(records.data(), sizeof(SOAR_AHRS::ReplayRecord), records.size(), file);
+		fclose(file);
+		return (written == records.size());
+	}
+}
+
+#endif
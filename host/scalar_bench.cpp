@@ -0,0 +1,222 @@
+/**
+Host benchmark and accuracy report for the scalar types the filter chain can run in.
+
+Runs the same input through FilterChainT<IMU::IdentityKalmanFilter, Real, Attitude> with
+
+	double / double    reference
+	float  / float     the firmware default
+	float  / Q16       AHRS_ORIENTATION_SCALAR = AHRS_SCALAR_Q16
+	float  / Q29       AHRS_ORIENTATION_SCALAR = AHRS_SCALAR_Q29
+
+and reports for each the cycles one Madgwick update takes (FilterChainT::orientationCycles()),
+the cycles of the whole step, and how far its attitude strays from the double reference, as
+the angle between the two quaternions. A recorded log has no magnetometer, so it only covers
+the IMU update. --synthetic runs SyntheticSource motion instead, which covers the MARG update
+and adds the error against the known truth.
+
+Cycles are TSC counts here (cycleCounter.hpp), which rank the variants but are not M4F
+cycles: on the board float is a single instruction and double is a library call. Build the
+firmware with AHRS_ORIENTATION_SCALAR and AHRS_TRACE_ENABLED and read the orientation stage
+histogram for the real numbers.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/scalar_bench.cpp ahrsFilter.cpp -o scalar_bench
+
+Usage:
+	scalar_bench <log.csv> [--repeat N]
+	scalar_bench --synthetic N [--repeat N]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "cycleCounter.hpp"
+#include "sensors.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+
+using namespace SOAR_AHRS;
+using namespace SOAR_HOST;
+
+/* Input samples, and the true attitude behind each for synthetic runs */
+struct BenchInput
+{
+	std::vector<LogSample> samples;
+	std::vector<Eigen::Vector3f> truthEulerDeg;
+};
+
+struct ScalarResult
+{
+	std::vector<Eigen::Vector4d> attitude;	/* From the first pass */
+	LatencySummary updateCycles;			/* Per Madgwick update, averaged over each sample's updates */
+	double stepCycles;						/* Mean per FilterChainT::step() */
+};
+
+template<typename Real, typename Attitude>
+static ScalarResult run(const BenchInput& input, int repeat)
+{
+	typedef FilterChainT<IMU::IdentityKalmanFilter, Real, Attitude> Chain;
+
+	const size_t count = input.samples.size();
+	ScalarResult result;
+	result.attitude.resize(count);
+	std::vector<uint64_t> updateCycles(count * repeat);
+	uint64_t totalStepCycles = 0;
+
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		Chain filter;
+		typename Chain::Output output;
+
+		for (size_t n = 0; n < count; n++)
+		{
+			const LogSample& s = input.samples[n];
+			typename Chain::Vector3 accel = s.accel.cast<Real>();
+			typename Chain::Vector3 gyro = s.gyro.cast<Real>();
+			typename Chain::Vector3 mag = s.mag.cast<Real>();
+
+			uint32_t start = SOAR_PROFILE::cycleCount();
+			filter.step(accel, gyro, mag, output);
+			totalStepCycles += SOAR_PROFILE::cycleCount() - start;
+
+			updateCycles[pass * count + n] = filter.orientationCycles() / filter.orientationSteps();
+
+			if (pass == 0)
+				result.attitude[n] = output.quaternion.template cast<double>();
+		}
+	}
+
+	result.updateCycles = summarize(updateCycles);
+	result.stepCycles = (double)totalStepCycles / (count * repeat);
+	return result;
+}
+
+/* Angle (deg) of the rotation between two attitude quaternions */
+static double angleBetween(const Eigen::Vector4d& a, const Eigen::Vector4d& b)
+{
+	double dot = fabs(a.dot(b)) / (a.norm() * b.norm());
+	return 2.0 * acos(std::min(1.0, dot)) * (180.0 / M_PI);
+}
+
+/* Attitude error against the reference, skipping the first settle samples */
+static void compare(const ScalarResult& r, const ScalarResult& reference, size_t settle, double& rms_deg, double& max_deg)
+{
+	double sumSq = 0.0;
+	size_t count = 0;
+	max_deg = 0.0;
+	for (size_t n = settle; n < r.attitude.size(); n++)
+	{
+		double error = angleBetween(r.attitude[n], reference.attitude[n]);
+		sumSq += error * error;
+		max_deg = std::max(max_deg, error);
+		count++;
+	}
+	rms_deg = count ? sqrt(sumSq / count) : 0.0;
+}
+
+/* Largest Euler angle error against the synthetic truth after settle samples */
+static double truthError(const ScalarResult& r, const BenchInput& input, size_t settle)
+{
+	double maxError = 0.0;
+	for (size_t n = settle; n < r.attitude.size(); n++)
+	{
+		Eigen::Vector3f euler;
+		quaternionToEulerDeg(r.attitude[n], euler);
+
+		Eigen::Vector3f error = euler - input.truthEulerDeg[n];
+		error(2) = fmodf(error(2) + 540.0f, 360.0f) - 180.0f;
+		maxError = std::max(maxError, (double)error.cwiseAbs().maxCoeff());
+	}
+	return maxError;
+}
+
+static void report(const char* name, const ScalarResult& r, const ScalarResult& reference, const ScalarResult& baseline,
+	const BenchInput& input, size_t settle)
+{
+	double rms_deg, max_deg;
+	compare(r, reference, settle, rms_deg, max_deg);
+
+	printf("%-16s %8.1f %8llu %8llu %6.2fx %10.1f   %10.2e %10.2e", name, r.updateCycles.mean_nS,
+		(unsigned long long)r.updateCycles.p50_nS, (unsigned long long)r.updateCycles.p99_nS,
+		r.updateCycles.mean_nS / baseline.updateCycles.mean_nS, r.stepCycles, rms_deg, max_deg);
+
+	if (!input.truthEulerDeg.empty())
+		printf(" %10.3f", truthError(r, input, settle));
+	printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <log.csv> [--repeat N]\n"
+			"       %s --synthetic N [--repeat N]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	std::string logPath;
+	int repeat = 20;
+	size_t synthetic = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--synthetic") && (i + 1 < argc))
+			synthetic = (size_t)std::max(1, atoi(argv[++i]));
+		else if (logPath.empty())
+			logPath = argv[i];
+	}
+
+	BenchInput input;
+	if (synthetic)
+	{
+		SyntheticSource<> source;
+		input.samples.resize(synthetic);
+		input.truthEulerDeg.resize(synthetic);
+		for (size_t n = 0; n < synthetic; n++)
+		{
+			source.readInertial(input.samples[n].accel, input.samples[n].gyro);
+			source.readMag(input.samples[n].mag);
+			source.truthEulerDeg(input.truthEulerDeg[n]);
+		}
+	}
+	else
+	{
+		std::string error;
+		if (!loadCSVLog(logPath, input.samples, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+	}
+
+	/* Give every variant time to converge from the identity attitude before scoring it */
+	const size_t settle = std::min(input.samples.size() / 2, (size_t)(AHRS_SAMPLE_RATE_HZ * 5));
+
+	ScalarResult reference = run<double, double>(input, repeat);
+	ScalarResult single = run<float, float>(input, repeat);
+	ScalarResult q16 = run<float, Q16>(input, repeat);
+	ScalarResult q29 = run<float, Q29>(input, repeat);
+
+	printf("samples: %zu x %d  %s  counter %llu Hz  error scored after sample %zu\n\n", input.samples.size(), repeat,
+		synthetic ? "synthetic (MARG)" : "recorded (IMU only)", (unsigned long long)SOAR_PROFILE::cycleCounterHz(), settle);
+	printf("%-16s %8s %8s %8s %7s %10s   %10s %10s%s\n", "real/attitude", "update", "p50", "p99", "cost",
+		"step", "rms (deg)", "max (deg)", synthetic ? "  truth max" : "");
+	printf("%-16s %8s %8s %8s %7s %10s   %21s\n", "", "cycles", "", "", "vs float", "cycles", "vs double reference");
+
+	report("double/double", reference, reference, single, input, settle);
+	report("float/float", single, reference, single, input, settle);
+	report("float/Q16", q16, reference, single, input, settle);
+	report("float/Q29", q29, reference, single, input, settle);
+
+	return 0;
+}
@@ -0,0 +1,508 @@
+/**
+Records the serialTask CSV console (CONSOLE_OUTPUT_CSV) on Linux, streaming it to disk.
+
+Replaces serial_to_csv.py for long captures. The port is read as data arrives (epoll on the
+port, a signalfd for Ctrl+C and a one second timerfd for progress), every complete line is
+parsed as soon as it is in, and samples go straight out to a CSV file and/or a columnar log
+(columnarLog.hpp). Memory stays the same however long the capture runs: one read buffer, one
+line and one columnar block.
+
+The CSV has the same index + "pitch (deg),..." header serial_to_csv.py wrote, so everything
+that read those logs reads these. "#" records (run time stats, trace dumps, the boot line)
+are kept apart, in the --records file if one is given.
+
+Works on a UART (/dev/ttyUSB0, set to --baud raw 8N1), on the simulator's pseudo terminal
+(SOAR_SIM_CONSOLE=pty) and on a plain file or stdin ("-"), which replays a capture as fast
+as it parses and so shows the most the recorder can sustain.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> host/serial_record.cpp -o serial_record
+
+Usage:
+	serial_record <port | file | -> [--baud N] [--csv out.csv] [--columnar out.col]
+		[--records records.txt] [--duration S] [--quiet]
+
+Stops on Ctrl+C, at the end of a file, when the port goes away or after --duration seconds.
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+
+/* Linux Includes */
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <linux/serial.h>
+
+/* Project Includes */
+#include "config.hpp"
+#include "format.hpp"
+#include "host/columnarLog.hpp"
+
+using namespace SOAR_HOST;
+
+/* Fields of a sample line, in formatAHRSLine() order, and their CSV headers */
+static const int SAMPLE_FIELDS = 9;
+static const char* const sampleColumns[SAMPLE_FIELDS] = { "pitch (deg)", "roll (deg)", "yaw (deg)", "ax (m/s^2)",
+	"ay (m/s^2)", "az (m/s^2)", "gx (deg/s)", "gy (deg/s)", "gz (deg/s)" };
+
+static const size_t READ_BUFFER_SIZE = 64 * 1024;
+static const size_t FILE_BUFFER_SIZE = 256 * 1024;
+static const size_t COLUMNAR_BLOCK_ROWS = 4096;
+
+typedef std::chrono::steady_clock Clock;
+
+
+/*----------------------------------
+* Serial Port
+*----------------------------------*/
+static speed_t baudConstant(int baud)
+{
+	switch (baud)
+	{
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	case 460800: return B460800;
+	case 500000: return B500000;
+	case 921600: return B921600;
+	case 1000000: return B1000000;
+	case 1500000: return B1500000;
+	case 2000000: return B2000000;
+	case 3000000: return B3000000;
+	default: return B0;
+	}
+}
+
+/* Raw 8N1 at the given rate, reads returning as soon as there is anything */
+static bool configurePort(int fd, int baud)
+{
+	struct termios tty;
+	if (tcgetattr(fd, &tty) != 0)
+		return false;
+
+	cfmakeraw(&tty);
+	tty.c_cflag |= (CLOCAL | CREAD);
+	tty.c_cc[VMIN] = 1;
+	tty.c_cc[VTIME] = 0;
+
+	speed_t speed = baudConstant(baud);
+	if (speed == B0)
+	{
+		fprintf(stderr, "unsupported baud rate %d\n", baud);
+		return false;
+	}
+	cfsetispeed(&tty, speed);
+	cfsetospeed(&tty, speed);
+
+	return (tcsetattr(fd, TCSANOW, &tty) == 0) && (tcflush(fd, TCIFLUSH) == 0);
+}
+
+/* Characters the UART driver dropped (hardware and buffer overruns). false where the port
+* does not keep count, as on a pseudo terminal. */
+static bool portOverruns(int fd, uint64_t& overruns)
+{
+	struct serial_icounter_struct counters;
+	if (ioctl(fd, TIOCGICOUNT, &counters) != 0)
+		return false;
+
+	overruns = (uint64_t)counters.overrun + (uint64_t)counters.buf_overrun;
+	return true;
+}
+
+
+/*----------------------------------
+* Line Parser
+*----------------------------------*/
+/**
+* @brief Splits a byte stream into lines, a chunk at a time
+*
+* Whatever is left of a line at the end of a chunk waits for the next one. Lines longer
+* than the longest serialTask line are cut off and reported as malformed.
+*/
+class LineSplitter
+{
+public:
+	LineSplitter() : length(0), overlong(false) {}
+
+	template<typename Handler>
+	void feed(const char* data, size_t count, Handler& handler)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			char c = data[i];
+			if (c == '\n')
+			{
+				if ((length > 0) && (line[length - 1] == '\r'))
+					length--;
+				line[length] = '\0';
+
+				if (overlong)
+					handler.malformed();
+				else if (length > 0)
+					handler.line(line, length);
+
+				length = 0;
+				overlong = false;
+			}
+			else if (length < sizeof(line) - 1)
+				line[length++] = c;
+			else
+				overlong = true;
+		}
+	}
+
+private:
+	char line[SOAR_SERIAL::RUNTIME_LINE_SIZE];	/* The longest line serialTask writes */
+	size_t length;
+	bool overlong;
+};
+
+/* Reads the 9 comma separated numbers of a sample line. false if it is anything else. */
+static bool parseSample(const char* line, float* values)
+{
+	const char* p = line;
+	for (int field = 0; field < SAMPLE_FIELDS; field++)
+	{
+		char* end;
+		values[field] = strtof(p, &end);
+		if ((end == p) || !std::isfinite(values[field]))
+			return false;
+
+		if (field < SAMPLE_FIELDS - 1)
+		{
+			if (*end != ',')
+				return false;
+			p = end + 1;
+		}
+		else if (*end != '\0')
+			return false;
+	}
+	return true;
+}
+
+
+/*----------------------------------
+* Recorder
+*----------------------------------*/
+struct Recorder
+{
+	Recorder() : csv(nullptr), records(nullptr), writeColumnar(false), samples(0), recordLines(0), malformedLines(0),
+		bytes(0), failed(false) {}
+
+	FILE* csv;
+	FILE* records;
+	ColumnarWriter columnar;
+	bool writeColumnar;
+
+	uint64_t samples;
+	uint64_t recordLines;
+	uint64_t malformedLines;
+	uint64_t bytes;
+	bool failed;				/* An output could not be written */
+
+	Clock::time_point firstLine;
+	Clock::time_point lastLine;
+
+	void line(const char* text, size_t length)
+	{
+		Clock::time_point now = Clock::now();
+		if ((samples + recordLines) == 0)
+			firstLine = now;
+		lastLine = now;
+
+		if (text[0] == '#')
+		{
+			recordLines++;
+			if (records && (fprintf(records, "%s\n", text) < 0))
+				failed = true;
+			return;
+		}
+
+		float values[SAMPLE_FIELDS];
+		if (!parseSample(text, values))
+		{
+			malformedLines++;
+			return;
+		}
+
+		/* The text is written as it came in, so the CSV keeps the target's rounding */
+		if (csv && ((fprintf(csv, "%llu,", (unsigned long long)samples) < 0) ||
+			(fwrite(text, 1, length, csv) != length) || (fputc('\n', csv) == EOF)))
+			failed = true;
+
+		if (writeColumnar && !columnar.append(values))
+			failed = true;
+
+		samples++;
+	}
+
+	void malformed() { malformedLines++; }
+
+	/* Pushes everything buffered so far out to the files */
+	void flush()
+	{
+		if ((csv && fflush(csv)) || (records && fflush(records)))
+			failed = true;
+		if (writeColumnar && !columnar.flush())
+			failed = true;
+	}
+
+	double linesPerSecond() const
+	{
+		double span_S = std::chrono::duration<double>(lastLine - firstLine).count();
+		uint64_t lines = samples + recordLines;
+		return ((lines > 1) && (span_S > 0.0)) ? ((lines - 1) / span_S) : 0.0;
+	}
+};
+
+static FILE* openOutput(const std::string& path, std::vector<char>& buffer)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file)
+	{
+		buffer.resize(FILE_BUFFER_SIZE);
+		setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+	}
+	return file;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <port | file | -> [--baud N] [--csv out.csv] [--columnar out.col]\n"
+			"       [--records records.txt] [--duration S] [--quiet]\n", argv[0]);
+		return 1;
+	}
+
+	std::string inputPath = argv[1];
+	std::string csvPath, columnarPath, recordsPath;
+	int baud = CONSOLE_BAUD_RATE;
+	double duration_S = 0.0;
+	bool quiet = false;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--baud") && (i + 1 < argc))
+			baud = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--csv") && (i + 1 < argc))
+			csvPath = argv[++i];
+		else if (!strcmp(argv[i], "--columnar") && (i + 1 < argc))
+			columnarPath = argv[++i];
+		else if (!strcmp(argv[i], "--records") && (i + 1 < argc))
+			recordsPath = argv[++i];
+		else if (!strcmp(argv[i], "--duration") && (i + 1 < argc))
+			duration_S = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--quiet"))
+			quiet = true;
+	}
+
+	/*----------------------------------
+	* Input
+	*----------------------------------*/
+	int fd = (inputPath == "-") ? STDIN_FILENO : open(inputPath.c_str(), O_RDONLY | O_NOCTTY);
+	if (fd < 0)
+	{
+		fprintf(stderr, "could not open %s: %s\n", inputPath.c_str(), strerror(errno));
+		return 1;
+	}
+
+	if (isatty(fd) && !configurePort(fd, baud))
+	{
+		fprintf(stderr, "could not configure %s: %s\n", inputPath.c_str(), strerror(errno));
+		return 1;
+	}
+
+	uint64_t overrunsAtStart = 0, overruns = 0;
+	const bool countsOverruns = portOverruns(fd, overrunsAtStart);
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	/*----------------------------------
+	* Outputs
+	*----------------------------------*/
+	Recorder recorder;
+	std::vector<char> csvBuffer, recordsBuffer;
+
+	if (!csvPath.empty())
+	{
+		recorder.csv = openOutput(csvPath, csvBuffer);
+		if (!recorder.csv)
+		{
+			fprintf(stderr, "could not create %s\n", csvPath.c_str());
+			return 1;
+		}
+
+		for (int i = 0; i < SAMPLE_FIELDS; i++)
+			fprintf(recorder.csv, ",%s", sampleColumns[i]);
+		fputc('\n', recorder.csv);
+	}
+
+	if (!recordsPath.empty() && !(recorder.records = openOutput(recordsPath, recordsBuffer)))
+	{
+		fprintf(stderr, "could not create %s\n", recordsPath.c_str());
+		return 1;
+	}
+
+	recorder.writeColumnar = !columnarPath.empty();
+	if (recorder.writeColumnar &&
+		!recorder.columnar.open(columnarPath, std::vector<std::string>(sampleColumns, sampleColumns + SAMPLE_FIELDS), COLUMNAR_BLOCK_ROWS))
+	{
+		fprintf(stderr, "could not create %s\n", columnarPath.c_str());
+		return 1;
+	}
+
+	/*----------------------------------
+	* Event Sources
+	*----------------------------------*/
+	/* Ctrl+C and kill arrive as events, so a stop never lands in the middle of a write */
+	sigset_t stopSignals;
+	sigemptyset(&stopSignals);
+	sigaddset(&stopSignals, SIGINT);
+	sigaddset(&stopSignals, SIGTERM);
+	sigprocmask(SIG_BLOCK, &stopSignals, nullptr);
+	int signalFd = signalfd(-1, &stopSignals, SFD_NONBLOCK);
+
+	int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	struct itimerspec period = {};
+	period.it_interval.tv_sec = 1;
+	period.it_value.tv_sec = 1;
+	timerfd_settime(timerFd, 0, &period, nullptr);
+
+	int epollFd = epoll_create1(0);
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = signalFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+	event.data.fd = timerFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+
+	/* Regular files cannot be waited on (EPERM). They are always readable, so those are
+	* read back to back and the other events are checked between reads. */
+	event.data.fd = fd;
+	const bool waitable = (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0);
+
+	/*----------------------------------
+	* Record
+	*----------------------------------*/
+	std::vector<char> readBuffer(READ_BUFFER_SIZE);
+	LineSplitter splitter;
+	Clock::time_point start = Clock::now();
+	uint64_t linesAtLastReport = 0;
+	bool running = true;
+	const char* stopReason = "stopped";
+
+	while (running && !recorder.failed)
+	{
+		struct epoll_event events[3];
+		int ready = epoll_wait(epollFd, events, 3, waitable ? -1 : 0);
+		if ((ready < 0) && (errno != EINTR))
+			break;
+
+		bool inputReady = !waitable;
+		for (int i = 0; i < ready; i++)
+		{
+			if (events[i].data.fd == fd)
+				inputReady = true;
+			else if (events[i].data.fd == signalFd)
+			{
+				running = false;
+				stopReason = "interrupted";
+			}
+			else if (events[i].data.fd == timerFd)
+			{
+				uint64_t expirations;
+				if (read(timerFd, &expirations, sizeof(expirations)) < 0)
+					expirations = 0;
+
+				recorder.flush();
+
+				uint64_t lines = recorder.samples + recorder.recordLines;
+				if (!quiet)
+				{
+					fprintf(stderr, "\r%7.1f s  %10llu lines  %8llu lines/s  %llu malformed  %llu records",
+						std::chrono::duration<double>(Clock::now() - start).count(), (unsigned long long)lines,
+						(unsigned long long)(lines - linesAtLastReport), (unsigned long long)recorder.malformedLines,
+						(unsigned long long)recorder.recordLines);
+					if (countsOverruns && portOverruns(fd, overruns))
+						fprintf(stderr, "  %llu overruns", (unsigned long long)(overruns - overrunsAtStart));
+					fflush(stderr);
+				}
+				linesAtLastReport = lines;
+
+				if ((duration_S > 0.0) && (std::chrono::duration<double>(Clock::now() - start).count() >= duration_S))
+				{
+					running = false;
+					stopReason = "duration reached";
+				}
+			}
+		}
+
+		/* Drain everything the port has, then go back to waiting */
+		while (inputReady && running)
+		{
+			ssize_t count = read(fd, readBuffer.data(), readBuffer.size());
+			if (count > 0)
+			{
+				recorder.bytes += count;
+				splitter.feed(readBuffer.data(), (size_t)count, recorder);
+				if (!waitable)
+					break;
+			}
+			else if ((count < 0) && (errno == EAGAIN))
+				break;
+			else if ((count < 0) && (errno == EINTR))
+				continue;
+			else
+			{
+				/* 0 is the end of a file or pipe, EIO a pseudo terminal whose other end closed */
+				running = false;
+				stopReason = (count == 0) ? "end of input" : "port closed";
+			}
+		}
+	}
+
+	recorder.flush();
+	bool ok = !recorder.failed;
+	if (recorder.csv)
+		ok = (fclose(recorder.csv) == 0) && ok;
+	if (recorder.records)
+		ok = (fclose(recorder.records) == 0) && ok;
+	ok = recorder.columnar.close() && ok;
+
+	double elapsed_S = std::chrono::duration<double>(Clock::now() - start).count();
+	if (!quiet)
+		fprintf(stderr, "\n");
+
+	fprintf(stderr, "%s after %.1f s: %llu samples, %llu records, %llu malformed lines, %.1f MB read\n", stopReason, elapsed_S,
+		(unsigned long long)recorder.samples, (unsigned long long)recorder.recordLines,
+		(unsigned long long)recorder.malformedLines, recorder.bytes / 1.0e6);
+	fprintf(stderr, "sustained %.0f lines/s (first to last line)\n", recorder.linesPerSecond());
+	if (countsOverruns && portOverruns(fd, overruns))
+		fprintf(stderr, "port overruns: %llu\n", (unsigned long long)(overruns - overrunsAtStart));
+	if (!ok)
+		fprintf(stderr, "error: could not write all of the output\n");
+
+	close(epollFd);
+	close(timerFd);
+	close(signalFd);
+	if (fd != STDIN_FILENO)
+		close(fd);
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/**
+Host benchmark for the accel/gyro pre-smoother.
+
+Runs Kalman::SquareRootUnscentedKalmanFilter, IMU::WorkspaceSquareRootUKF and
+IMU::IdentityKalmanFilter side by side over a recorded log with the ahrsTask noise setup, then
+reports the cost of each and the largest difference between their state estimates.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> -I<kalman> \
+		host/smoother_bench.cpp ahrsFilter.cpp -o smoother_bench
+
+Usage:
+	smoother_bench <log.csv> [--repeat N]
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/* Project Includes */
+#include "ahrsFilter.hpp"
+#include "cycleCounter.hpp"
+#include "host/replayLog.hpp"
+#include "host/benchStats.hpp"
+
+using namespace SOAR_AHRS;
+using namespace SOAR_HOST;
+
+struct SmootherResult
+{
+	std::vector<State> estimates;
+	LatencySummary latency;
+	double cyclesPerStep;
+};
+
+template<template<class> class Smoother>
+static SmootherResult run(const std::vector<LogSample>& samples, size_t steps)
+{
+	SystemModel sys;
+	MeasurementModel om;
+	Measurement meas;
+	State x;
+
+	Smoother<State> filter(0.5f, 3.0f, 0.0f);
+	x.setZero();
+	initNoiseModels(sys, om);
+	filter.init(x);
+
+	SmootherResult result;
+	result.estimates.resize(steps);
+	std::vector<uint64_t> latencies_nS(steps);
+	uint64_t totalCycles = 0;
+
+	for (size_t n = 0; n < steps; n++)
+	{
+		const LogSample& s = samples[n % samples.size()];
+		meas << s.accel, s.gyro;
+
+		Clock::time_point start = Clock::now();
+		uint32_t startCycles = SOAR_PROFILE::cycleCount();
+
+		filter.predict(sys);
+		result.estimates[n] = filter.update(om, meas);
+
+		totalCycles += SOAR_PROFILE::cycleCount() - startCycles;
+		latencies_nS[n] = elapsed_nS(start, Clock::now());
+	}
+
+	result.latency = summarize(latencies_nS);
+	result.cyclesPerStep = (double)totalCycles / steps;
+	return result;
+}
+
+/* Largest difference in any state element over the run */
+static float maxDifference(const SmootherResult& a, const SmootherResult& b, size_t& worstStep)
+{
+	float maxError = 0.0f;
+	worstStep = 0;
+	for (size_t n = 0; n < a.estimates.size(); n++)
+	{
+		float err = (a.estimates[n] - b.estimates[n]).cwiseAbs().maxCoeff();
+		if (err > maxError)
+		{
+			maxError = err;
+			worstStep = n;
+		}
+	}
+	return maxError;
+}
+
+static void report(const char* name, const SmootherResult& r)
+{
+	printf("%-22s mean %8.1f ns  p50 %8llu ns  p99 %8llu ns  %9.0f cycles/step\n", name, r.latency.mean_nS,
+		(unsigned long long)r.latency.p50_nS, (unsigned long long)r.latency.p99_nS, r.cyclesPerStep);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <log.csv> [--repeat N]\n", argv[0]);
+		return 1;
+	}
+
+	int repeat = 100;
+	for (int i = 2; i < argc; i++)
+		if (!strcmp(argv[i], "--repeat") && (i + 1 < argc))
+			repeat = std::max(1, atoi(argv[++i]));
+
+	std::vector<LogSample> samples;
+	std::string error;
+	if (!loadCSVLog(argv[1], samples, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	const size_t steps = samples.size() * repeat;
+	SmootherResult ukf = run<Kalman::SquareRootUnscentedKalmanFilter>(samples, steps);
+	SmootherResult workspace = run<IMU::WorkspaceSquareRootUKF>(samples, steps);
+	SmootherResult closedForm = run<IMU::IdentityKalmanFilter>(samples, steps);
+
+	printf("steps: %zu\n", steps);
+	report("SR-UKF", ukf);
+	report("WorkspaceSquareRootUKF", workspace);
+	report("IdentityKalmanFilter", closedForm);
+	printf("speedup: %.1fx\n", ukf.latency.mean_nS / closedForm.latency.mean_nS);
+
+	size_t worstStep;
+	float maxError = maxDifference(ukf, closedForm, worstStep);
+	printf("max |SR-UKF - closed form|: %g (step %zu)\n", maxError, worstStep);
+	maxError = maxDifference(workspace, closedForm, worstStep);
+	printf("max |workspace SR-UKF - closed form|: %g (step %zu)\n", maxError, worstStep);
+
+	return 0;
+}
@@ -0,0 +1,175 @@
+/**
+Decodes a capture of the binary telemetry stream (CONSOLE_OUTPUT_BINARY) into CSV.
+
+	g++ -O2 -std=c++14 -I. -I<eigen> host/telemetry_decode.cpp telemetry.cpp -o telemetry_decode
+
+Usage:
+	telemetry_decode <capture.bin | -> [out.csv] [--stats stats.csv]
+
+Reads from stdin when the capture is "-" and writes to stdout when no output is given.
+The target sends its attitude as a quaternion. Each row has the Euler angles worked out
+from it, with the quaternion itself in the last four columns.
+Run time stats packets are written one row per task to the --stats file, if given. Trace
+dumps and the boot timeline are printed to stderr.
+Frame, CRC and sequence errors are summarised on stderr.
+*/
+
+/* C/C++ Includes */
+#include <cstdio>
+#include <cstring>
+
+/* Project Includes */
+#include "telemetry.hpp"
+
+using namespace SOAR_TELEMETRY;
+
+/* Names for the task ids in run time stats packets, see TaskIndex and RuntimeTaskID */
+static const char* taskName(uint8_t id)
+{
+	static const char* names[] = { "init", "ledTask", "ahrsTask", "serialTask" };
+
+	if (id < sizeof(names) / sizeof(names[0]))
+		return names[id];
+	if (id == RUNTIME_TASK_IDLE)
+		return "IDLE";
+	if (id == RUNTIME_TASK_TIMER)
+		return "Tmr Svc";
+	return "other";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <capture.bin | -> [out.csv] [--stats stats.csv]\n", argv[0]);
+		return 1;
+	}
+
+	const char* outPath = nullptr;
+	const char* statsPath = nullptr;
+	for (int i = 2; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--stats") && (i + 1 < argc))
+			statsPath = argv[++i];
+		else
+			outPath = argv[i];
+	}
+
+	FILE* in = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+	FILE* out = outPath ? fopen(outPath, "w") : stdout;
+	FILE* statsOut = statsPath ? fopen(statsPath, "w") : nullptr;
+	if (!in || !out || (statsPath && !statsOut))
+	{
+		fprintf(stderr, "could not open input/output\n");
+		return 1;
+	}
+
+	if (statsOut)
+		fprintf(statsOut, "timestamp (ms),window (ms),idle (%%),free heap (bytes),task,cpu (%%),free stack (words)\n");
+
+	fprintf(out, "sequence,timestamp (ms),pitch (deg),roll (deg),yaw (deg),ax (m/s^2),ay (m/s^2),az (m/s^2),gx (deg/s),gy (deg/s),gz (deg/s),qw,qx,qy,qz\n");
+
+	FrameDecoder decoder;
+	AHRSPacket packet;
+	RuntimeStats_t stats;
+	SOAR_PROFILE::TraceSummary trace;
+	uint32_t traceDropped = 0;
+	BootTiming_t boot;
+	uint32_t statsPackets = 0;
+	uint32_t packets = 0;
+	uint32_t dropped = 0;
+	uint32_t unknown = 0;
+	uint16_t expected = 0;
+
+	uint8_t chunk[4096];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			if (!decoder.push(chunk[i]))
+				continue;
+
+			if (decoder.packetType() == PACKET_RUNTIME)
+			{
+				if (decodeRuntimePacket(decoder.packet(), decoder.packetSize(), stats) != DECODE_OK)
+				{
+					unknown++;
+					continue;
+				}
+
+				statsPackets++;
+				for (uint8_t t = 0; statsOut && (t < stats.taskCount); t++)
+				{
+					fprintf(statsOut, "%u,%u,%.1f,%u,%s,%.1f,%u\n", stats.timestamp_mS, stats.window_mS,
+						stats.idle_permille / 10.0, stats.freeHeap_bytes, taskName(stats.tasks[t].id),
+						stats.tasks[t].cpu_permille / 10.0, stats.tasks[t].stackFree_words);
+				}
+				continue;
+			}
+
+			if (decoder.packetType() == PACKET_TRACE)
+			{
+				if (decodeTracePacket(decoder.packet(), decoder.packetSize(), trace, traceDropped) != DECODE_OK)
+				{
+					unknown++;
+					continue;
+				}
+
+				if (trace.stage == 0)
+					fprintf(stderr, "%-12s %10s %10s %10s %10s %10s  (nS, %u events dropped)\n",
+						"stage", "count", "min", "avg", "max", "p99", traceDropped);
+
+				fprintf(stderr, "%-12s %10u %10u %10u %10u %10u\n", SOAR_PROFILE::traceStageName(trace.stage),
+					trace.count, trace.min_nS, trace.avg_nS, trace.max_nS, trace.p99_nS);
+				continue;
+			}
+
+			if (decoder.packetType() == PACKET_BOOT)
+			{
+				if (decodeBootPacket(decoder.packet(), decoder.packetSize(), boot) != DECODE_OK)
+				{
+					unknown++;
+					continue;
+				}
+
+				fprintf(stderr, "boot: scheduler %.3f ms  imu ready %.3f ms  tasks resumed %.3f ms  first output %.3f ms  (calibration %s)\n",
+					boot.scheduler_uS / 1000.0, boot.imuReady_uS / 1000.0, boot.tasksResumed_uS / 1000.0,
+					boot.firstOutput_uS / 1000.0, calibrationStatusName(boot.calibration));
+				continue;
+			}
+
+			if (decodeAHRSPacket(decoder.packet(), decoder.packetSize(), packet) != DECODE_OK)
+			{
+				unknown++;
+				continue;
+			}
+
+			/* Backwards jumps mean the target rebooted, so only forward gaps count as drops */
+			uint16_t gap = packet.sequence - expected;
+			if (packets && (gap < 0x8000))
+				dropped += gap;
+			expected = packet.sequence + 1;
+			packets++;
+
+			/* Undo the rounding to int16 before converting */
+			Eigen::Vector4f q(packet.quaternion[0], packet.quaternion[1], packet.quaternion[2], packet.quaternion[3]);
+			if (q.norm() > 0.0f)
+				q.normalize();
+
+			Eigen::Vector3f euler;
+			SOAR_AHRS::quaternionToEulerDeg(q, euler);
+
+			fprintf(out, "%u,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.5f,%.5f,%.5f,%.5f\n", packet.sequence, packet.timestamp_mS,
+				euler(0), euler(1), euler(2),
+				packet.accel[0], packet.accel[1], packet.accel[2],
+				packet.gyro[0], packet.gyro[1], packet.gyro[2],
+				packet.quaternion[0], packet.quaternion[1], packet.quaternion[2], packet.quaternion[3]);
+		}
+	}
+
+	fprintf(stderr, "packets: %u  dropped: %u  stats: %u  framing errors: %u  crc errors: %u  unknown: %u\n",
+		packets, dropped, statsPackets, decoder.framingErrors, decoder.crcErrors, unknown);
+
+	return 0;
+}
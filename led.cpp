@@ -10,7 +10,6 @@
 
 /* Boost Includes */
 #include <boost/smart_ptr.hpp>
-#include <boost/make_shared.hpp>
 
 /* FreeRTOS Includes */
 #include "FreeRTOS.h"
@@ -21,6 +20,7 @@
 #include "dataTypes.hpp"
 #include "threading.hpp"
 #include "led.hpp"
+#include "staticMemory.hpp"
 
 using namespace ThorDef::GPIO;
 GPIOClass_sPtr greenLed;
@@ -39,7 +39,7 @@ namespace SOAR_LED
 		volatile UBaseType_t stackHighWaterMark_LEDSTATUS = 0;
 		#endif
 
-		greenLed = boost::make_shared<GPIOClass>(GPIOA, PIN_5, ULTRA_SPD, NOALTERNATE);
+		greenLed = SOAR_MEMORY::makePeripheral<GPIOClass>(GPIOA, PIN_5, ULTRA_SPD, NOALTERNATE);
 		
 		/* Set up the GPIO Led */
 		greenLed->mode(OUTPUT_PP);
@@ -0,0 +1,164 @@
+#pragma once
+#ifndef SOAR_LSM9DS1_SOURCE_HPP
+#define SOAR_LSM9DS1_SOURCE_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/* Thor Includes */
+#include "Thor/include/spi.h"
+#include "Thor/include/gpio.h"
+
+/* Project Includes */
+#include "LSM9DS1.hpp"
+#include "config.hpp"
+#include "sensors.hpp"
+#include "trace.hpp"
+#include "calibrationStore.hpp"
+
+namespace SOAR_AHRS
+{
+	/**
+	* @brief Sensor source for the LSM9DS1 on SPI (see the interface in sensors.hpp)
+	*
+	* Readings go from the driver's converted arrays straight into the caller's vectors,
+	* aligned to the filter frame by the axis maps as they are copied.
+	*
+	* Given a CalibrationStore, begin() takes the gyro/accel biases from it instead of
+	* calibrating, unless there are none or they were measured at too different a die
+	* temperature. Fresh biases are saved back to the store. The biases are then subtracted
+	* here rather than by the driver, so stored and measured ones go the same way. Without
+	* MAG_CAL_ONLINE the mag hard iron offset is kept the same way, and loaded back into the
+	* sensor's offset registers instead of running the blocking calibrateMag().
+	*
+	* @tparam InertialAxes   Accel/gyro to filter frame
+	* @tparam MagAxes        Magnetometer to filter frame
+	*/
+	template<typename InertialAxes = LSM9DS1InertialAxes, typename MagAxes = LSM9DS1MagAxes>
+	class LSM9DS1Source
+	{
+	public:
+		/**
+		* @param [in] store    Calibration to start from and save to. NULL calibrates on every boot.
+		*/
+		LSM9DS1Source(SPIClass_sPtr spi, GPIOClass_sPtr xgSelect, GPIOClass_sPtr mSelect, CalibrationStore* store = NULL)
+			: imu(spi, xgSelect, mSelect), store(store)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				gyroBias[i] = 0.0f;
+				accelBias[i] = 0.0f;
+			}
+		}
+
+		/* Returns false if the WHO_AM_I registers did not read back */
+		bool begin()
+		{
+			if (imu.begin() == 0)
+				return false;
+
+			bool measured = false;
+
+			if (store)
+			{
+				/* 16 LSB per degree, zero at 25C */
+				imu.readTemp();
+				const float temperature_C = 25.0f + imu.temperature / 16.0f;
+
+				if (!store->inertialUsable(temperature_C))
+				{
+					imu.calibrate(false); /* "false" measures the biases but leaves the subtraction to readInertial() */
+					store->setInertial(imu.gBias, imu.aBias, temperature_C);
+					measured = true;
+				}
+
+				for (int i = 0; i < 3; i++)
+				{
+					gyroBias[i] = store->gyroBias()[i];
+					accelBias[i] = store->accelBias()[i];
+				}
+			}
+			else
+			{
+				imu.calibrate(true); /* "true" forces an automatic software subtraction of the calculated bias from all further data */
+			}
+
+			#if !(MAG_CAL_ONLINE)
+			int16_t magOffset[3];
+			if (store && store->magOffset(magOffset))
+			{
+				for (uint8_t axis = 0; axis < 3; axis++)
+					imu.magOffset(axis, magOffset[axis]);
+			}
+			else
+			{
+				imu.calibrateMag(true); /* "true" writes the offest into the mag sensor hardware for automatic subtraction in results */
+
+				if (store)
+				{
+					store->setMagOffset(imu.mBiasRaw);
+					measured = true;
+				}
+			}
+			#endif
+
+			if (measured)
+				store->save();
+
+			return true;
+		}
+
+		uint32_t samplesReady()
+		{
+			#if (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO)
+			/* The threshold interrupt fires at IMU_FIFO_THRESHOLD entries, but more may have
+			* landed since then */
+			return imu.getFIFOSamples();
+			#else
+			return 1;
+			#endif
+		}
+
+		void readInertial(Eigen::Vector3f& accel, Eigen::Vector3f& gyro)
+		{
+			/* In FIFO mode each gyro + accel read pops one entry */
+			TRACE_BEGIN(TRACE_SPI_READ);
+			imu.readGyro();
+			imu.readAccel();
+			TRACE_END(TRACE_SPI_READ);
+
+			/* Convert raw data from chip into meaningful data */
+			TRACE_BEGIN(TRACE_CONVERT);
+			imu.calcAccel();
+			imu.calcGyro();
+			for (int i = 0; i < 3; i++)
+			{
+				imu.aRaw[i] -= accelBias[i];
+				imu.gRaw[i] -= gyroBias[i];
+			}
+			InertialAxes::apply(imu.aRaw, accel);
+			InertialAxes::apply(imu.gRaw, gyro);
+			TRACE_END(TRACE_CONVERT);
+		}
+
+		void readMag(Eigen::Vector3f& mag)
+		{
+			imu.readMag();
+			imu.calcMag();
+			MagAxes::apply(imu.mRaw, mag);
+		}
+
+		/* The driver itself, for setting up the data ready interrupt */
+		LSM9DS1& device() { return imu; }
+
+	private:
+		LSM9DS1 imu;
+		CalibrationStore* store;
+
+		/* Sensor frame, zero when the driver subtracts its own */
+		float gyroBias[3];
+		float accelBias[3];
+	};
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "magCalibration.hpp"
+
+/* C/C++ Includes */
+#include <math.h>
+
+namespace SOAR_AHRS
+{
+	/* Per sample decay of the normal equations */
+	static const float forget = 1.0f - 1.0f / MAG_CAL_WINDOW;
+
+	MagCalibrator::MagCalibrator(bool deferred) :
+		deferred(deferred),
+		solveState(SOLVE_IDLE)
+	{
+		reset();
+	}
+
+	void MagCalibrator::reset()
+	{
+		DtD.setZero();
+		Dt1.setZero();
+		weight = 0.0f;
+		samples = 0;
+		sinceSolve = 0;
+
+		valid = false;
+		offset.setZero();
+		transform.setIdentity();
+		field_G = 0.0f;
+		lastResidual = 0.0f;
+		acceptedCount = 0;
+		rejectedCount = 0;
+
+		solveState.store(SOLVE_IDLE, std::memory_order_relaxed);
+	}
+
+	void MagCalibrator::setCorrection(const Eigen::Vector3f& hardIron, const Eigen::Matrix3f& softIron)
+	{
+		offset = hardIron;
+		transform = softIron;
+		valid = true;
+	}
+
+	bool MagCalibrator::addSample(const Eigen::Vector3f& mag)
+	{
+		/* A deferred solve that finished since the last sample */
+		bool acceptedNew = false;
+		if (solveState.load(std::memory_order_acquire) == SOLVE_DONE)
+		{
+			acceptedNew = adopt(solution);
+			solveState.store(SOLVE_IDLE, std::memory_order_release);
+		}
+
+		const float x = mag(0), y = mag(1), z = mag(2);
+
+		Row row;
+		row << x * x, y * y, z * z, 2.0f * x * y, 2.0f * x * z, 2.0f * y * z, 2.0f * x, 2.0f * y, 2.0f * z;
+
+		DtD *= forget;
+		DtD.noalias() += row * row.transpose();
+		Dt1 = forget * Dt1 + row;
+		weight = forget * weight + 1.0f;
+
+		samples++;
+		if (++sinceSolve < MAG_CAL_SOLVE_INTERVAL || samples < MAG_CAL_MIN_SAMPLES)
+			return acceptedNew;
+
+		if (!deferred)
+		{
+			sinceSolve = 0;
+			solution.residual = lastResidual;	/* Kept as it is if the solve fails before getting that far */
+			solve(DtD, Dt1, weight, solution);
+			return adopt(solution);
+		}
+
+		/* Still busy with the last one, try again next sample */
+		if (solveState.load(std::memory_order_relaxed) != SOLVE_IDLE)
+			return acceptedNew;
+
+		sinceSolve = 0;
+		solution.residual = lastResidual;
+		jobDtD = DtD;
+		jobDt1 = Dt1;
+		jobWeight = weight;
+		solveState.store(SOLVE_QUEUED, std::memory_order_release);
+		return acceptedNew;
+	}
+
+	bool MagCalibrator::service()
+	{
+		if (solveState.load(std::memory_order_acquire) != SOLVE_QUEUED)
+			return false;
+
+		solve(jobDtD, jobDt1, jobWeight, solution);
+		solveState.store(SOLVE_DONE, std::memory_order_release);
+		return true;
+	}
+
+	bool MagCalibrator::adopt(const Solution& result)
+	{
+		lastResidual = result.residual;
+		if (!result.ok)
+		{
+			rejectedCount++;
+			return false;
+		}
+
+		offset = result.offset;
+		transform = result.transform;
+		field_G = result.field_G;
+		valid = true;
+		acceptedCount++;
+		return true;
+	}
+
+	void MagCalibrator::apply(Eigen::Vector3f& mag) const
+	{
+		if (valid)
+			mag = transform * (mag - offset);
+	}
+
+	void MagCalibrator::solve(const Normal& DtD, const Row& Dt1, float weight, Solution& result)
+	{
+		/* The normal equations are badly conditioned when the motion only covers part of the
+		* ellipsoid, so the solve runs in double. It happens about once a second. */
+		const Eigen::Matrix<double, 9, 9> N = DtD.cast<double>();
+		const Eigen::Matrix<double, 9, 1> v = Dt1.cast<double>();
+
+		result.ok = false;
+
+		Eigen::LDLT<Eigen::Matrix<double, 9, 9> > ldlt(N);
+		if (ldlt.info() != Eigen::Success)
+			return;
+
+		const Eigen::Matrix<double, 9, 1> p = ldlt.solve(v);
+
+		/* RMS of (row . p - 1), from the same sums */
+		const double sse = p.dot(N * p) - 2.0 * p.dot(v) + weight;
+		result.residual = (float)sqrt(((sse > 0.0) ? sse : 0.0) / weight);
+		if (result.residual > MAG_CAL_MAX_RESIDUAL)
+			return;
+
+		Eigen::Matrix3d A;
+		A <<
+			p(0), p(3), p(4),
+			p(3), p(1), p(5),
+			p(4), p(5), p(2);
+		const Eigen::Vector3d b(p(6), p(7), p(8));
+
+		/* Centre, and the ellipsoid around it: (m - c)^T (A / k) (m - c) = 1 */
+		const Eigen::Vector3d centre = -A.ldlt().solve(b);
+		const double k = 1.0 + centre.dot(A * centre);
+		if (!(k > 0.0))
+			return;
+
+		Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen(A / k);
+		const Eigen::Vector3d axes = eigen.eigenvalues();
+		if (!(axes.minCoeff() > 0.0))
+			return;
+
+		/* Semi-axes are 1/sqrt(eigenvalue). Scale the correction to their geometric mean. */
+		const double radius = pow(axes.prod(), -1.0 / 6.0);
+		const double axisRatio = sqrt(axes.maxCoeff() / axes.minCoeff());
+		if (radius < MAG_CAL_MIN_FIELD_G || radius > MAG_CAL_MAX_FIELD_G || axisRatio > MAG_CAL_MAX_AXIS_RATIO)
+			return;
+
+		const Eigen::Matrix3d root = eigen.eigenvectors() * axes.cwiseSqrt().asDiagonal() * eigen.eigenvectors().transpose();
+
+		result.offset = centre.cast<float>();
+		result.transform = (radius * root).cast<float>();
+		result.field_G = (float)radius;
+		result.ok = true;
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef SOAR_MAG_CALIBRATION_HPP
+#define SOAR_MAG_CALIBRATION_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <atomic>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+/* Project Includes */
+#include "config.hpp"
+
+namespace SOAR_AHRS
+{
+	/**
+	* @brief Streaming hard and soft iron calibration for the magnetometer
+	*
+	* Every reading m = (x, y, z) of a constant field seen through hard iron (an offset) and
+	* soft iron (a scaling/shear) lies on an ellipsoid
+	*
+	*	a x^2 + b y^2 + c z^2 + 2h xy + 2g xz + 2f yz + 2p x + 2q y + 2r z = 1
+	*
+	* Each sample adds one row of that least squares problem to the normal equations, which
+	* are the only state kept: a 9x9 matrix and a 9 vector, decayed so the fit follows slow
+	* changes and forgets a bad stretch of data. Every MAG_CAL_SOLVE_INTERVAL samples the
+	* equations are solved and, if the result is a plausible ellipsoid, it replaces the
+	* correction used by apply():
+	*
+	*	m' = softIron * (m - hardIron)
+	*
+	* softIron maps the ellipsoid onto a sphere of the fitted field strength, so corrected
+	* readings keep their units. Until the first solution is accepted readings pass through
+	* unchanged.
+	*
+	* The solve runs in double, which the M4F emulates in software. A deferred calibrator
+	* only copies the equations out when one is due and leaves the solve to service(),
+	* called from a lower priority task (calibrationTask.hpp). addSample() picks the result
+	* up on a later sample.
+	*/
+	class MagCalibrator
+	{
+	public:
+		/**
+		* @param [in] deferred    false: addSample() solves in line, true: service() does
+		*/
+		MagCalibrator(bool deferred = false);
+
+		/**
+		* @brief Adds a raw reading (filter frame, gauss) to the fit, solving or queueing a
+		* solve when one is due
+		* @returns true if a new correction was accepted
+		*/
+		bool addSample(const Eigen::Vector3f& mag);
+
+		/**
+		* @brief Runs the queued solve of a deferred calibrator, if there is one. Safe to call
+		* from one other task while addSample() runs.
+		* @returns true if it solved
+		*/
+		bool service();
+
+		/**
+		* @brief Applies the current correction in place
+		*/
+		void apply(Eigen::Vector3f& mag) const;
+
+		/**
+		* @brief Starts from a known correction, e.g. one saved from an earlier run. The fit
+		* carries on from scratch and replaces it once it has enough data.
+		*/
+		void setCorrection(const Eigen::Vector3f& hardIron, const Eigen::Matrix3f& softIron);
+
+		/* Forgets every sample and goes back to passing readings through. Not while service() runs. */
+		void reset();
+
+		bool calibrated() const { return valid; }
+		const Eigen::Vector3f& hardIron() const { return offset; }
+		const Eigen::Matrix3f& softIron() const { return transform; }
+		float fieldStrength() const { return field_G; }		/* Radius of the last accepted fit */
+		float residual() const { return lastResidual; }		/* RMS error of the last solve, relative to the ellipsoid equation */
+		uint32_t accepted() const { return acceptedCount; }
+		uint32_t rejected() const { return rejectedCount; }
+
+	private:
+		typedef Eigen::Matrix<float, 9, 9> Normal;
+		typedef Eigen::Matrix<float, 9, 1> Row;
+
+		Normal DtD;					/* Decayed sum of row * row^T */
+		Row Dt1;					/* Decayed sum of row */
+		float weight;				/* Decayed number of samples */
+		uint32_t samples;
+		uint32_t sinceSolve;
+
+		bool valid;
+		Eigen::Vector3f offset;
+		Eigen::Matrix3f transform;
+		float field_G;
+		float lastResidual;
+		uint32_t acceptedCount;
+		uint32_t rejectedCount;
+
+		/* What one solve made of the equations */
+		struct Solution
+		{
+			bool ok;
+			Eigen::Vector3f offset;
+			Eigen::Matrix3f transform;
+			float field_G;
+			float residual;
+		};
+
+		enum SolveState
+		{
+			SOLVE_IDLE,			/* Owned by addSample() */
+			SOLVE_QUEUED,		/* job is waiting for service() */
+			SOLVE_DONE			/* solution is waiting for addSample() */
+		};
+
+		/* Hand off to service(). Whoever the state says owns job and solution may touch them. */
+		bool deferred;
+		std::atomic<int> solveState;
+		Normal jobDtD;
+		Row jobDt1;
+		float jobWeight;
+		Solution solution;
+
+		static void solve(const Normal& DtD, const Row& Dt1, float weight, Solution& result);
+		bool adopt(const Solution& result);
+	};
+}
+
+#endif
@@ -89,6 +89,10 @@ DEPENDENCIES:
 #include "ahrs.hpp"
 #include "coms.hpp"
 #include "led.hpp"
+#include "calibrationTask.hpp"
+#include "staticMemory.hpp"
+#include "cycleCounter.hpp"
+#include "bootTiming.hpp"
 
 
 void init(void* parameter);
@@ -98,6 +102,10 @@ int main(void)
 	HAL_Init();	/* Initializes STM32 Cube Stuff */
 	ThorInit();	/* Initializes custom things for Thor, like the MCU and peripheral clocks */
 
+	/* Time zero for the boot timeline. The clocks are final from here on. */
+	SOAR_PROFILE::enableCycleCounter();
+	SOAR_PROFILE::bootMark(SOAR_PROFILE::BOOT_MAIN);
+
 	
 	/*	Useful for several of the debugging functionalities like the
 		Chronometer and Performance Profiler in VGDB */
@@ -106,7 +114,7 @@ int main(void)
 	InitializeInstrumentingProfiler();
 	#endif 
 
-	xTaskCreate(init, "init", 500, NULL, 1, &TaskHandle[INIT_TASK]);
+	createTask<INIT_TASK, INIT_TASK_STACK_WORDS>(init, "init", 1);
 	vTaskStartScheduler();
 
 	/* We will never reach here as the scheduler should have taken over */
@@ -117,6 +125,8 @@ int main(void)
 
 void init(void* parameter)
 {
+	SOAR_PROFILE::bootMark(SOAR_PROFILE::BOOT_SCHEDULER);
+
 	/* Initialize the pointers to all task handles (except for INIT_TASK). This
 	* prevents errors in calling xTaskSendMessage should a task no longer exist.
 	* */
@@ -131,17 +141,22 @@ void init(void* parameter)
 	* 1. LedStatus
 	* 2. Serial
 	* 3. AHRS
+	* 4. Calibration
 	* */
 
-	error = xTaskCreate(SOAR_LED::ledTask, "ledTask", 350, NULL, STATUS_LEDS_PRIORITY, &TaskHandle[LED_STATUS_TASK]);
+	error = createTask<LED_STATUS_TASK, LED_TASK_STACK_WORDS>(SOAR_LED::ledTask, "ledTask", STATUS_LEDS_PRIORITY);
+	while (!ulTaskNotifyTake(pdTRUE, 0))
+		vTaskDelayUntil(&lastTimeWoken, pdMS_TO_TICKS(10));
+
+	error = createTask<SERIAL_TASK, SERIAL_TASK_STACK_WORDS>(SOAR_SERIAL::serialTask, "serialTask", STATUS_LEDS_PRIORITY);
 	while (!ulTaskNotifyTake(pdTRUE, 0))
 		vTaskDelayUntil(&lastTimeWoken, pdMS_TO_TICKS(10));
 
-	error = xTaskCreate(SOAR_SERIAL::serialTask, "serialTask", 1000, NULL, STATUS_LEDS_PRIORITY, &TaskHandle[SERIAL_TASK]);
+	error = createTask<AHRS_TASK, AHRS_TASK_STACK_WORDS>(SOAR_AHRS::ahrsTask, "ahrsTask", AHRS_UPDATE_PRIORITY);
 	while (!ulTaskNotifyTake(pdTRUE, 0))
 		vTaskDelayUntil(&lastTimeWoken, pdMS_TO_TICKS(10));
 
-	error = xTaskCreate(SOAR_AHRS::ahrsTask, "ahrsTask", 8000, NULL, AHRS_UPDATE_PRIORITY, &TaskHandle[AHRS_TASK]);
+	error = createTask<CALIBRATION_TASK, CAL_TASK_STACK_WORDS>(SOAR_AHRS::calibrationTask, "calTask", CALIBRATION_PRIORITY);
 	while (!ulTaskNotifyTake(pdTRUE, 0))
 		vTaskDelayUntil(&lastTimeWoken, pdMS_TO_TICKS(10));
 
@@ -150,7 +165,9 @@ void init(void* parameter)
 	volatile TaskHandle_t hAhrs = TaskHandle[AHRS_TASK];
 	volatile TaskHandle_t hLed = TaskHandle[LED_STATUS_TASK];
 	volatile TaskHandle_t hSerial = TaskHandle[SERIAL_TASK];
+	volatile TaskHandle_t hCalibration = TaskHandle[CALIBRATION_TASK];
 	volatile size_t bytesRemaining = xPortGetFreeHeapSize();
+	volatile uint32_t bootAllocations = SOAR_MEMORY::heapGuardBootAllocations();
 	#endif
 
 
@@ -162,13 +179,18 @@ void init(void* parameter)
 	}
 
 
+	/* Every task has done its setup, so in static allocation mode nothing may touch the heap from here on */
+	SOAR_MEMORY::heapGuardLock();
+
 	/* Resume all tasks in the correct order */
+	SOAR_PROFILE::bootMark(SOAR_PROFILE::BOOT_TASKS_RESUMED);
 	vTaskResume(TaskHandle[LED_STATUS_TASK]);
 	vTaskResume(TaskHandle[SERIAL_TASK]);
 	vTaskResume(TaskHandle[AHRS_TASK]);
+	vTaskResume(TaskHandle[CALIBRATION_TASK]);
 	
 
 	/* Ensure a clean deletion of the task upon exit */
-	TaskHandle[INIT_TASK] = (void*)0;	//Deletes our personal log of this task's existence
+	TaskHandle[INIT_TASK] = (TaskHandle_t)0;	//Deletes our personal log of this task's existence
 	vTaskDelete(NULL);					//Deletes the kernel's log of this task's existence
 }
\ No newline at end of file
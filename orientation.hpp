@@ -0,0 +1,616 @@
+#pragma once
+#ifndef SOAR_ORIENTATION_HPP
+#define SOAR_ORIENTATION_HPP
+
+/* C/C++ Includes */
+#include <math.h>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+/* Project Includes */
+#include "fixedPoint.hpp"
+
+namespace SOAR_AHRS
+{
+	const float DEG_TO_RAD = 0.01745329252f;
+	const float RAD_TO_DEG = 57.2957795131f;
+
+	/*----------------------------------
+	* Quaternion to Euler
+	*----------------------------------*/
+	/* Each angle on its own, so a consumer that needs one pays for one. q is [w, x, y, z]. */
+	inline float quaternionPitchDeg(float q0, float q1, float q2, float q3)
+	{
+		float sinPitch = -2.0f * (q1 * q3 - q0 * q2);
+		if (sinPitch > 1.0f)
+			sinPitch = 1.0f;
+		else if (sinPitch < -1.0f)
+			sinPitch = -1.0f;
+
+		return asinf(sinPitch) * RAD_TO_DEG;
+	}
+
+	inline float quaternionRollDeg(float q0, float q1, float q2, float q3)
+	{
+		return atan2f(q0 * q1 + q2 * q3, 0.5f - q1 * q1 - q2 * q2) * RAD_TO_DEG;
+	}
+
+	inline float quaternionYawDeg(float q0, float q1, float q2, float q3)
+	{
+		return atan2f(q1 * q2 + q0 * q3, 0.5f - q2 * q2 - q3 * q3) * RAD_TO_DEG;
+	}
+
+	/**
+	* @brief Attitude quaternion [w, x, y, z] as [PITCH, ROLL, YAW] (deg)
+	*
+	* Pitch is clamped to +/-90 deg. Close to that, roll and yaw stop being independent and
+	* small changes in the quaternion swing them wildly, so anything that does its own math
+	* on the attitude should use the quaternion.
+	*/
+	template<typename Quaternion>
+	inline void quaternionToEulerDeg(const Quaternion& q, Eigen::Vector3f& euler)
+	{
+		euler(0) = quaternionPitchDeg(q[0], q[1], q[2], q[3]);
+		euler(1) = quaternionRollDeg(q[0], q[1], q[2], q[3]);
+		euler(2) = quaternionYawDeg(q[0], q[1], q[2], q[3]);
+	}
+
+	/**
+	* @brief Madgwick's gradient descent orientation filter (MARG and IMU-only forms)
+	*
+	* Same algorithm as the fixed rate MadgwickFilter, except the integration step is passed
+	* into every update, so the filter can follow the measured time between samples instead
+	* of assuming a constant rate.
+	*
+	* The filter state and arithmetic are in Scalar, which is float, double or a Fixed point
+	* type (fixedPoint.hpp). Inputs come in as whatever the pre-smoother runs in and are
+	* scaled on the way in so every intermediate stays inside +/-2, which is what lets Q2.29
+	* work at all:
+	*	- accel and mag are normalised to half length
+	*	- the gyro is turned into the half angle turned through this step (0.5 * w * dt)
+	*	- the gradient is worked out at a quarter scale, which normalising it undoes
+	*
+	* @tparam Scalar  float, double, Q16 or Q29
+	*/
+	template<typename Scalar>
+	class MadgwickAHRST
+	{
+	public:
+		MadgwickAHRST(float beta) : beta(beta)
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			q0 = Scalar(1);
+			q1 = Scalar(0);
+			q2 = Scalar(0);
+			q3 = Scalar(0);
+		}
+
+		/**
+		* @brief Integrates one step
+		*
+		* @param [in] accel    Accelerometer, any unit (only the direction is used)
+		* @param [in] gyro     Gyroscope (dps)
+		* @param [in] mag      Magnetometer, any unit. All zeros falls back to the IMU-only update.
+		* @param [in] dt       Integration step (s)
+		*/
+		template<typename Real>
+		void update(const Eigen::Matrix<Real, 3, 1>& accel, const Eigen::Matrix<Real, 3, 1>& gyro,
+			const Eigen::Matrix<Real, 3, 1>& mag, Real dt)
+		{
+			const Real zero = Real(0);
+			const Real halfStep = Real(0.5) * Real(0.017453292519943295) * dt;
+
+			Scalar hx = Scalar(gyro(0) * halfStep);
+			Scalar hy = Scalar(gyro(1) * halfStep);
+			Scalar hz = Scalar(gyro(2) * halfStep);
+
+			/* Change in the quaternion from the gyroscope over this step */
+			Scalar d0 = -q1 * hx - q2 * hy - q3 * hz;
+			Scalar d1 = q0 * hx + q2 * hz - q3 * hy;
+			Scalar d2 = q0 * hy - q1 * hz + q3 * hx;
+			Scalar d3 = q0 * hz + q1 * hy - q2 * hx;
+
+			/* Feedback only when the accelerometer gives a usable direction */
+			if (!((accel(0) == zero) && (accel(1) == zero) && (accel(2) == zero)))
+			{
+				Scalar s0, s1, s2, s3;
+
+				Real halfRecipNorm = Real(0.5) / squareRoot(accel.squaredNorm());
+				Scalar ax = Scalar(accel(0) * halfRecipNorm);
+				Scalar ay = Scalar(accel(1) * halfRecipNorm);
+				Scalar az = Scalar(accel(2) * halfRecipNorm);
+
+				if ((mag(0) == zero) && (mag(1) == zero) && (mag(2) == zero))
+					gradientIMU(ax, ay, az, s0, s1, s2, s3);
+				else
+				{
+					halfRecipNorm = Real(0.5) / squareRoot(mag.squaredNorm());
+					Scalar mx = Scalar(mag(0) * halfRecipNorm);
+					Scalar my = Scalar(mag(1) * halfRecipNorm);
+					Scalar mz = Scalar(mag(2) * halfRecipNorm);
+
+					gradientMARG(ax, ay, az, mx, my, mz, s0, s1, s2, s3);
+				}
+
+				if (normalize4(s0, s1, s2, s3))
+				{
+					Scalar betaStep = Scalar(Real(beta) * dt);
+					d0 -= betaStep * s0;
+					d1 -= betaStep * s1;
+					d2 -= betaStep * s2;
+					d3 -= betaStep * s3;
+				}
+			}
+
+			/* Integrate and re-normalise */
+			q0 += d0;
+			q1 += d1;
+			q2 += d2;
+			q3 += d3;
+
+			normalize4(q0, q1, q2, q3);
+		}
+
+		/**
+		* @brief Attitude as [PITCH, ROLL, YAW] (deg)
+		*/
+		void getEulerDeg(Eigen::Vector3f& euler) const
+		{
+			quaternionToEulerDeg(quaternion(), euler);
+		}
+
+		/* Attitude quaternion, [w, x, y, z] */
+		template<typename Real = float>
+		Eigen::Matrix<Real, 4, 1> quaternion() const
+		{
+			return Eigen::Matrix<Real, 4, 1>(Real(q0), Real(q1), Real(q2), Real(q3));
+		}
+
+	private:
+		float beta;
+		Scalar q0, q1, q2, q3;
+
+		/**
+		* @brief Objective function gradient for gravity only, over 4
+		*
+		* The gradient is J'f, f being the difference between where the attitude puts gravity
+		* and where the accelerometer says it is, and J its Jacobian. Both are halved here.
+		*
+		* @param [in] ax, ay, az   Accelerometer, normalised to a length of 0.5
+		*/
+		void gradientIMU(Scalar ax, Scalar ay, Scalar az, Scalar& s0, Scalar& s1, Scalar& s2, Scalar& s3) const
+		{
+			const Scalar half = Scalar(0.5f);
+			Scalar _2q1 = q1 + q1;
+			Scalar _2q2 = q2 + q2;
+
+			Scalar fx = q1 * q3 - q0 * q2 - ax;
+			Scalar fy = q0 * q1 + q2 * q3 - ay;
+			Scalar fz = half - q1 * q1 - q2 * q2 - az;
+
+			s0 = -q2 * fx + q1 * fy;
+			s1 = q3 * fx + q0 * fy - _2q1 * fz;
+			s2 = -q0 * fx + q3 * fy - _2q2 * fz;
+			s3 = q1 * fx + q2 * fy;
+		}
+
+		/**
+		* @brief Objective function gradient for gravity and the earth magnetic field, over 4
+		*
+		* As gradientIMU(), with three more rows for the field. The earth frame reference
+		* field (bx, 0, bz) and the mag residuals are halved along with everything else.
+		*
+		* @param [in] mx, my, mz   Magnetometer, normalised to a length of 0.5
+		*/
+		void gradientMARG(Scalar ax, Scalar ay, Scalar az, Scalar mx, Scalar my, Scalar mz,
+			Scalar& s0, Scalar& s1, Scalar& s2, Scalar& s3) const
+		{
+			const Scalar half = Scalar(0.5f);
+			Scalar _2q0mx = (q0 + q0) * mx;
+			Scalar _2q0my = (q0 + q0) * my;
+			Scalar _2q0mz = (q0 + q0) * mz;
+			Scalar _2q1mx = (q1 + q1) * mx;
+			Scalar _2q1 = q1 + q1;
+			Scalar _2q2 = q2 + q2;
+			Scalar q0q0 = q0 * q0;
+			Scalar q0q1 = q0 * q1;
+			Scalar q0q2 = q0 * q2;
+			Scalar q0q3 = q0 * q3;
+			Scalar q1q1 = q1 * q1;
+			Scalar q1q2 = q1 * q2;
+			Scalar q1q3 = q1 * q3;
+			Scalar q2q2 = q2 * q2;
+			Scalar q2q3 = q2 * q3;
+			Scalar q3q3 = q3 * q3;
+
+			/* Reference direction of the earth's magnetic field */
+			Scalar hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+			Scalar hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+			Scalar bx = squareRoot(hx * hx + hy * hy);
+			Scalar bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+			Scalar _2bx = bx + bx;
+			Scalar _2bz = bz + bz;
+
+			Scalar fx = q1q3 - q0q2 - ax;
+			Scalar fy = q0q1 + q2q3 - ay;
+			Scalar fz = half - q1q1 - q2q2 - az;
+			Scalar fmx = bx * (half - q2q2 - q3q3) + bz * (q1q3 - q0q2) - mx;
+			Scalar fmy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3) - my;
+			Scalar fmz = bx * (q0q2 + q1q3) + bz * (half - q1q1 - q2q2) - mz;
+
+			s0 = -q2 * fx + q1 * fy - bz * q2 * fmx + (-bx * q3 + bz * q1) * fmy + bx * q2 * fmz;
+			s1 = q3 * fx + q0 * fy - _2q1 * fz + bz * q3 * fmx + (bx * q2 + bz * q0) * fmy + (bx * q3 - _2bz * q1) * fmz;
+			s2 = -q0 * fx + q3 * fy - _2q2 * fz + (-_2bx * q2 - bz * q0) * fmx + (bx * q1 + bz * q3) * fmy + (bx * q0 - _2bz * q2) * fmz;
+			s3 = q1 * fx + q2 * fy + (-_2bx * q3 + bz * q1) * fmx + (-bx * q0 + bz * q2) * fmy + bx * q1 * fmz;
+		}
+	};
+
+	/* The firmware's float filter */
+	typedef MadgwickAHRST<float> MadgwickAHRS;
+
+	/**
+	* @brief Mahony's explicit complementary filter (MARG and IMU-only forms)
+	*
+	* Instead of a gradient step on the quaternion, the error between where the attitude puts
+	* gravity (and the earth field) and where the sensors see it is turned into a rotation
+	* rate, fed back into the gyro through a PI controller. One update is a cross product and
+	* a rotation, with no iteration needed to converge, so one step per sample is enough.
+	*
+	* Same interface and scalar support as MadgwickAHRST. Accel and mag are normalised to unit
+	* length and the correction is added to the half angle turned through the step, which
+	* keeps every intermediate inside +/-2.
+	*
+	* @tparam Scalar  float, double, Q16 or Q29
+	*/
+	template<typename Scalar>
+	class MahonyAHRST
+	{
+	public:
+		/**
+		* @param [in] kp    Proportional gain (1/s), how fast the attitude is pulled onto the reference directions
+		* @param [in] ki    Integral gain (1/s^2), how fast a gyro bias is learned. 0 turns it off.
+		*/
+		MahonyAHRST(float kp, float ki) : kp(kp), ki(ki)
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			q0 = Scalar(1);
+			q1 = Scalar(0);
+			q2 = Scalar(0);
+			q3 = Scalar(0);
+			bias0 = Scalar(0);
+			bias1 = Scalar(0);
+			bias2 = Scalar(0);
+		}
+
+		/**
+		* @brief Integrates one step, as MadgwickAHRST::update()
+		*/
+		template<typename Real>
+		void update(const Eigen::Matrix<Real, 3, 1>& accel, const Eigen::Matrix<Real, 3, 1>& gyro,
+			const Eigen::Matrix<Real, 3, 1>& mag, Real dt)
+		{
+			const Real zero = Real(0);
+			const Real halfStep = Real(0.5) * Real(0.017453292519943295) * dt;
+
+			Scalar hx = Scalar(gyro(0) * halfStep);
+			Scalar hy = Scalar(gyro(1) * halfStep);
+			Scalar hz = Scalar(gyro(2) * halfStep);
+
+			/* Feedback only when the accelerometer gives a usable direction */
+			if (!((accel(0) == zero) && (accel(1) == zero) && (accel(2) == zero)))
+			{
+				Real recipNorm = Real(1) / squareRoot(accel.squaredNorm());
+				Scalar ax = Scalar(accel(0) * recipNorm);
+				Scalar ay = Scalar(accel(1) * recipNorm);
+				Scalar az = Scalar(accel(2) * recipNorm);
+
+				/* Half the direction of gravity the attitude predicts */
+				const Scalar half = Scalar(0.5f);
+				Scalar vx = q1 * q3 - q0 * q2;
+				Scalar vy = q0 * q1 + q2 * q3;
+				Scalar vz = q0 * q0 - half + q3 * q3;
+
+				/* Half the rotation that takes the prediction onto the measurement */
+				Scalar ex = ay * vz - az * vy;
+				Scalar ey = az * vx - ax * vz;
+				Scalar ez = ax * vy - ay * vx;
+
+				if (!((mag(0) == zero) && (mag(1) == zero) && (mag(2) == zero)))
+				{
+					recipNorm = Real(1) / squareRoot(mag.squaredNorm());
+					Scalar mx = Scalar(mag(0) * recipNorm);
+					Scalar my = Scalar(mag(1) * recipNorm);
+					Scalar mz = Scalar(mag(2) * recipNorm);
+
+					Scalar wx, wy, wz;
+					fieldDirection(mx, my, mz, wx, wy, wz);
+
+					ex += my * wz - mz * wy;
+					ey += mz * wx - mx * wz;
+					ez += mx * wy - my * wx;
+				}
+
+				/* The bias is kept as a half angle rate, like the gyro term it corrects */
+				if (ki > 0.0f)
+				{
+					Scalar kiStep = Scalar(Real(ki) * dt);
+					bias0 += kiStep * ex;
+					bias1 += kiStep * ey;
+					bias2 += kiStep * ez;
+
+					Scalar step = Scalar(dt);
+					hx += bias0 * step;
+					hy += bias1 * step;
+					hz += bias2 * step;
+				}
+
+				Scalar kpStep = Scalar(Real(kp) * dt);
+				hx += kpStep * ex;
+				hy += kpStep * ey;
+				hz += kpStep * ez;
+			}
+
+			/* Integrate and re-normalise */
+			Scalar d0 = -q1 * hx - q2 * hy - q3 * hz;
+			Scalar d1 = q0 * hx + q2 * hz - q3 * hy;
+			Scalar d2 = q0 * hy - q1 * hz + q3 * hx;
+			Scalar d3 = q0 * hz + q1 * hy - q2 * hx;
+
+			q0 += d0;
+			q1 += d1;
+			q2 += d2;
+			q3 += d3;
+
+			normalize4(q0, q1, q2, q3);
+		}
+
+		/**
+		* @brief Attitude as [PITCH, ROLL, YAW] (deg)
+		*/
+		void getEulerDeg(Eigen::Vector3f& euler) const
+		{
+			quaternionToEulerDeg(quaternion(), euler);
+		}
+
+		/* Attitude quaternion, [w, x, y, z] */
+		template<typename Real = float>
+		Eigen::Matrix<Real, 4, 1> quaternion() const
+		{
+			return Eigen::Matrix<Real, 4, 1>(Real(q0), Real(q1), Real(q2), Real(q3));
+		}
+
+	private:
+		float kp;
+		float ki;
+		Scalar q0, q1, q2, q3;
+		Scalar bias0, bias1, bias2;				/* Learned gyro bias correction, half angle rate (rad/s / 2) */
+
+		/**
+		* @brief Half the direction of the earth field the attitude predicts
+		*
+		* The measured field is taken to the earth frame, flattened onto (bx, 0, bz) so only
+		* heading matters, and brought back to the sensor frame.
+		*
+		* @param [in] mx, my, mz   Magnetometer, unit length
+		*/
+		void fieldDirection(Scalar mx, Scalar my, Scalar mz, Scalar& wx, Scalar& wy, Scalar& wz) const
+		{
+			const Scalar half = Scalar(0.5f);
+			Scalar q0q1 = q0 * q1;
+			Scalar q0q2 = q0 * q2;
+			Scalar q0q3 = q0 * q3;
+			Scalar q1q1 = q1 * q1;
+			Scalar q1q2 = q1 * q2;
+			Scalar q1q3 = q1 * q3;
+			Scalar q2q2 = q2 * q2;
+			Scalar q2q3 = q2 * q3;
+			Scalar q3q3 = q3 * q3;
+
+			/* Half the field in the earth frame */
+			Scalar hx = mx * (half - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2);
+			Scalar hy = mx * (q1q2 + q0q3) + my * (half - q1q1 - q3q3) + mz * (q2q3 - q0q1);
+			Scalar bz = mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (half - q1q1 - q2q2);
+			Scalar bx = squareRoot(hx * hx + hy * hy);
+
+			/* The reference is at half length, so w comes out at a quarter and is doubled to match v */
+			wx = bx * (half - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+			wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+			wz = bx * (q0q2 + q1q3) + bz * (half - q1q1 - q2q2);
+
+			wx += wx;
+			wy += wy;
+			wz += wz;
+		}
+	};
+
+	/**
+	* @brief Quaternion complementary filter (MARG and IMU-only forms)
+	*
+	* Integrates the gyro, then pulls the attitude a fraction of the way onto the tilt the
+	* accelerometer measures and, separately, onto the heading the magnetometer measures
+	* (Valenti, Dryanovski and Xiao, "Keeping a Good Attitude", 2015). Each correction is the
+	* shortest rotation between where the attitude puts a reference direction in the earth
+	* frame and where it should be, blended with no rotation by gain * dt. The accelerometer
+	* correction leaves heading alone and the magnetometer correction only turns about the
+	* vertical, so a bad mag reading can never tilt the attitude.
+	*
+	* Same interface and scalar support as MadgwickAHRST, and no iteration needed to converge.
+	*
+	* @tparam Scalar  float, double, Q16 or Q29
+	*/
+	template<typename Scalar>
+	class ComplementaryAHRST
+	{
+	public:
+		/**
+		* @param [in] accelGain    Fraction of the tilt error corrected per second (1/s)
+		* @param [in] magGain      Fraction of the heading error corrected per second (1/s)
+		*/
+		ComplementaryAHRST(float accelGain, float magGain) : accelGain(accelGain), magGain(magGain)
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			q0 = Scalar(1);
+			q1 = Scalar(0);
+			q2 = Scalar(0);
+			q3 = Scalar(0);
+		}
+
+		/**
+		* @brief Integrates one step, as MadgwickAHRST::update()
+		*/
+		template<typename Real>
+		void update(const Eigen::Matrix<Real, 3, 1>& accel, const Eigen::Matrix<Real, 3, 1>& gyro,
+			const Eigen::Matrix<Real, 3, 1>& mag, Real dt)
+		{
+			const Real zero = Real(0);
+			const Real halfStep = Real(0.5) * Real(0.017453292519943295) * dt;
+
+			Scalar hx = Scalar(gyro(0) * halfStep);
+			Scalar hy = Scalar(gyro(1) * halfStep);
+			Scalar hz = Scalar(gyro(2) * halfStep);
+
+			/* Gyro prediction */
+			Scalar d0 = -q1 * hx - q2 * hy - q3 * hz;
+			Scalar d1 = q0 * hx + q2 * hz - q3 * hy;
+			Scalar d2 = q0 * hy - q1 * hz + q3 * hx;
+			Scalar d3 = q0 * hz + q1 * hy - q2 * hx;
+
+			q0 += d0;
+			q1 += d1;
+			q2 += d2;
+			q3 += d3;
+
+			/* A step stretches q by about |h|^2, too little to matter to toEarth(), and correct()
+			* normalises it anyway */
+			if ((accel(0) == zero) && (accel(1) == zero) && (accel(2) == zero))
+			{
+				normalize4(q0, q1, q2, q3);
+				return;
+			}
+
+			/* Tilt correction: turn measured gravity, taken to the earth frame, onto +z */
+			Real halfRecipNorm = Real(0.5) / squareRoot(accel.squaredNorm());
+			Scalar gx, gy, gz;
+			toEarth(Scalar(accel(0) * halfRecipNorm), Scalar(accel(1) * halfRecipNorm), Scalar(accel(2) * halfRecipNorm),
+				gx, gy, gz);
+
+			Scalar c0 = Scalar(0.5f) + gz;
+			Scalar c1 = gy;
+			Scalar c2 = -gx;
+			Scalar c3 = Scalar(0);
+			if (blend(Real(accelGain) * dt, c0, c1, c2, c3))
+				correct(c0, c1, c2, c3);
+
+			if ((mag(0) == zero) && (mag(1) == zero) && (mag(2) == zero))
+				return;
+
+			/* Heading correction: turn the horizontal part of the field, in the earth frame, onto +x */
+			halfRecipNorm = Real(0.5) / squareRoot(mag.squaredNorm());
+			Scalar lx, ly, lz;
+			toEarth(Scalar(mag(0) * halfRecipNorm), Scalar(mag(1) * halfRecipNorm), Scalar(mag(2) * halfRecipNorm),
+				lx, ly, lz);
+
+			Scalar horizontal = squareRoot(lx * lx + ly * ly);
+			c0 = horizontal + lx;
+			c1 = Scalar(0);
+			c2 = Scalar(0);
+			c3 = -ly;
+
+			/* Pointing exactly south, where a half turn either way is the shortest */
+			if (!(c0 > Scalar(0)))
+				c3 = horizontal;
+
+			if (blend(Real(magGain) * dt, c0, c1, c2, c3))
+				correct(c0, c1, c2, c3);
+		}
+
+		/**
+		* @brief Attitude as [PITCH, ROLL, YAW] (deg)
+		*/
+		void getEulerDeg(Eigen::Vector3f& euler) const
+		{
+			quaternionToEulerDeg(quaternion(), euler);
+		}
+
+		/* Attitude quaternion, [w, x, y, z] */
+		template<typename Real = float>
+		Eigen::Matrix<Real, 4, 1> quaternion() const
+		{
+			return Eigen::Matrix<Real, 4, 1>(Real(q0), Real(q1), Real(q2), Real(q3));
+		}
+
+	private:
+		float accelGain;
+		float magGain;
+		Scalar q0, q1, q2, q3;
+
+		/* Rotates a sensor frame vector into the earth frame. A half length input stays half length. */
+		void toEarth(Scalar x, Scalar y, Scalar z, Scalar& ex, Scalar& ey, Scalar& ez) const
+		{
+			const Scalar half = Scalar(0.5f);
+			Scalar ex2 = x * (half - q2 * q2 - q3 * q3) + y * (q1 * q2 - q0 * q3) + z * (q1 * q3 + q0 * q2);
+			Scalar ey2 = x * (q1 * q2 + q0 * q3) + y * (half - q1 * q1 - q3 * q3) + z * (q2 * q3 - q0 * q1);
+			Scalar ez2 = x * (q1 * q3 - q0 * q2) + y * (q2 * q3 + q0 * q1) + z * (half - q1 * q1 - q2 * q2);
+
+			ex = ex2 + ex2;
+			ey = ey2 + ey2;
+			ez = ez2 + ez2;
+		}
+
+		/**
+		* @brief Blends the correction c with no rotation, c ends up fraction of the way along it
+		*
+		* Linear interpolation, which is close enough to the exact spherical one for the small
+		* fraction a step applies. The result is left unnormalised, correct() takes care of that.
+		*
+		* @returns false if c is degenerate and there is nothing to correct
+		*/
+		template<typename Real>
+		bool blend(Real fraction, Scalar& c0, Scalar& c1, Scalar& c2, Scalar& c3) const
+		{
+			if (!normalize4(c0, c1, c2, c3))
+				return false;
+
+			if (fraction > Real(1))
+				fraction = Real(1);
+
+			Scalar f = Scalar(fraction);
+			c0 = Scalar(1) - f + f * c0;
+			c1 = f * c1;
+			c2 = f * c2;
+			c3 = f * c3;
+			return true;
+		}
+
+		/* Applies an earth frame rotation to the attitude, q = c * q */
+		void correct(Scalar c0, Scalar c1, Scalar c2, Scalar c3)
+		{
+			Scalar n0 = c0 * q0 - c1 * q1 - c2 * q2 - c3 * q3;
+			Scalar n1 = c0 * q1 + c1 * q0 + c2 * q3 - c3 * q2;
+			Scalar n2 = c0 * q2 - c1 * q3 + c2 * q0 + c3 * q1;
+			Scalar n3 = c0 * q3 + c1 * q2 - c2 * q1 + c3 * q0;
+
+			q0 = n0;
+			q1 = n1;
+			q2 = n2;
+			q3 = n3;
+
+			normalize4(q0, q1, q2, q3);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "rateGroup.hpp"
+#include "cycleCounter.hpp"
+
+/* C/C++ Includes */
+#include <string.h>
+
+namespace SOAR_SCHEDULE
+{
+	RateGroupExecutive::RateGroupExecutive(uint32_t baseRateHz) :
+		count(0),
+		baseRateHz(baseRateHz),
+		frameOverrunCount(0)
+	{
+		basePeriodCycles = (uint32_t)(SOAR_PROFILE::cycleCounterHz() / baseRateHz);
+	}
+
+	int RateGroupExecutive::add(const char* name, uint32_t divisor, RateGroupCallback callback, void* context)
+	{
+		if (count >= RATE_GROUP_MAX)
+			return -1;
+
+		Group& group = groups[count];
+		group.name = name;
+		group.divisor = (divisor > 0) ? divisor : 1;
+		group.callback = callback;
+		group.context = context;
+
+		/* Due on the first tick */
+		group.phase = group.divisor - 1;
+		group.ticksSinceRun = 0;
+		group.lastStartCycles = 0;
+		group.started = false;
+		memset(&group.stats, 0, sizeof(group.stats));
+
+		return (int)count++;
+	}
+
+	void RateGroupExecutive::tick(uint32_t baseTicks)
+	{
+		if (baseTicks == 0)
+			return;
+
+		const uint32_t frameStart = SOAR_PROFILE::cycleCount();
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Group& group = groups[i];
+
+			group.phase += baseTicks;
+			group.ticksSinceRun += baseTicks;
+
+			if (group.phase < group.divisor)
+				continue;
+
+			/* Keep the remainder so a late tick does not shift the group's phase */
+			const uint32_t periods = group.phase / group.divisor;
+			group.phase -= periods * group.divisor;
+
+			const uint32_t start = SOAR_PROFILE::cycleCount();
+
+			if (group.started)
+			{
+				const uint32_t interval = start - group.lastStartCycles;
+				const uint32_t nominal = group.ticksSinceRun * basePeriodCycles;
+
+				group.stats.lastJitterCycles = (interval > nominal) ? (interval - nominal) : (nominal - interval);
+				if (group.stats.lastJitterCycles > group.stats.maxJitterCycles)
+					group.stats.maxJitterCycles = group.stats.lastJitterCycles;
+			}
+
+			group.callback(group.context, periods);
+
+			const uint32_t exec = SOAR_PROFILE::cycleCount() - start;
+			group.stats.lastExecCycles = exec;
+			if (exec > group.stats.maxExecCycles)
+				group.stats.maxExecCycles = exec;
+			if (exec > group.divisor * basePeriodCycles)
+				group.stats.overruns++;
+
+			group.stats.runs++;
+			group.stats.coalesced += periods - 1;
+
+			group.lastStartCycles = start;
+			group.ticksSinceRun = 0;
+			group.started = true;
+		}
+
+		if ((SOAR_PROFILE::cycleCount() - frameStart) > baseTicks * basePeriodCycles)
+			frameOverrunCount++;
+	}
+
+	void RateGroupExecutive::resetStats()
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			memset(&groups[i].stats, 0, sizeof(groups[i].stats));
+			groups[i].started = false;
+		}
+
+		frameOverrunCount = 0;
+	}
+}
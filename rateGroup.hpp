@@ -0,0 +1,121 @@
+#pragma once
+#ifndef SOAR_RATE_GROUP_HPP
+#define SOAR_RATE_GROUP_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/* Project Includes */
+#include "config.hpp"
+
+namespace SOAR_SCHEDULE
+{
+	/**
+	* @brief Work registered with a RateGroupExecutive
+	*
+	* @param [in] context  Pointer given at registration
+	* @param [in] periods  Group periods elapsed since the last run. 1 normally, more when a
+	*                      single tick covered several (a FIFO batch, a task running late).
+	*/
+	typedef void (*RateGroupCallback)(void* context, uint32_t periods);
+
+	struct RateGroupStats
+	{
+		uint32_t runs;
+		uint32_t coalesced;			/* Periods folded into a later run because one tick covered several */
+		uint32_t overruns;			/* Runs that took longer than the group's own period */
+		uint32_t lastExecCycles;
+		uint32_t maxExecCycles;
+		uint32_t lastJitterCycles;	/* |measured - nominal| time between the starts of two runs */
+		uint32_t maxJitterCycles;
+	};
+
+	/**
+	* @brief Base tick divisor that runs a group at no more than rateHz
+	*/
+	constexpr uint32_t divisorForRate(uint32_t baseRateHz, uint32_t rateHz)
+	{
+		return (rateHz >= baseRateHz) ? 1u : ((baseRateHz + rateHz - 1u) / rateHz);
+	}
+
+	/**
+	* @brief Base tick divisor that runs a group no more often than every period_mS
+	*/
+	constexpr uint32_t divisorForPeriod(uint32_t baseRateHz, uint32_t period_mS)
+	{
+		return (period_mS == 0u) ? 1u : ((baseRateHz * period_mS + 999u) / 1000u);
+	}
+
+	/**
+	* @brief Runs registered callbacks at integer divisors of a base tick
+	*
+	* The owning task calls tick() once per base period, however it waits for it (a delay,
+	* a data ready edge, a FIFO threshold). Each group runs when its divisor worth of base
+	* ticks has gone by, in registration order, so a slow group registered first still
+	* feeds fresh data to the ones after it. Raising the base rate only changes the divisors.
+	*
+	* Every run is timed on the cycle counter. A group overruns when one run takes longer
+	* than its period, and jitter is the distance between the measured and nominal time
+	* between two starts. A frame overrun is a tick whose groups together took longer than
+	* the base ticks it covered.
+	*/
+	class RateGroupExecutive
+	{
+	public:
+		/**
+		* @param [in] baseRateHz   Rate tick() is called at
+		*/
+		RateGroupExecutive(uint32_t baseRateHz);
+
+		/**
+		* @brief Registers a group. Groups cannot be removed.
+		*
+		* Every group runs on the first tick, then once per divisor base ticks.
+		*
+		* @param [in] name         For debugging
+		* @param [in] divisor      Base ticks per run, see divisorForRate() and divisorForPeriod()
+		* @returns The group index, or -1 if RATE_GROUP_MAX groups are already registered
+		*/
+		int add(const char* name, uint32_t divisor, RateGroupCallback callback, void* context);
+
+		/**
+		* @brief Advances the base tick and runs every group that came due
+		*
+		* @param [in] baseTicks    Base periods since the last call
+		*/
+		void tick(uint32_t baseTicks = 1);
+
+		void resetStats();
+
+		const RateGroupStats& stats(int group) const { return groups[group].stats; }
+		const char* name(int group) const { return groups[group].name; }
+		uint32_t rateHz(int group) const { return baseRateHz / groups[group].divisor; }
+		uint32_t groupCount() const { return count; }
+		uint32_t frameOverruns() const { return frameOverrunCount; }
+
+	private:
+		struct Group
+		{
+			const char* name;
+			uint32_t divisor;
+			RateGroupCallback callback;
+			void* context;
+
+			uint32_t phase;				/* Base ticks towards the next run */
+			uint32_t ticksSinceRun;
+			uint32_t lastStartCycles;
+			bool started;
+
+			RateGroupStats stats;
+		};
+
+		Group groups[RATE_GROUP_MAX];
+		uint32_t count;
+
+		uint32_t baseRateHz;
+		uint32_t basePeriodCycles;
+		uint32_t frameOverrunCount;
+	};
+}
+
+#endif
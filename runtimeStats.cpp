@@ -0,0 +1,128 @@
+#include "runtimeStats.hpp"
+
+/* C/C++ Includes */
+#include <string.h>
+
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+/* Project Includes */
+#include "config.hpp"
+#include "threading.hpp"
+#include "cycleCounter.hpp"
+
+
+/*----------------------------------
+* Run Time Stats Clock
+*----------------------------------*/
+/* CYCCNT wraps every ~25s at 168MHz. It is extended in software on every read (at least
+* once per context switch) and divided down, giving a ~10MHz clock that wraps every ~7min.
+* Only the kernel calls this, either from the context switch or with the scheduler
+* suspended, so the extension needs no further locking. */
+static const uint32_t runTimeClockShift = 4;
+static uint32_t lastCycles = 0;
+static uint32_t cycleWraps = 0;
+
+extern "C" void vConfigureRunTimeStatsTimer(void)
+{
+	SOAR_PROFILE::enableCycleCounter();
+	lastCycles = SOAR_PROFILE::cycleCount();
+	cycleWraps = 0;
+}
+
+extern "C" uint32_t ulGetRunTimeCounterValue(void)
+{
+	uint32_t now = SOAR_PROFILE::cycleCount();
+	if (now < lastCycles)
+		cycleWraps++;
+	lastCycles = now;
+
+	return (cycleWraps << (32 - runTimeClockShift)) | (now >> runTimeClockShift);
+}
+
+
+namespace SOAR_PROFILE
+{
+	static TaskStatus_t taskStatus[RUNTIME_STATS_MAX_TASKS];
+
+	/* Run time counters at the previous sample, keyed by the kernel's task number */
+	static UBaseType_t lastTaskNumber[RUNTIME_STATS_MAX_TASKS];
+	static uint32_t lastTaskCounter[RUNTIME_STATS_MAX_TASKS];
+	static UBaseType_t lastTaskCount = 0;
+	static uint32_t lastTotalRunTime = 0;
+	static TickType_t lastSampleTick = 0;
+
+	static uint8_t taskID(TaskHandle_t handle)
+	{
+		for (int task = 0; task < TOTAL_TASK_SIZE; task++)
+			if (TaskHandle[task] == handle)
+				return (uint8_t)task;
+
+		if (handle == xTaskGetIdleTaskHandle())
+			return RUNTIME_TASK_IDLE;
+
+		if (handle == xTimerGetTimerDaemonTaskHandle())
+			return RUNTIME_TASK_TIMER;
+
+		return RUNTIME_TASK_OTHER;
+	}
+
+	static uint32_t previousCounter(UBaseType_t taskNumber)
+	{
+		for (UBaseType_t i = 0; i < lastTaskCount; i++)
+			if (lastTaskNumber[i] == taskNumber)
+				return lastTaskCounter[i];
+
+		/* Task was created during the window */
+		return 0;
+	}
+
+	bool sampleRuntimeStats(RuntimeStats_t& stats)
+	{
+		uint32_t totalRunTime = 0;
+		UBaseType_t count = uxTaskGetSystemState(taskStatus, RUNTIME_STATS_MAX_TASKS, &totalRunTime);
+		if (count == 0)
+			return false;
+
+		TickType_t now = xTaskGetTickCount();
+		uint32_t window = totalRunTime - lastTotalRunTime;
+
+		stats.timestamp_mS = TICKS_TO_MS(now);
+		stats.window_mS = TICKS_TO_MS(now - lastSampleTick);
+		stats.freeHeap_bytes = xPortGetFreeHeapSize();
+		stats.idle_permille = 0;
+		stats.taskCount = (uint8_t)count;
+
+		for (UBaseType_t i = 0; i < count; i++)
+		{
+			const TaskStatus_t& status = taskStatus[i];
+			TaskRuntime_t& task = stats.tasks[i];
+
+			uint32_t used = status.ulRunTimeCounter - previousCounter(status.xTaskNumber);
+
+			task.id = taskID(status.xHandle);
+			task.cpu_permille = window ? (uint16_t)(((uint64_t)used * 1000u + window / 2) / window) : 0;
+			task.stackFree_words = status.usStackHighWaterMark;
+
+			strncpy(task.name, status.pcTaskName, RUNTIME_TASK_NAME_LEN - 1);
+			task.name[RUNTIME_TASK_NAME_LEN - 1] = 0;
+
+			if (task.id == RUNTIME_TASK_IDLE)
+				stats.idle_permille = task.cpu_permille;
+		}
+
+		/* Remember the counters for the next window */
+		for (UBaseType_t i = 0; i < count; i++)
+		{
+			lastTaskNumber[i] = taskStatus[i].xTaskNumber;
+			lastTaskCounter[i] = taskStatus[i].ulRunTimeCounter;
+		}
+
+		lastTaskCount = count;
+		lastTotalRunTime = totalRunTime;
+		lastSampleTick = now;
+		return true;
+	}
+}
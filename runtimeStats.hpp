@@ -0,0 +1,24 @@
+#pragma once
+#ifndef SOAR_RUNTIME_STATS_HPP
+#define SOAR_RUNTIME_STATS_HPP
+
+/* Project Includes */
+#include "dataTypes.hpp"
+
+namespace SOAR_PROFILE
+{
+	/**
+	* @brief Measures per-task CPU usage since the previous call
+	*
+	* Uses the FreeRTOS run time counters (configGENERATE_RUN_TIME_STATS), which are clocked
+	* from the DWT cycle counter, so the figures include time spent in interrupts that
+	* preempted each task. Stack high water marks and free heap are sampled at the same time.
+	* Call from one task only.
+	*
+	* @param [out] stats    Usage over the window since the last call (since boot on the first)
+	* @returns false if there are more than RUNTIME_STATS_MAX_TASKS tasks
+	*/
+	extern bool sampleRuntimeStats(RuntimeStats_t& stats);
+}
+
+#endif
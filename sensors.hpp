@@ -0,0 +1,336 @@
+#pragma once
+#ifndef SOAR_SENSORS_HPP
+#define SOAR_SENSORS_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <type_traits>
+#include <utility>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+/* Project Includes */
+#include "config.hpp"
+#include "orientation.hpp"
+
+namespace SOAR_AHRS
+{
+	/*----------------------------------
+	* Axis Alignment
+	*----------------------------------*/
+	constexpr int axisIndex(int axis) { return ((axis > 0) ? axis : -axis) - 1; }
+
+	/**
+	* @brief Compile time mapping from a sensor's axes onto the filter frame
+	*
+	* Each parameter names the sensor axis (1 = x, 2 = y, 3 = z) that feeds that filter axis,
+	* negated where the two point opposite ways. AxisMap<1, 2, 3> is the identity and
+	* AxisMap<-1, -2, -3> flips every axis. All of it resolves at compile time, so apply()
+	* is three loads and at most three negations.
+	*/
+	template<int X, int Y, int Z>
+	struct AxisMap
+	{
+		static_assert((axisIndex(X) >= 0) && (axisIndex(X) < 3) && (axisIndex(Y) >= 0) && (axisIndex(Y) < 3) &&
+			(axisIndex(Z) >= 0) && (axisIndex(Z) < 3), "AxisMap axes are +/-1, +/-2 or +/-3");
+		static_assert((axisIndex(X) != axisIndex(Y)) && (axisIndex(Y) != axisIndex(Z)) && (axisIndex(X) != axisIndex(Z)),
+			"AxisMap must use each sensor axis once");
+
+		/**
+		* @param [in]  in     Sensor reading, anything indexable with [0] to [2]
+		* @param [out] out    The same reading in the filter frame
+		*/
+		template<typename Reading>
+		static void apply(const Reading& in, Eigen::Vector3f& out)
+		{
+			out(0) = (X > 0) ? (float)in[axisIndex(X)] : -(float)in[axisIndex(X)];
+			out(1) = (Y > 0) ? (float)in[axisIndex(Y)] : -(float)in[axisIndex(Y)];
+			out(2) = (Z > 0) ? (float)in[axisIndex(Z)] : -(float)in[axisIndex(Z)];
+		}
+	};
+
+	typedef AxisMap<1, 2, 3> IdentityAxes;
+
+	/* The LSM9DS1 accel and gyro share a frame, which is the filter frame */
+	typedef AxisMap<1, 2, 3> LSM9DS1InertialAxes;
+
+	/* Mag x and y are flipped against the accel, and mag z points opposite to accel z */
+	typedef AxisMap<-1, -2, -3> LSM9DS1MagAxes;
+
+
+	/*----------------------------------
+	* Sensor Source Interface
+	*----------------------------------*/
+	/**
+	* A sensor source is any class with these members:
+	*
+	*	bool begin()                                    Bring up and calibrate. false if unusable.
+	*	uint32_t samplesReady()                         Accel/gyro samples waiting to be read
+	*	void readInertial(Eigen::Vector3f& accel,       Next sample in the filter frame (m/s^2, dps)
+	*		Eigen::Vector3f& gyro)
+	*	void readMag(Eigen::Vector3f& mag)              Latest field in the filter frame (gauss)
+	*
+	* Consumers take the source as a template parameter, so every call is resolved at compile
+	* time and inlined; there is no base class. IsSensorSource<T> checks a type fits.
+	*/
+	class SensorSourceCheck
+	{
+		template<typename Source>
+		static auto test(int) -> decltype(
+			(bool)std::declval<Source&>().begin(),
+			(uint32_t)std::declval<Source&>().samplesReady(),
+			std::declval<Source&>().readInertial(std::declval<Eigen::Vector3f&>(), std::declval<Eigen::Vector3f&>()),
+			std::declval<Source&>().readMag(std::declval<Eigen::Vector3f&>()),
+			std::true_type());
+
+		template<typename Source>
+		static std::false_type test(...);
+
+	public:
+		template<typename Source>
+		using result = decltype(test<Source>(0));
+	};
+
+	template<typename Source>
+	struct IsSensorSource : SensorSourceCheck::result<Source> {};
+
+	/* Samples behind each wakeup for sources without a FIFO of their own. In FIFO mode the
+	* data ready timer fires once per IMU_FIFO_THRESHOLD samples. */
+	inline uint32_t nominalBatchSize()
+	{
+		return (AHRS_ACQUISITION_MODE == AHRS_ACQUISITION_FIFO) ? IMU_FIFO_THRESHOLD : 1;
+	}
+
+
+	/*----------------------------------
+	* Replay Source
+	*----------------------------------*/
+	/* One sample of a binary replay log. A log is a plain array of these. */
+	struct ReplayRecord
+	{
+		float accel[3];		/* m/s^2 */
+		float gyro[3];		/* dps */
+		float mag[3];		/* gauss, all zero if the log has no magnetometer */
+	};
+	static_assert(sizeof(ReplayRecord) == 9 * sizeof(float), "ReplayRecord must stay a packed array of floats");
+
+	/**
+	* @brief Plays back recorded samples, one record per readInertial()
+	*
+	* The records are not copied, so a log can sit in flash or in a host tool's buffer.
+	*
+	* @tparam Axes   Mapping from the log's frame to the filter frame
+	*/
+	template<typename Axes = IdentityAxes>
+	class ReplaySource
+	{
+	public:
+		/**
+		* @param [in] records   Log to play
+		* @param [in] count     Records in the log
+		* @param [in] loop      Start over at the end, rather than report no more samples
+		*/
+		ReplaySource(const ReplayRecord* records, size_t count, bool loop = true)
+			: records(records), count(count), loop(loop), next(0), current(0)
+		{
+		}
+
+		bool begin() { return (records != nullptr) && (count > 0); }
+
+		uint32_t samplesReady()
+		{
+			if (finished())
+				return 0;
+
+			size_t remaining = count - next;
+			uint32_t batch = nominalBatchSize();
+			return (loop || (remaining >= batch)) ? batch : (uint32_t)remaining;
+		}
+
+		void readInertial(Eigen::Vector3f& accel, Eigen::Vector3f& gyro)
+		{
+			if (finished())
+				return;
+
+			current = next;
+			Axes::apply(records[current].accel, accel);
+			Axes::apply(records[current].gyro, gyro);
+
+			next++;
+			if (loop && (next == count))
+				next = 0;
+		}
+
+		/* The field recorded with the latest accel/gyro sample */
+		void readMag(Eigen::Vector3f& mag)
+		{
+			Axes::apply(records[current].mag, mag);
+		}
+
+		bool finished() const { return !loop && (next >= count); }
+
+	private:
+		const ReplayRecord* records;
+		size_t count;
+		bool loop;
+		size_t next;
+		size_t current;
+	};
+
+
+	/*----------------------------------
+	* Synthetic Source
+	*----------------------------------*/
+	/* Motion generated by SyntheticSource. Roll and pitch swing sinusoidally, yaw turns at a steady rate. */
+	struct SyntheticMotion
+	{
+		SyntheticMotion() : rollAmplitude_deg(30.0f), rollFrequency_Hz(0.2f), pitchAmplitude_deg(20.0f),
+			pitchFrequency_Hz(0.13f), yawRate_dps(10.0f), gravity_ms2(9.80665f), fieldHorizontal_G(0.2f),
+			fieldVertical_G(-0.45f), accelNoise_ms2(0.0f), gyroNoise_dps(0.0f), magNoise_G(0.0f), seed(1u)
+		{
+			hardIron_G.setZero();
+			softIron.setIdentity();
+			gyroBias_dps.setZero();
+		}
+
+		float rollAmplitude_deg;
+		float rollFrequency_Hz;
+		float pitchAmplitude_deg;
+		float pitchFrequency_Hz;
+		float yawRate_dps;
+
+		float gravity_ms2;
+		float fieldHorizontal_G;	/* Earth field along the zero yaw direction */
+		float fieldVertical_G;		/* Earth field along the up axis (negative in the northern hemisphere) */
+
+		Eigen::Vector3f hardIron_G;	/* Magnetometer distortion: reading = softIron * field + hardIron_G */
+		Eigen::Matrix3f softIron;
+
+		Eigen::Vector3f gyroBias_dps;	/* Constant offset added to every gyro reading */
+
+		float accelNoise_ms2;		/* Uniform noise amplitude added to each axis */
+		float gyroNoise_dps;
+		float magNoise_G;
+		uint32_t seed;
+	};
+
+	/**
+	* @brief Generates accel, gyro and mag readings for a known, smoothly varying attitude
+	*
+	* Needs no hardware or data, and truthEulerDeg() gives the attitude the readings were made
+	* from, so the filter's accuracy can be checked as well as its speed. One readInertial()
+	* advances time by 1/AHRS_SAMPLE_RATE_HZ.
+	*
+	* @tparam Axes   Mapping from the generated frame to the filter frame
+	*/
+	template<typename Axes = IdentityAxes>
+	class SyntheticSource
+	{
+	public:
+		SyntheticSource(const SyntheticMotion& motion = SyntheticMotion())
+			: motion(motion), time_S(0.0), noiseState(motion.seed ? motion.seed : 1u)
+		{
+			generate();
+		}
+
+		bool begin() { return true; }
+
+		uint32_t samplesReady() { return nominalBatchSize(); }
+
+		void readInertial(Eigen::Vector3f& accel, Eigen::Vector3f& gyro)
+		{
+			time_S += 1.0 / AHRS_SAMPLE_RATE_HZ;
+			generate();
+
+			Eigen::Vector3f a = accelBody, g = gyroBody_dps + motion.gyroBias_dps;
+			if (motion.accelNoise_ms2 > 0.0f)
+				for (int i = 0; i < 3; i++)
+					a(i) += motion.accelNoise_ms2 * noise();
+			if (motion.gyroNoise_dps > 0.0f)
+				for (int i = 0; i < 3; i++)
+					g(i) += motion.gyroNoise_dps * noise();
+
+			Axes::apply(a, accel);
+			Axes::apply(g, gyro);
+		}
+
+		void readMag(Eigen::Vector3f& mag)
+		{
+			Eigen::Vector3f m = motion.softIron * magBody + motion.hardIron_G;
+			if (motion.magNoise_G > 0.0f)
+				for (int i = 0; i < 3; i++)
+					m(i) += motion.magNoise_G * noise();
+
+			Axes::apply(m, mag);
+		}
+
+		/**
+		* @brief Attitude behind the latest sample as [PITCH, ROLL, YAW] (deg), in the same
+		* convention as MadgwickAHRS::getEulerDeg()
+		*/
+		void truthEulerDeg(Eigen::Vector3f& euler) const
+		{
+			euler << pitch * RAD_TO_DEG, roll * RAD_TO_DEG, yaw * RAD_TO_DEG;
+		}
+
+		double time() const { return time_S; }
+
+	private:
+		SyntheticMotion motion;
+		double time_S;
+		uint32_t noiseState;
+
+		float roll, pitch, yaw;
+		Eigen::Vector3f accelBody, gyroBody_dps, magBody;
+
+		/* Uniform in [-1, 1] (xorshift32) */
+		float noise()
+		{
+			noiseState ^= noiseState << 13;
+			noiseState ^= noiseState >> 17;
+			noiseState ^= noiseState << 5;
+			return (float)noiseState * (2.0f / 4294967295.0f) - 1.0f;
+		}
+
+		/* Body frame readings for the attitude at time_S. The attitude is the Z-Y-X (yaw, pitch,
+		* roll) rotation from the body to an up-pointing earth frame. */
+		void generate()
+		{
+			const double pi = 3.14159265358979;
+			const double w_roll = 2.0 * pi * motion.rollFrequency_Hz;
+			const double w_pitch = 2.0 * pi * motion.pitchFrequency_Hz;
+
+			roll = (float)(motion.rollAmplitude_deg * DEG_TO_RAD * sin(w_roll * time_S));
+			pitch = (float)(motion.pitchAmplitude_deg * DEG_TO_RAD * sin(w_pitch * time_S));
+			double yawWrapped = fmod(motion.yawRate_dps * DEG_TO_RAD * time_S + pi, 2.0 * pi);
+			yaw = (float)((yawWrapped < 0.0) ? yawWrapped + pi : yawWrapped - pi);
+
+			const float rollRate = (float)(motion.rollAmplitude_deg * DEG_TO_RAD * w_roll * cos(w_roll * time_S));
+			const float pitchRate = (float)(motion.pitchAmplitude_deg * DEG_TO_RAD * w_pitch * cos(w_pitch * time_S));
+			const float yawRate = motion.yawRate_dps * DEG_TO_RAD;
+
+			Eigen::Matrix3f bodyToEarth;
+			bodyToEarth = Eigen::AngleAxisf(yaw, Eigen::Vector3f::UnitZ()) *
+				Eigen::AngleAxisf(pitch, Eigen::Vector3f::UnitY()) *
+				Eigen::AngleAxisf(roll, Eigen::Vector3f::UnitX());
+
+			/* The accelerometer reads the reaction to gravity, pointing up */
+			accelBody = bodyToEarth.transpose() * Eigen::Vector3f(0.0f, 0.0f, motion.gravity_ms2);
+			magBody = bodyToEarth.transpose() * Eigen::Vector3f(motion.fieldHorizontal_G, 0.0f, motion.fieldVertical_G);
+
+			/* Euler rates to body rates */
+			const float sr = sinf(roll), cr = cosf(roll);
+			const float sp = sinf(pitch), cp = cosf(pitch);
+			gyroBody_dps <<
+				rollRate - yawRate * sp,
+				pitchRate * cr + yawRate * sr * cp,
+				-pitchRate * sr + yawRate * cr * cp;
+			gyroBody_dps *= RAD_TO_DEG;
+		}
+	};
+}
+
+#endif
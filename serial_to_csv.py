@@ -1,3 +1,5 @@
+# Windows only, and keeps the whole session in memory. On Linux use host/serial_record.cpp,
+# which streams the capture to disk as it arrives.
 import serial
 import msvcrt
 import time
@@ -43,6 +45,9 @@ if __name__ == '__main__':
     raw_str = ''.join(input_buffer)
     recorded_lines = raw_str.split("\r\n")
 
+    # Run time stats records ("#stats,...") are interleaved with the samples
+    recorded_lines = [line for line in recorded_lines if not line.startswith('#')]
+
     parsed_lines = [line.split(',') for line in recorded_lines]
     data_frame = pd.DataFrame(parsed_lines, columns=['pitch (deg)', 'roll (deg)', 'yaw (deg)', 'ax (m/s^2)',
                                                      'ay (m/s^2)', 'az (m/s^2)', 'gx (deg/s)', 'gy (deg/s)',
@@ -0,0 +1,100 @@
+/*
+	FreeRTOS configuration for the POSIX simulator build (see sim/simPeripherals.cpp).
+
+	Mirrors the target FreeRTOSConfig.h in everything the firmware depends on: priorities,
+	task notifications, software timers, run time stats and the trace facility. The
+	Cortex-M interrupt priority settings have no meaning under the POSIX port and are left out.
+*/
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------
+ * Faster than real time
+ *
+ * The firmware works in RTOS ticks of one millisecond. Here one tick is always one
+ * simulated millisecond, but the port's tick timer fires SIM_TIME_SCALE times as often,
+ * so the whole system runs that much faster than the wall clock. Setting pdMS_TO_TICKS
+ * and TICKS_TO_MS keeps every period and timestamp in simulated time. Scales up to about
+ * 20 are practical; beyond that the host's signal delivery becomes the limit.
+ *----------------------------------------------------------*/
+#ifndef SIM_TIME_SCALE
+#define SIM_TIME_SCALE					1
+#endif
+
+#define pdMS_TO_TICKS( xTimeInMs )		( ( TickType_t ) ( xTimeInMs ) )
+#define TICKS_TO_MS( ticks )			( ( uint32_t ) ( ticks ) )
+
+#define configUSE_PREEMPTION			1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION	0
+#define configUSE_IDLE_HOOK				0
+#define configUSE_TICK_HOOK				0
+#define configTICK_RATE_HZ				( ( TickType_t ) ( 1000 * SIM_TIME_SCALE ) )
+#define configMAX_PRIORITIES			(  8 )
+#define configMINIMAL_STACK_SIZE		( ( unsigned short ) 2048 )	/* Words. Host threads need far more than the target. */
+#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 16 * 1024 * 1024 ) )
+#define configMAX_TASK_NAME_LEN			( 16 )
+#define configUSE_TRACE_FACILITY		1
+#define configUSE_16_BIT_TICKS			0
+#define configIDLE_SHOULD_YIELD			1
+#define configUSE_MUTEXES				1
+#define configQUEUE_REGISTRY_SIZE		8
+#define configCHECK_FOR_STACK_OVERFLOW	0
+#define configUSE_RECURSIVE_MUTEXES		1
+#define configUSE_MALLOC_FAILED_HOOK	0
+#define configUSE_APPLICATION_TASK_TAG	0
+#define configUSE_COUNTING_SEMAPHORES	1
+#define configUSE_TASK_NOTIFICATIONS	1
+#define configSUPPORT_DYNAMIC_ALLOCATION	1
+#define configSUPPORT_STATIC_ALLOCATION	1
+#define configGENERATE_RUN_TIME_STATS	1
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES 			0
+#define configMAX_CO_ROUTINE_PRIORITIES	( 2 )
+
+/* Software timer definitions. */
+#define configUSE_TIMERS				1
+#define configTIMER_TASK_PRIORITY		( 2 )
+#define configTIMER_QUEUE_LENGTH		10
+#define configTIMER_TASK_STACK_DEPTH	( configMINIMAL_STACK_SIZE * 2 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet			1
+#define INCLUDE_uxTaskPriorityGet			1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
+#define INCLUDE_vTaskDelete					1
+#define INCLUDE_vTaskCleanUpResources		1
+#define INCLUDE_vTaskSuspend				1
+#define INCLUDE_vTaskDelayUntil				1
+#define INCLUDE_vTaskDelay					1
+#define INCLUDE_xTaskGetSchedulerState		1
+#define INCLUDE_xTaskGetIdleTaskHandle		1
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle	1
+
+/* Run time stats come from the TSC through the same functions as on the target,
+see runtimeStats.cpp */
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+	extern void vConfigureRunTimeStatsTimer( void );
+	extern uint32_t ulGetRunTimeCounterValue( void );
+	#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vConfigureRunTimeStatsTimer()
+	#define portGET_RUN_TIME_COUNTER_VALUE()			ulGetRunTimeCounterValue()
+#endif
+
+/* A failed assert prints where and exits instead of spinning forever */
+extern void vAssertCalled( const char * file, unsigned long line );
+#define configASSERT( x ) if( ( x ) == 0 ) { vAssertCalled( __FILE__, __LINE__ ); }
+
+/* Heap allocations after boot trap in static allocation mode, see staticMemory.cpp */
+#include <stddef.h>
+#ifdef __cplusplus
+extern "C" void vHeapGuardCheck( size_t xSize );
+#else
+extern void vHeapGuardCheck( size_t xSize );
+#endif
+#define traceMALLOC( pvAddress, uiSize )	vHeapGuardCheck( uiSize )
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef SOAR_SIM_LSM9DS1_HPP
+#define SOAR_SIM_LSM9DS1_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stddef.h>
+
+/* Thor Includes */
+#include "Thor/include/spi.h"
+#include "Thor/include/gpio.h"
+
+/*----------------------------------
+* POSIX simulator stand-in for the LSM9DS1 driver
+*
+* Same interface as the driver the firmware uses, but the samples come from a recorded
+* CSV log (SOAR_SIM_LOG, ahrs_recorded_output.csv by default) loaded by ThorInit(). Every
+* readGyro() moves on to the next row, so one gyro + accel read is one sample, in FIFO
+* mode too. Logs without magnetometer columns read back zero, which the orientation
+* filter treats as IMU-only. At the end of the log the replay starts over, or the
+* simulator exits if SOAR_SIM_LOOP=0.
+*----------------------------------*/
+
+/* Magnetometer bandwidth the firmware rate limits mag reads to (Hz) */
+#define LSM9DS1_M_MAX_BW	75
+
+enum fifoMode_type
+{
+	FIFO_OFF = 0,
+	FIFO_THS = 1,
+	FIFO_CONT_TRIGGER = 3,
+	FIFO_OFF_TRIGGER = 4,
+	FIFO_CONT = 5
+};
+
+enum interrupt_select
+{
+	XG_INT1 = 0x0C,
+	XG_INT2 = 0x0D
+};
+
+enum interrupt_generators
+{
+	INT_DRDY_XL = (1 << 0),
+	INT_DRDY_G = (1 << 1),
+	INT_FTH = (1 << 3),
+	INT_OVR = (1 << 4)
+};
+
+enum h_lactive
+{
+	INT_ACTIVE_HIGH,
+	INT_ACTIVE_LOW
+};
+
+enum pp_od
+{
+	INT_PUSH_PULL,
+	INT_OPEN_DRAIN
+};
+
+class LSM9DS1
+{
+public:
+	LSM9DS1(SPIClass_sPtr spi, GPIOClass_sPtr xgSelect, GPIOClass_sPtr mSelect);
+
+	/* Returns the combined WHO_AM_I value, 0 if there is no log to replay */
+	uint16_t begin();
+
+	/* Bias calibration happened when the log was recorded, so the measured biases are zero */
+	void calibrate(bool autoCalc = true) {}
+	void calibrateMag(bool loadIn = true) {}
+	void magOffset(uint8_t axis, int16_t offset) {}
+
+	/* Die temperature, reads back as 25C */
+	void readTemp() {}
+
+	void readGyro();
+	void readAccel();
+	void readMag();
+
+	void calcGyro();
+	void calcAccel();
+	void calcMag();
+
+	void setGyroODR(uint8_t gRate) {}
+	void configInt(interrupt_select interrupt, uint8_t generator, h_lactive activeLow = INT_ACTIVE_LOW,
+		pp_od pushPull = INT_PUSH_PULL) {}
+
+	void enableFIFO(bool enable = true) { fifoEnabled = enable; }
+	void setFIFO(fifoMode_type fifoMode, uint8_t fifoThs);
+
+	/* Entries written at IMU_ODR_HZ of simulated time since setFIFO(), less those read. Like
+	* continuous mode on the part, the oldest are dropped past 32. */
+	uint8_t getFIFOSamples();
+
+	float aRaw[3];		/* m/s^2 */
+	float gRaw[3];		/* dps */
+	float mRaw[3];		/* gauss, in the sensor frame (the firmware flips it to match the accel) */
+
+	float gBias[3];		/* Found by calibrate(), in the same units as gRaw/aRaw */
+	float aBias[3];
+	int16_t mBiasRaw[3];	/* Found by calibrateMag(), the value of the OFFSET_X/Y/Z_REG_M registers */
+	int16_t temperature;	/* 16 LSB per degree, zero at 25C */
+
+private:
+	bool fifoEnabled;
+	uint8_t fifoThreshold;
+	uint32_t fifoStartTick;
+	uint64_t fifoStartSample;
+
+	/* Row of the log the latest reads came from */
+	size_t row;
+};
+
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+#ifndef SOAR_SIM_SYSPROGS_PROFILER_H
+#define SOAR_SIM_SYSPROGS_PROFILER_H
+
+/* The VisualGDB profilers only exist on the target. Debug simulator builds get no-ops. */
+inline void InitializeSamplingProfiler() {}
+inline void InitializeInstrumentingProfiler() {}
+
+#endif
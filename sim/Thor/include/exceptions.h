@@ -0,0 +1,8 @@
+#pragma once
+#ifndef SOAR_SIM_THOR_EXCEPTIONS_H
+#define SOAR_SIM_THOR_EXCEPTIONS_H
+
+/* Prints the message and exits the simulator with a failure status */
+extern void BasicErrorHandler(const char* message);
+
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+#ifndef SOAR_SIM_THOR_EXTI_H
+#define SOAR_SIM_THOR_EXTI_H
+
+/* No external interrupt lines in the simulator. Data ready comes from the IMU_DRDY_SIMULATED timer. */
+
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef SOAR_SIM_THOR_GPIO_H
+#define SOAR_SIM_THOR_GPIO_H
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/* Boost Includes */
+#include <boost/shared_ptr.hpp>
+
+/* HAL Includes */
+#include "stm32f4xx_hal.h"
+
+namespace ThorDef
+{
+	namespace GPIO
+	{
+		enum PinNum
+		{
+			PIN_0, PIN_1, PIN_2, PIN_3, PIN_4, PIN_5, PIN_6, PIN_7,
+			PIN_8, PIN_9, PIN_10, PIN_11, PIN_12, PIN_13, PIN_14, PIN_15
+		};
+
+		enum PinMode
+		{
+			INPUT,
+			OUTPUT_PP,
+			OUTPUT_OD,
+			ALT_PP,
+			ALT_OD,
+			ANALOG
+		};
+
+		enum PinSpeed
+		{
+			LOW_SPD,
+			MEDIUM_SPD,
+			HIGH_SPD,
+			ULTRA_SPD
+		};
+
+		enum LogicLevel
+		{
+			LOW,
+			HIGH
+		};
+
+		const uint32_t NOALTERNATE = 0x00u;
+	}
+}
+
+/* ahrs.cpp names the pin settings without qualification */
+using namespace ThorDef::GPIO;
+
+/**
+* @brief A pin with no hardware behind it. Output changes are printed to stderr when the
+* SOAR_SIM_GPIO_LOG environment variable is set, so the status LED can be watched.
+*/
+class GPIOClass
+{
+public:
+	GPIOClass(GPIO_TypeDef* port, PinNum pin, PinSpeed speed, uint32_t alternate);
+
+	void mode(PinMode mode);
+	void write(LogicLevel level);
+	void toggle();
+	bool read();
+
+private:
+	GPIO_TypeDef* port;
+	PinNum pin;
+	LogicLevel level;
+};
+typedef boost::shared_ptr<GPIOClass> GPIOClass_sPtr;
+
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef SOAR_SIM_THOR_INTERRUPT_H
+#define SOAR_SIM_THOR_INTERRUPT_H
+
+namespace ThorDef
+{
+	namespace Interrupt
+	{
+		/* Driver events that can give a task's semaphore */
+		enum class Trigger
+		{
+			RX_COMPLETE,
+			TX_COMPLETE
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#ifndef SOAR_SIM_THOR_SPI_H
+#define SOAR_SIM_THOR_SPI_H
+
+/* Boost Includes */
+#include <boost/shared_ptr.hpp>
+
+/* Nothing talks over the bus in the simulator; the LSM9DS1 stand-in replays its data directly */
+class SPIClass
+{
+};
+typedef boost::shared_ptr<SPIClass> SPIClass_sPtr;
+
+extern SPIClass_sPtr spi2;
+
+#endif
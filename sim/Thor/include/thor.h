@@ -0,0 +1,22 @@
+#pragma once
+#ifndef SOAR_SIM_THOR_H
+#define SOAR_SIM_THOR_H
+
+/*----------------------------------
+* POSIX simulator stand-in for Thor_STM32
+*
+* Declares the subset of the Thor API the firmware uses, with the same names and include
+* paths, so main.cpp, ahrs.cpp, coms.cpp and led.cpp build unchanged. The implementations
+* are in sim/simPeripherals.cpp.
+*----------------------------------*/
+
+/* HAL Includes */
+#include "stm32f4xx_hal.h"
+
+/**
+* @brief Loads the replay log and opens the console output. Called from main() before the
+* scheduler starts, so no file I/O happens inside a task at startup.
+*/
+extern void ThorInit();
+
+#endif
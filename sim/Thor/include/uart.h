@@ -0,0 +1,77 @@
+#pragma once
+#ifndef SOAR_SIM_THOR_UART_H
+#define SOAR_SIM_THOR_UART_H
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Boost Includes */
+#include <boost/shared_ptr.hpp>
+
+/* HAL Includes */
+#include "stm32f4xx_hal.h"
+
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/* Thor Includes */
+#include "interrupt.h"
+
+namespace ThorDef
+{
+	namespace UART
+	{
+		enum class SubPeripheral
+		{
+			RX,
+			TX
+		};
+
+		enum class Modes
+		{
+			BLOCKING,
+			INTERRUPT,
+			DMA
+		};
+	}
+}
+
+/**
+* @brief Console UART backed by a file, stdout or a pseudo terminal
+*
+* Selected with the SOAR_SIM_CONSOLE environment variable: a path, "-" for stdout (the
+* default) or "pty", which opens a pseudo terminal and prints the slave's name so
+* serial_to_csv.py or telemetry_decode can attach to it like a USB serial port. Received
+* bytes (pty only) are returned as one packet per read, the way the interrupt mode driver
+* splits input. Writes to a pty nobody is reading are dropped and counted, as bytes on a
+* real line would be.
+*/
+class UARTClass
+{
+public:
+	UARTClass() : txMode(ThorDef::UART::Modes::BLOCKING), txComplete(nullptr), rxLength(0) {}
+
+	void begin(uint32_t baud);
+	void setMode(ThorDef::UART::SubPeripheral periph, ThorDef::UART::Modes mode);
+	void attachThreadTrigger(ThorDef::Interrupt::Trigger trigger, SemaphoreHandle_t* semphr);
+
+	HAL_StatusTypeDef write(uint8_t* data, size_t length);
+
+	uint32_t availablePackets();
+	size_t nextPacketSize();
+	HAL_StatusTypeDef readPacket(uint8_t* buffer, size_t size);
+
+private:
+	ThorDef::UART::Modes txMode;
+	SemaphoreHandle_t* txComplete;
+
+	uint8_t rxPacket[64];
+	size_t rxLength;
+};
+typedef boost::shared_ptr<UARTClass> UARTClass_sPtr;
+
+extern UARTClass_sPtr uart2;
+
+#endif
@@ -0,0 +1,398 @@
+/**
+POSIX simulator build of the firmware.
+
+main.cpp, threading.cpp, ahrs.cpp, coms.cpp, led.cpp and the rest of the firmware are
+compiled unchanged against the FreeRTOS POSIX port (FreeRTOS-Kernel V10.4 or later). The
+headers in sim/ stand in for Thor, the Cube HAL and the LSM9DS1 driver at the same include
+paths, and this file implements them:
+
+	spi2 / LSM9DS1    replays a recorded CSV log, one row per sample
+	uart2             writes the console to a file, stdout or a pseudo terminal
+	GPIO              the status LED, optionally printed as it changes
+
+Task creation, the init handshake, notifications, the data ready timer and the serial
+output all run the same code as on the board, so scheduling and data paths can be load
+tested on a workstation. sim/ must come before the repository root on the include path so
+its FreeRTOSConfig.h replaces the target one.
+
+sim/Makefile builds it as sim/build/soar_sim, fetching FreeRTOS-Kernel and the Kalman
+headers on first use unless FREERTOS_KERNEL / KALMAN point at existing checkouts:
+
+	make -C sim
+	make -C sim FREERTOS_KERNEL=<FreeRTOS-Kernel> KALMAN=<kalman>/include EIGEN=<eigen>
+
+Add -DSIM_TIME_SCALE=N to SIM_DEFINES to run N times faster than real time, and
+-DAHRS_TRACE_ENABLED=1 for the stage histograms. -DSTATIC_ALLOCATION=1 builds the no heap
+after boot configuration, which then asserts on the first allocation that slips through.
+
+Environment:
+	SOAR_SIM_LOG        IMU log to replay (default ahrs_recorded_output.csv)
+	SOAR_SIM_LOOP       0: exit with a summary at the end of the log, otherwise loop (default)
+	SOAR_SIM_CONSOLE    Console output: a path, "-" for stdout (default) or "pty"
+	SOAR_SIM_GPIO_LOG   Set to print GPIO output changes to stderr
+	SOAR_SIM_CAL        Calibration store file (default soar_calibration.bin), see calibrationStore.hpp
+*/
+
+/* C/C++ Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/* Boost Includes */
+#include <boost/make_shared.hpp>
+
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Thor Includes */
+#include "Thor/include/thor.h"
+#include "Thor/include/gpio.h"
+#include "Thor/include/spi.h"
+#include "Thor/include/uart.h"
+#include "Thor/include/exceptions.h"
+
+/* Project Includes */
+#include "LSM9DS1.hpp"
+#include "config.hpp"
+#include "host/replayLog.hpp"
+
+
+/*----------------------------------
+* Simulator State
+*----------------------------------*/
+GPIO_TypeDef simGPIOA = { 'A' };
+GPIO_TypeDef simGPIOB = { 'B' };
+GPIO_TypeDef simGPIOC = { 'C' };
+
+uint32_t SystemCoreClock = 168000000u;
+
+SPIClass_sPtr spi2 = boost::make_shared<SPIClass>();
+UARTClass_sPtr uart2 = boost::make_shared<UARTClass>();
+
+namespace SOAR_SIM
+{
+	static std::vector<SOAR_HOST::LogSample> replayLog;
+	static bool replayLoop = true;
+	static uint64_t samplesReplayed = 0;
+
+	static int consoleFd = -1;
+	static int ptySlaveFd = -1;
+	static bool consoleIsPty = false;
+	static uint64_t bytesWritten = 0;
+	static uint64_t bytesDropped = 0;
+
+	static bool gpioLog = false;
+
+	typedef std::chrono::steady_clock Clock;
+	static Clock::time_point startTime;
+
+	static void printSummary()
+	{
+		double wall_S = std::chrono::duration<double>(Clock::now() - startTime).count();
+		double simulated_S = TICKS_TO_MS(xTaskGetTickCount()) / 1000.0;
+
+		fprintf(stderr, "[sim] %llu samples replayed, %.2fs simulated in %.2fs (x%.1f), console %llu bytes written, %llu dropped\n",
+			(unsigned long long)samplesReplayed, simulated_S, wall_S, (wall_S > 0.0) ? simulated_S / wall_S : 0.0,
+			(unsigned long long)bytesWritten, (unsigned long long)bytesDropped);
+	}
+
+	/* Leaves without running static destructors, as the other task threads are still live */
+	static void simExit(int status)
+	{
+		printSummary();
+		_exit(status);
+	}
+
+	static bool openConsole(const char* target)
+	{
+		if (!strcmp(target, "-"))
+		{
+			consoleFd = STDOUT_FILENO;
+			return true;
+		}
+
+		if (strcmp(target, "pty"))
+		{
+			consoleFd = open(target, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			return (consoleFd >= 0);
+		}
+
+		consoleFd = posix_openpt(O_RDWR | O_NOCTTY);
+		if ((consoleFd < 0) || grantpt(consoleFd) || unlockpt(consoleFd))
+			return false;
+
+		/* Hold the slave open so writes with no reader attached fill the buffer instead of
+		* failing, and make it raw so binary frames pass through untouched */
+		ptySlaveFd = open(ptsname(consoleFd), O_RDWR | O_NOCTTY);
+		if (ptySlaveFd < 0)
+			return false;
+
+		struct termios tty;
+		tcgetattr(ptySlaveFd, &tty);
+		cfmakeraw(&tty);
+		tcsetattr(ptySlaveFd, TCSANOW, &tty);
+
+		fcntl(consoleFd, F_SETFL, fcntl(consoleFd, F_GETFL) | O_NONBLOCK);
+		consoleIsPty = true;
+
+		fprintf(stderr, "[sim] console on %s\n", ptsname(consoleFd));
+		return true;
+	}
+}
+
+using namespace SOAR_SIM;
+
+
+/*----------------------------------
+* HAL / Thor
+*----------------------------------*/
+extern "C" HAL_StatusTypeDef HAL_Init(void)
+{
+	return HAL_OK;
+}
+
+void ThorInit()
+{
+	startTime = Clock::now();
+
+	const char* log = getenv("SOAR_SIM_LOG");
+	const char* loop = getenv("SOAR_SIM_LOOP");
+	const char* console = getenv("SOAR_SIM_CONSOLE");
+
+	std::string error;
+	if (!SOAR_HOST::loadCSVLog(log ? log : "ahrs_recorded_output.csv", replayLog, error))
+		fprintf(stderr, "[sim] %s\n", error.c_str());
+	else
+		fprintf(stderr, "[sim] replaying %zu samples\n", replayLog.size());
+
+	replayLoop = !(loop && !strcmp(loop, "0"));
+	gpioLog = (getenv("SOAR_SIM_GPIO_LOG") != nullptr);
+
+	const char* target = console ? console : "-";
+	if (!openConsole(target))
+	{
+		fprintf(stderr, "[sim] could not open console %s: %s\n", target, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+void BasicErrorHandler(const char* message)
+{
+	fprintf(stderr, "[sim] error: %s\n", message);
+	simExit(EXIT_FAILURE);
+}
+
+extern "C" void vAssertCalled(const char* file, unsigned long line)
+{
+	fprintf(stderr, "[sim] configASSERT failed at %s:%lu\n", file, line);
+	simExit(EXIT_FAILURE);
+}
+
+
+/*----------------------------------
+* GPIO
+*----------------------------------*/
+GPIOClass::GPIOClass(GPIO_TypeDef* port, PinNum pin, PinSpeed speed, uint32_t alternate)
+	: port(port), pin(pin), level(LOW)
+{
+}
+
+void GPIOClass::mode(PinMode mode)
+{
+}
+
+void GPIOClass::write(LogicLevel newLevel)
+{
+	if (gpioLog && (newLevel != level))
+		fprintf(stderr, "[gpio] %8lu mS  P%c%d %s\n", (unsigned long)TICKS_TO_MS(xTaskGetTickCount()),
+			port->name, (int)pin, (newLevel == HIGH) ? "HIGH" : "LOW");
+
+	level = newLevel;
+}
+
+void GPIOClass::toggle()
+{
+	write((level == HIGH) ? LOW : HIGH);
+}
+
+bool GPIOClass::read()
+{
+	return (level == HIGH);
+}
+
+
+/*----------------------------------
+* UART
+*----------------------------------*/
+void UARTClass::begin(uint32_t baud)
+{
+}
+
+void UARTClass::setMode(ThorDef::UART::SubPeripheral periph, ThorDef::UART::Modes mode)
+{
+	if (periph == ThorDef::UART::SubPeripheral::TX)
+		txMode = mode;
+}
+
+void UARTClass::attachThreadTrigger(ThorDef::Interrupt::Trigger trigger, SemaphoreHandle_t* semphr)
+{
+	if (trigger == ThorDef::Interrupt::Trigger::TX_COMPLETE)
+		txComplete = semphr;
+}
+
+HAL_StatusTypeDef UARTClass::write(uint8_t* data, size_t length)
+{
+	/* The POSIX port delivers its tick as a signal. Keeping it masked for the system call
+	* stops the write being cut short part way through a frame. */
+	taskENTER_CRITICAL();
+	size_t sent = 0;
+	while (sent < length)
+	{
+		ssize_t n = ::write(consoleFd, data + sent, length - sent);
+		if (n > 0)
+			sent += n;
+		else if ((n < 0) && (errno == EINTR))
+			continue;
+		else
+			break;
+	}
+	taskEXIT_CRITICAL();
+
+	bytesWritten += sent;
+	bytesDropped += length - sent;
+
+	/* The "transfer" is already over, so the completion semaphore is given straight away */
+	if ((txMode == ThorDef::UART::Modes::DMA) && txComplete)
+		xSemaphoreGive(*txComplete);
+
+	return HAL_OK;
+}
+
+uint32_t UARTClass::availablePackets()
+{
+	if ((rxLength == 0) && consoleIsPty)
+	{
+		taskENTER_CRITICAL();
+		ssize_t n = ::read(consoleFd, rxPacket, sizeof(rxPacket));
+		taskEXIT_CRITICAL();
+
+		rxLength = (n > 0) ? (size_t)n : 0;
+	}
+
+	return (rxLength > 0) ? 1u : 0u;
+}
+
+size_t UARTClass::nextPacketSize()
+{
+	return rxLength;
+}
+
+HAL_StatusTypeDef UARTClass::readPacket(uint8_t* buffer, size_t size)
+{
+	if (rxLength == 0)
+		return HAL_ERROR;
+
+	memcpy(buffer, rxPacket, (size < rxLength) ? size : rxLength);
+	rxLength = 0;
+	return HAL_OK;
+}
+
+
+/*----------------------------------
+* LSM9DS1
+*----------------------------------*/
+LSM9DS1::LSM9DS1(SPIClass_sPtr spi, GPIOClass_sPtr xgSelect, GPIOClass_sPtr mSelect)
+	: temperature(0), fifoEnabled(false), fifoThreshold(0), fifoStartTick(0), fifoStartSample(0), row(0)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		aRaw[i] = 0.0f;
+		gRaw[i] = 0.0f;
+		mRaw[i] = 0.0f;
+		gBias[i] = 0.0f;
+		aBias[i] = 0.0f;
+		mBiasRaw[i] = 0;
+	}
+}
+
+uint16_t LSM9DS1::begin()
+{
+	/* WHO_AM_I_XG << 8 | WHO_AM_I_M, as the driver returns it */
+	return replayLog.empty() ? 0 : 0x683D;
+}
+
+void LSM9DS1::setFIFO(fifoMode_type fifoMode, uint8_t fifoThs)
+{
+	fifoThreshold = fifoThs;
+	fifoStartTick = xTaskGetTickCount();
+	fifoStartSample = samplesReplayed;
+}
+
+uint8_t LSM9DS1::getFIFOSamples()
+{
+	if (!fifoEnabled)
+		return 0;
+
+	const uint64_t written = ((uint64_t)(xTaskGetTickCount() - fifoStartTick) * IMU_ODR_HZ) / configTICK_RATE_HZ;
+	uint64_t read = samplesReplayed - fifoStartSample;
+
+	if (written > read + 32)
+	{
+		samplesReplayed += written - (read + 32);
+		read = written - 32;
+	}
+
+	return (written > read) ? (uint8_t)(written - read) : 0;
+}
+
+void LSM9DS1::readGyro()
+{
+	if (!replayLoop && (samplesReplayed >= replayLog.size()))
+		simExit(EXIT_SUCCESS);
+
+	row = samplesReplayed % replayLog.size();
+	samplesReplayed++;
+}
+
+void LSM9DS1::readAccel()
+{
+	/* Same row as the gyro: both come out of one FIFO entry on the real part */
+}
+
+void LSM9DS1::readMag()
+{
+}
+
+void LSM9DS1::calcGyro()
+{
+	const Eigen::Vector3f& gyro = replayLog[row].gyro;
+	gRaw[0] = gyro(0);
+	gRaw[1] = gyro(1);
+	gRaw[2] = gyro(2);
+}
+
+void LSM9DS1::calcAccel()
+{
+	const Eigen::Vector3f& accel = replayLog[row].accel;
+	aRaw[0] = accel(0);
+	aRaw[1] = accel(1);
+	aRaw[2] = accel(2);
+}
+
+void LSM9DS1::calcMag()
+{
+	/* Logs hold the aligned field, ahrs.cpp negates the raw reading to get there */
+	const Eigen::Vector3f& mag = replayLog[row].mag;
+	mRaw[0] = -mag(0);
+	mRaw[1] = -mag(1);
+	mRaw[2] = -mag(2);
+}
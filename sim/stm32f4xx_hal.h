@@ -0,0 +1,52 @@
+#pragma once
+#ifndef SOAR_SIM_STM32F4XX_HAL_H
+#define SOAR_SIM_STM32F4XX_HAL_H
+
+/* C/C++ Includes */
+#include <stdint.h>
+
+/*----------------------------------
+* POSIX simulator stand-in for the STM32F4 Cube HAL
+*
+* Only what the firmware touches outside the Thor drivers. The EXTI data ready path needs
+* the real GPIO/NVIC calls, so the simulator always builds with IMU_DRDY_SIMULATED=1.
+*----------------------------------*/
+#if !defined(IMU_DRDY_SIMULATED) || !(IMU_DRDY_SIMULATED)
+#error "The POSIX simulator has no EXTI lines. Build with -DIMU_DRDY_SIMULATED=1."
+#endif
+
+/* Ports only identify a pin in the simulator, the registers behind them don't exist */
+typedef struct
+{
+	char name;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef simGPIOA;
+extern GPIO_TypeDef simGPIOB;
+extern GPIO_TypeDef simGPIOC;
+
+#define GPIOA	(&simGPIOA)
+#define GPIOB	(&simGPIOB)
+#define GPIOC	(&simGPIOC)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint32_t SystemCoreClock;
+
+typedef enum
+{
+	HAL_OK = 0x00U,
+	HAL_ERROR = 0x01U,
+	HAL_BUSY = 0x02U,
+	HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+extern HAL_StatusTypeDef HAL_Init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+#include "staticMemory.hpp"
+
+/* C/C++ Includes */
+#include <new>
+
+/* FreeRTOS Includes */
+#include "task.h"
+#include "timers.h"
+
+namespace SOAR_MEMORY
+{
+	static volatile bool heapLocked = false;
+	static uint32_t bootAllocations = 0;
+	static uint32_t bootBytes = 0;
+
+	#if (STATIC_ALLOCATION)
+	static void heapGuardCheck(size_t bytes)
+	{
+		/* Anything that gets here after boot is a dynamic allocation the static mode is meant
+		* to rule out. Look up the call stack for the culprit. */
+		configASSERT(!heapLocked);
+
+		bootAllocations++;
+		bootBytes += bytes;
+	}
+	#endif
+
+	void heapGuardLock()
+	{
+		#if (STATIC_ALLOCATION)
+		heapLocked = true;
+		#endif
+	}
+
+	uint32_t heapGuardBootAllocations() { return bootAllocations; }
+	uint32_t heapGuardBootBytes() { return bootBytes; }
+
+
+	/*----------------------------------
+	* Peripheral Pool
+	*----------------------------------*/
+	#if (STATIC_ALLOCATION)
+	alignas(8) static uint8_t peripheralPool[PERIPHERAL_POOL_BYTES];
+	static size_t peripheralPoolUsed = 0;
+	#endif
+
+	void* poolAllocate(size_t bytes, size_t alignment)
+	{
+		#if (STATIC_ALLOCATION)
+		void* block = nullptr;
+
+		taskENTER_CRITICAL();
+		size_t start = (peripheralPoolUsed + alignment - 1) & ~(alignment - 1);
+		if (start + bytes <= PERIPHERAL_POOL_BYTES)
+		{
+			block = &peripheralPool[start];
+			peripheralPoolUsed = start + bytes;
+		}
+		taskEXIT_CRITICAL();
+
+		/* Out of pool: raise PERIPHERAL_POOL_BYTES */
+		configASSERT(block != nullptr);
+		return block;
+		#else
+		return malloc(bytes);
+		#endif
+	}
+}
+
+
+/*----------------------------------
+* Allocation Hooks
+*----------------------------------*/
+/* FreeRTOS heap, through traceMALLOC in FreeRTOSConfig.h */
+extern "C" void vHeapGuardCheck(size_t xSize)
+{
+	#if (STATIC_ALLOCATION)
+	SOAR_MEMORY::heapGuardCheck(xSize);
+	#endif
+}
+
+#if (STATIC_ALLOCATION)
+/* C++ new. Everything else in the firmware that reaches the C library heap comes through here. */
+void* operator new(size_t size)
+{
+	SOAR_MEMORY::heapGuardCheck(size);
+	return malloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	SOAR_MEMORY::heapGuardCheck(size);
+	return malloc(size);
+}
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete[](void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+void operator delete[](void* block, size_t) noexcept { free(block); }
+
+#if (HEAP_GUARD_WRAP_MALLOC)
+/* Plain C malloc, for the drivers written in C. Needs -Wl,--wrap=malloc on the link line. */
+extern "C" void* __real_malloc(size_t size);
+
+extern "C" void* __wrap_malloc(size_t size)
+{
+	SOAR_MEMORY::heapGuardCheck(size);
+	return __real_malloc(size);
+}
+#endif
+#endif
+
+
+/*----------------------------------
+* Kernel Task Memory
+*----------------------------------*/
+/* With configSUPPORT_STATIC_ALLOCATION the kernel asks for the idle and timer task memory
+* instead of taking it from its heap */
+extern "C" void vApplicationGetIdleTaskMemory(StaticTask_t** ppxIdleTaskTCBBuffer,
+	StackType_t** ppxIdleTaskStackBuffer, uint32_t* pulIdleTaskStackSize)
+{
+	static StaticTask_t idleTCB;
+	static StackType_t idleStack[configMINIMAL_STACK_SIZE];
+
+	*ppxIdleTaskTCBBuffer = &idleTCB;
+	*ppxIdleTaskStackBuffer = idleStack;
+	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+extern "C" void vApplicationGetTimerTaskMemory(StaticTask_t** ppxTimerTaskTCBBuffer,
+	StackType_t** ppxTimerTaskStackBuffer, uint32_t* pulTimerTaskStackSize)
+{
+	static StaticTask_t timerTCB;
+	static StackType_t timerStack[configTIMER_TASK_STACK_DEPTH];
+
+	*ppxTimerTaskTCBBuffer = &timerTCB;
+	*ppxTimerTaskStackBuffer = timerStack;
+	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
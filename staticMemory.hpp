@@ -0,0 +1,89 @@
+#pragma once
+#ifndef SOAR_STATIC_MEMORY_HPP
+#define SOAR_STATIC_MEMORY_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stdlib.h>
+#include <utility>
+
+/* Boost Includes */
+#include <boost/smart_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+
+/* Project Includes */
+#include "config.hpp"
+
+namespace SOAR_MEMORY
+{
+	/*----------------------------------
+	* Heap Guard
+	*----------------------------------*/
+	/**
+	* @brief From here on, any heap allocation traps through configASSERT
+	*
+	* Called by the init task once every task has finished its setup. Covers the FreeRTOS
+	* heap (traceMALLOC), C++ new, and with HEAP_GUARD_WRAP_MALLOC the C library malloc.
+	* Does nothing unless STATIC_ALLOCATION is set.
+	*/
+	extern void heapGuardLock();
+
+	/* Allocations made before the lock, for sizing configTOTAL_HEAP_SIZE */
+	extern uint32_t heapGuardBootAllocations();
+	extern uint32_t heapGuardBootBytes();
+
+
+	/*----------------------------------
+	* Peripheral Pool
+	*----------------------------------*/
+	/**
+	* @brief Bump allocator over the static peripheral pool
+	*
+	* Gives boost::allocate_shared somewhere to put a driver object and its reference count
+	* without the heap. Objects built here live for the life of the program, so nothing is
+	* ever returned to the pool.
+	*/
+	extern void* poolAllocate(size_t bytes, size_t alignment);
+
+	template<typename T>
+	struct PoolAllocator
+	{
+		typedef T value_type;
+
+		PoolAllocator() {}
+		template<typename U> PoolAllocator(const PoolAllocator<U>&) {}
+
+		T* allocate(size_t count) { return static_cast<T*>(poolAllocate(count * sizeof(T), alignof(T))); }
+		void deallocate(T*, size_t) {}
+
+		template<typename U> struct rebind { typedef PoolAllocator<U> other; };
+	};
+
+	template<typename T, typename U>
+	bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+
+	template<typename T, typename U>
+	bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+	/**
+	* @brief Builds a peripheral driver object behind a shared pointer, the way the Thor
+	* drivers expect to receive them
+	*
+	* With STATIC_ALLOCATION the object and its control block are placed in the static
+	* peripheral pool, otherwise this is boost::make_shared.
+	*/
+	template<typename T, typename ... Args>
+	boost::shared_ptr<T> makePeripheral(Args&& ... args)
+	{
+		#if (STATIC_ALLOCATION)
+		return boost::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+		#else
+		return boost::make_shared<T>(std::forward<Args>(args)...);
+		#endif
+	}
+}
+
+#endif
@@ -0,0 +1,368 @@
+#include "telemetry.hpp"
+
+namespace SOAR_TELEMETRY
+{
+	/*----------------------------------
+	* Little-endian field packing
+	*----------------------------------*/
+	static inline void putU16(uint8_t* p, uint16_t v)
+	{
+		p[0] = (uint8_t)(v);
+		p[1] = (uint8_t)(v >> 8);
+	}
+
+	static inline void putU32(uint8_t* p, uint32_t v)
+	{
+		p[0] = (uint8_t)(v);
+		p[1] = (uint8_t)(v >> 8);
+		p[2] = (uint8_t)(v >> 16);
+		p[3] = (uint8_t)(v >> 24);
+	}
+
+	static inline uint16_t getU16(const uint8_t* p)
+	{
+		return (uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	static inline uint32_t getU32(const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	/* Rounds to the nearest LSB and saturates to the int16 range */
+	static inline void putScaled(uint8_t* p, float value, float scale)
+	{
+		float v = value * scale;
+		v += (v >= 0.0f) ? 0.5f : -0.5f;
+
+		if (v > 32767.0f)
+			v = 32767.0f;
+		else if (v < -32768.0f)
+			v = -32768.0f;
+
+		putU16(p, (uint16_t)(int16_t)v);
+	}
+
+	static inline float getScaled(const uint8_t* p, float scale)
+	{
+		return (float)(int16_t)getU16(p) / scale;
+	}
+
+
+	/*----------------------------------
+	* Framing
+	*----------------------------------*/
+	uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc)
+	{
+		for (size_t i = 0; i < length; i++)
+		{
+			crc ^= (uint16_t)data[i] << 8;
+			for (int bit = 0; bit < 8; bit++)
+				crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+		return crc;
+	}
+
+	size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* output)
+	{
+		size_t write = 1;
+		size_t codeIdx = 0;
+		uint8_t code = 1;
+
+		for (size_t read = 0; read < length; read++)
+		{
+			if (data[read] == 0)
+			{
+				output[codeIdx] = code;
+				code = 1;
+				codeIdx = write++;
+			}
+			else
+			{
+				output[write++] = data[read];
+				code++;
+
+				if (code == 0xFF)
+				{
+					output[codeIdx] = code;
+					code = 1;
+					codeIdx = write++;
+				}
+			}
+		}
+
+		output[codeIdx] = code;
+		return write;
+	}
+
+	size_t cobsDecode(const uint8_t* frame, size_t length, uint8_t* output)
+	{
+		size_t read = 0;
+		size_t write = 0;
+
+		while (read < length)
+		{
+			uint8_t code = frame[read];
+			if ((code == 0) || (read + code > length))
+				return 0;
+
+			read++;
+			for (uint8_t i = 1; i < code; i++)
+				output[write++] = frame[read++];
+
+			if ((code != 0xFF) && (read != length))
+				output[write++] = 0;
+		}
+
+		return write;
+	}
+
+
+	/*----------------------------------
+	* Packets
+	*----------------------------------*/
+	size_t encodeAHRSFrame(const AHRSData_t& data, uint16_t sequence, uint8_t* frame)
+	{
+		uint8_t packet[AHRS_PACKET_SIZE];
+
+		packet[0] = PACKET_AHRS;
+		putU16(&packet[1], sequence);
+		putU32(&packet[3], data.timestamp_mS);
+
+		for (int i = 0; i < 4; i++)
+			putScaled(&packet[7 + 2 * i], data.quaternion(i), QUATERNION_SCALE);
+
+		for (int i = 0; i < 3; i++)
+		{
+			putScaled(&packet[15 + 2 * i], data.accel(i), ACCEL_SCALE);
+			putScaled(&packet[21 + 2 * i], data.gyro(i), GYRO_SCALE);
+		}
+
+		putU16(&packet[27], crc16(packet, 27));
+
+		size_t length = cobsEncode(packet, AHRS_PACKET_SIZE, frame);
+		frame[length++] = FRAME_DELIMITER;
+		return length;
+	}
+
+	size_t encodeRuntimeFrame(const RuntimeStats_t& stats, uint8_t* frame)
+	{
+		uint8_t packet[RUNTIME_PACKET_SIZE(RUNTIME_STATS_MAX_TASKS)];
+		uint8_t count = (stats.taskCount > RUNTIME_STATS_MAX_TASKS) ? RUNTIME_STATS_MAX_TASKS : stats.taskCount;
+		size_t size = RUNTIME_PACKET_SIZE(count);
+
+		packet[0] = PACKET_RUNTIME;
+		putU32(&packet[1], stats.timestamp_mS);
+		putU16(&packet[5], (stats.window_mS > 0xFFFF) ? 0xFFFF : (uint16_t)stats.window_mS);
+		putU16(&packet[7], stats.idle_permille);
+		putU32(&packet[9], stats.freeHeap_bytes);
+		packet[13] = count;
+
+		for (uint8_t i = 0; i < count; i++)
+		{
+			uint8_t* task = &packet[14 + 5 * i];
+			task[0] = stats.tasks[i].id;
+			putU16(&task[1], stats.tasks[i].cpu_permille);
+			putU16(&task[3], stats.tasks[i].stackFree_words);
+		}
+
+		putU16(&packet[size - 2], crc16(packet, size - 2));
+
+		size_t length = cobsEncode(packet, size, frame);
+		frame[length++] = FRAME_DELIMITER;
+		return length;
+	}
+
+	size_t encodeTraceFrame(const SOAR_PROFILE::TraceSummary& summary, uint32_t dropped, uint8_t* frame)
+	{
+		uint8_t packet[TRACE_PACKET_SIZE];
+
+		packet[0] = PACKET_TRACE;
+		packet[1] = summary.stage;
+		putU32(&packet[2], summary.count);
+		putU32(&packet[6], summary.min_nS);
+		putU32(&packet[10], summary.avg_nS);
+		putU32(&packet[14], summary.max_nS);
+		putU32(&packet[18], summary.p99_nS);
+		putU32(&packet[22], dropped);
+		putU16(&packet[26], crc16(packet, 26));
+
+		size_t length = cobsEncode(packet, TRACE_PACKET_SIZE, frame);
+		frame[length++] = FRAME_DELIMITER;
+		return length;
+	}
+
+	size_t encodeBootFrame(const BootTiming_t& timing, uint8_t* frame)
+	{
+		uint8_t packet[BOOT_PACKET_SIZE];
+
+		packet[0] = PACKET_BOOT;
+		putU32(&packet[1], timing.scheduler_uS);
+		putU32(&packet[5], timing.imuReady_uS);
+		putU32(&packet[9], timing.tasksResumed_uS);
+		putU32(&packet[13], timing.firstOutput_uS);
+		packet[17] = timing.calibration;
+		putU16(&packet[18], crc16(packet, 18));
+
+		size_t length = cobsEncode(packet, BOOT_PACKET_SIZE, frame);
+		frame[length++] = FRAME_DELIMITER;
+		return length;
+	}
+
+	DecodeStatus decodeAHRSPacket(const uint8_t* packet, size_t length, AHRSPacket& out)
+	{
+		if (length != AHRS_PACKET_SIZE)
+			return DECODE_BAD_LENGTH;
+
+		if (packet[0] != PACKET_AHRS)
+			return DECODE_UNKNOWN_TYPE;
+
+		if (crc16(packet, length - 2) != getU16(&packet[length - 2]))
+			return DECODE_CRC_ERROR;
+
+		out.sequence = getU16(&packet[1]);
+		out.timestamp_mS = getU32(&packet[3]);
+
+		for (int i = 0; i < 4; i++)
+			out.quaternion[i] = getScaled(&packet[7 + 2 * i], QUATERNION_SCALE);
+
+		for (int i = 0; i < 3; i++)
+		{
+			out.accel[i] = getScaled(&packet[15 + 2 * i], ACCEL_SCALE);
+			out.gyro[i] = getScaled(&packet[21 + 2 * i], GYRO_SCALE);
+		}
+
+		return DECODE_OK;
+	}
+
+
+	DecodeStatus decodeRuntimePacket(const uint8_t* packet, size_t length, RuntimeStats_t& out)
+	{
+		if (length < RUNTIME_PACKET_SIZE(0))
+			return DECODE_BAD_LENGTH;
+
+		if (packet[0] != PACKET_RUNTIME)
+			return DECODE_UNKNOWN_TYPE;
+
+		uint8_t count = packet[13];
+		if ((count > RUNTIME_STATS_MAX_TASKS) || (length != RUNTIME_PACKET_SIZE(count)))
+			return DECODE_BAD_LENGTH;
+
+		if (crc16(packet, length - 2) != getU16(&packet[length - 2]))
+			return DECODE_CRC_ERROR;
+
+		out.timestamp_mS = getU32(&packet[1]);
+		out.window_mS = getU16(&packet[5]);
+		out.idle_permille = getU16(&packet[7]);
+		out.freeHeap_bytes = getU32(&packet[9]);
+		out.taskCount = count;
+
+		for (uint8_t i = 0; i < count; i++)
+		{
+			const uint8_t* task = &packet[14 + 5 * i];
+			out.tasks[i].id = task[0];
+			out.tasks[i].name[0] = 0;
+			out.tasks[i].cpu_permille = getU16(&task[1]);
+			out.tasks[i].stackFree_words = getU16(&task[3]);
+		}
+
+		return DECODE_OK;
+	}
+
+
+	DecodeStatus decodeTracePacket(const uint8_t* packet, size_t length,
+		SOAR_PROFILE::TraceSummary& out, uint32_t& dropped)
+	{
+		if (length != TRACE_PACKET_SIZE)
+			return DECODE_BAD_LENGTH;
+
+		if (packet[0] != PACKET_TRACE)
+			return DECODE_UNKNOWN_TYPE;
+
+		if (crc16(packet, length - 2) != getU16(&packet[length - 2]))
+			return DECODE_CRC_ERROR;
+
+		out.stage = packet[1];
+		out.count = getU32(&packet[2]);
+		out.min_nS = getU32(&packet[6]);
+		out.avg_nS = getU32(&packet[10]);
+		out.max_nS = getU32(&packet[14]);
+		out.p99_nS = getU32(&packet[18]);
+		dropped = getU32(&packet[22]);
+
+		return DECODE_OK;
+	}
+
+
+	DecodeStatus decodeBootPacket(const uint8_t* packet, size_t length, BootTiming_t& out)
+	{
+		if (length != BOOT_PACKET_SIZE)
+			return DECODE_BAD_LENGTH;
+
+		if (packet[0] != PACKET_BOOT)
+			return DECODE_UNKNOWN_TYPE;
+
+		if (crc16(packet, length - 2) != getU16(&packet[length - 2]))
+			return DECODE_CRC_ERROR;
+
+		out.scheduler_uS = getU32(&packet[1]);
+		out.imuReady_uS = getU32(&packet[5]);
+		out.tasksResumed_uS = getU32(&packet[9]);
+		out.firstOutput_uS = getU32(&packet[13]);
+		out.calibration = packet[17];
+
+		return DECODE_OK;
+	}
+
+
+	/*----------------------------------
+	* Stream Decoder
+	*----------------------------------*/
+	FrameDecoder::FrameDecoder()
+	{
+		framesDecoded = 0;
+		framingErrors = 0;
+		crcErrors = 0;
+
+		length = 0;
+		size = 0;
+		overflow = false;
+	}
+
+	bool FrameDecoder::push(uint8_t byte)
+	{
+		if (byte != FRAME_DELIMITER)
+		{
+			if (length < sizeof(buffer))
+				buffer[length++] = byte;
+			else
+				overflow = true;
+
+			return false;
+		}
+
+		/* End of frame. Back to back delimiters are harmless and simply ignored. */
+		bool ready = false;
+
+		if (overflow)
+			framingErrors++;
+		else if (length > 0)
+		{
+			size = cobsDecode(buffer, length, buffer);
+
+			if (size < 3)
+				framingErrors++;
+			else if (crc16(buffer, size - 2) != getU16(&buffer[size - 2]))
+				crcErrors++;
+			else
+			{
+				framesDecoded++;
+				ready = true;
+			}
+		}
+
+		length = 0;
+		overflow = false;
+		return ready;
+	}
+}
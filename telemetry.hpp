@@ -0,0 +1,227 @@
+#pragma once
+#ifndef SOAR_TELEMETRY_HPP
+#define SOAR_TELEMETRY_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Project Includes */
+#include "dataTypes.hpp"
+#include "trace.hpp"
+
+/**
+* Binary telemetry protocol
+*
+* Every packet is a fixed little-endian layout protected by a CRC-16/CCITT-FALSE, then
+* COBS encoded so that 0x00 never appears inside a frame and is used as the frame delimiter.
+* A receiver that joins mid-stream (or loses bytes) resynchronises on the next 0x00.
+*
+* AHRS packet (29 bytes before framing, 31 on the wire):
+*	Offset	Size	Field
+*	0		1		Packet type (PACKET_AHRS)
+*	1		2		Sequence number, increments per packet sent
+*	3		4		Sample timestamp (mS since boot)
+*	7		8		Attitude quaternion w, x, y, z (int16, 1/32767)
+*	15		6		Accel x, y, z (int16, 0.01 m/s^2)
+*	21		6		Gyro x, y, z (int16, 0.1 dps)
+*	27		2		CRC over bytes 0-26
+*
+* The attitude goes out as a quaternion, which has no singularity at +/-90 deg pitch and
+* resolves better than 0.01 deg. Receivers that want Euler angles convert it with
+* SOAR_AHRS::quaternionToEulerDeg(). Accel and gyro keep the resolution of the 2 decimal
+* place CSV output (gyro gives up one digit to cover the +/-2000 dps range). Values
+* outside the int16 range saturate.
+*
+* Run time stats packet (16 + 5 * task count bytes before framing):
+*	Offset	Size	Field
+*	0		1		Packet type (PACKET_RUNTIME)
+*	1		4		End of the measurement window (mS since boot)
+*	5		2		Window length (mS)
+*	7		2		Idle time (0.1%)
+*	9		4		Free heap (bytes)
+*	13		1		Task count N
+*	14		5*N		Per task: id (TaskIndex or RuntimeTaskID), CPU (0.1%), free stack (words)
+*	14+5*N	2		CRC over all preceding bytes
+*
+* Trace packet (28 bytes before framing), one per stage when a dump is requested:
+*	Offset	Size	Field
+*	0		1		Packet type (PACKET_TRACE)
+*	1		1		Stage (SOAR_PROFILE::TraceStage)
+*	2		4		Samples
+*	6		16		Min, average, max, 99th percentile duration (nS)
+*	22		4		Events dropped because the trace ring was full
+*	26		2		CRC over bytes 0-25
+*
+* Boot packet (20 bytes before framing), sent once after the first AHRS packet:
+*	Offset	Size	Field
+*	0		1		Packet type (PACKET_BOOT)
+*	1		16		Scheduler started, IMU ready, tasks resumed, first output (uS, see BootTiming_t)
+*	17		1		Calibration (CalibrationStatus)
+*	18		2		CRC over bytes 0-17
+*/
+namespace SOAR_TELEMETRY
+{
+	enum PacketType
+	{
+		PACKET_AHRS = 0x01,
+		PACKET_RUNTIME = 0x02,
+		PACKET_TRACE = 0x03,
+		PACKET_BOOT = 0x04
+	};
+
+	const float QUATERNION_SCALE = 32767.0f;	/* LSB per unit */
+	const float ACCEL_SCALE = 100.0f;	/* LSB per m/s^2 */
+	const float GYRO_SCALE = 10.0f;		/* LSB per dps */
+
+	const size_t AHRS_PACKET_SIZE = 29;
+	#define RUNTIME_PACKET_SIZE(tasks) ((size_t)(16 + 5 * (tasks)))
+	const size_t TRACE_PACKET_SIZE = 28;
+	const size_t BOOT_PACKET_SIZE = 20;
+	const uint8_t FRAME_DELIMITER = 0x00;
+
+	/* Worst case COBS overhead is one byte per 254, plus the trailing delimiter */
+	#define COBS_MAX_ENCODED_SIZE(n) ((n) + ((n) / 254) + 1)
+	#define MAX_FRAME_SIZE(n) (COBS_MAX_ENCODED_SIZE(n) + 1)
+
+	const size_t AHRS_FRAME_SIZE = MAX_FRAME_SIZE(AHRS_PACKET_SIZE);
+	const size_t RUNTIME_FRAME_SIZE = MAX_FRAME_SIZE(RUNTIME_PACKET_SIZE(RUNTIME_STATS_MAX_TASKS));
+	const size_t TRACE_FRAME_SIZE = MAX_FRAME_SIZE(TRACE_PACKET_SIZE);
+	const size_t BOOT_FRAME_SIZE = MAX_FRAME_SIZE(BOOT_PACKET_SIZE);
+
+	/* Largest packet of any type, bounds the receive buffers */
+	#define TELEMETRY_MAX(a, b) (((a) > (b)) ? (a) : (b))
+	const size_t MAX_PACKET_SIZE = TELEMETRY_MAX(AHRS_PACKET_SIZE,
+		TELEMETRY_MAX(RUNTIME_PACKET_SIZE(RUNTIME_STATS_MAX_TASKS), TELEMETRY_MAX(TRACE_PACKET_SIZE, BOOT_PACKET_SIZE)));
+
+	/**
+	* @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+	*/
+	extern uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+
+	/**
+	* @brief COBS encodes data into output, which must hold COBS_MAX_ENCODED_SIZE(length) bytes
+	* @returns Number of bytes written. No delimiter is appended.
+	*/
+	extern size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* output);
+
+	/**
+	* @brief Decodes one COBS frame (without its delimiter). Decoding in place is allowed.
+	* @returns Number of decoded bytes, or 0 if the frame is malformed
+	*/
+	extern size_t cobsDecode(const uint8_t* frame, size_t length, uint8_t* output);
+
+	/**
+	* @brief Builds a complete, delimited AHRS frame ready to be written to the UART
+	*
+	* @param [in]  data         Sample to send
+	* @param [in]  sequence     Packet sequence number
+	* @param [out] frame        Output buffer of at least AHRS_FRAME_SIZE bytes
+	* @returns Number of bytes in the frame
+	*/
+	extern size_t encodeAHRSFrame(const AHRSData_t& data, uint16_t sequence, uint8_t* frame);
+
+	/**
+	* @brief Builds a complete, delimited run time stats frame
+	*
+	* @param [in]  stats        Stats to send. Task names are not sent.
+	* @param [out] frame        Output buffer of at least RUNTIME_FRAME_SIZE bytes
+	* @returns Number of bytes in the frame
+	*/
+	extern size_t encodeRuntimeFrame(const RuntimeStats_t& stats, uint8_t* frame);
+
+	/**
+	* @brief Builds a complete, delimited trace frame for one stage
+	*
+	* @param [in]  summary      Stage summary
+	* @param [in]  dropped      Trace events lost so far
+	* @param [out] frame        Output buffer of at least TRACE_FRAME_SIZE bytes
+	* @returns Number of bytes in the frame
+	*/
+	extern size_t encodeTraceFrame(const SOAR_PROFILE::TraceSummary& summary, uint32_t dropped, uint8_t* frame);
+
+	/**
+	* @brief Builds a complete, delimited boot timing frame
+	*
+	* @param [in]  timing       Boot timeline to send
+	* @param [out] frame        Output buffer of at least BOOT_FRAME_SIZE bytes
+	* @returns Number of bytes in the frame
+	*/
+	extern size_t encodeBootFrame(const BootTiming_t& timing, uint8_t* frame);
+
+
+	/*----------------------------------
+	* Decoding (host side)
+	*----------------------------------*/
+	/* Decoded AHRS packet in engineering units */
+	struct AHRSPacket
+	{
+		uint16_t sequence;
+		uint32_t timestamp_mS;
+		float quaternion[4];	/* [W, X, Y, Z] */
+		float accel[3];		/* [X, Y, Z] (m/s^2) */
+		float gyro[3];		/* [X, Y, Z] (dps) */
+	};
+
+	enum DecodeStatus
+	{
+		DECODE_OK,
+		DECODE_FRAMING_ERROR,
+		DECODE_CRC_ERROR,
+		DECODE_UNKNOWN_TYPE,
+		DECODE_BAD_LENGTH
+	};
+
+	/**
+	* @brief Validates and unpacks a COBS-decoded AHRS packet
+	*/
+	extern DecodeStatus decodeAHRSPacket(const uint8_t* packet, size_t length, AHRSPacket& out);
+
+	/**
+	* @brief Validates and unpacks a COBS-decoded run time stats packet. Task names are left empty.
+	*/
+	extern DecodeStatus decodeRuntimePacket(const uint8_t* packet, size_t length, RuntimeStats_t& out);
+
+	/**
+	* @brief Validates and unpacks a COBS-decoded trace packet
+	*/
+	extern DecodeStatus decodeTracePacket(const uint8_t* packet, size_t length,
+		SOAR_PROFILE::TraceSummary& out, uint32_t& dropped);
+
+	/**
+	* @brief Validates and unpacks a COBS-decoded boot timing packet
+	*/
+	extern DecodeStatus decodeBootPacket(const uint8_t* packet, size_t length, BootTiming_t& out);
+
+	/**
+	* @brief Byte-at-a-time frame reassembly with bounded memory
+	*
+	* Feed every received byte to push(). When it returns true a complete packet (its CRC
+	* included and already verified) is available through packet()/packetSize(), ready for
+	* one of the decode functions.
+	* Errors are counted rather than reported.
+	*/
+	class FrameDecoder
+	{
+	public:
+		FrameDecoder();
+
+		bool push(uint8_t byte);
+
+		const uint8_t* packet() const { return buffer; }
+		size_t packetSize() const { return size; }
+		uint8_t packetType() const { return buffer[0]; }
+
+		uint32_t framesDecoded;
+		uint32_t framingErrors;		/* Malformed COBS, oversized or truncated frames */
+		uint32_t crcErrors;
+
+	private:
+		uint8_t buffer[COBS_MAX_ENCODED_SIZE(MAX_PACKET_SIZE)];
+		size_t length;
+		size_t size;
+		bool overflow;
+	};
+}
+
+#endif
@@ -1,9 +1,8 @@
 #include "threading.hpp"
 
-QueueHandle_t qAHRS = xQueueCreate(1, sizeof(AHRSData_t));
-SemaphoreHandle_t ahrsBufferMutex = xSemaphoreCreateMutex();
+SeqLock<AHRSData_t> ahrsChannel;
 
-boost::container::vector<void*> TaskHandle(TOTAL_TASK_SIZE);
+TaskHandle_t TaskHandle[TOTAL_TASK_SIZE];
 
 
 BaseType_t xTaskSendMessage(TaskIndex idx, uint32_t msg)
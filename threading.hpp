@@ -2,8 +2,9 @@
 #ifndef SOAR_THREADING_HPP
 #define SOAR_THREADING_HPP
 
-/* Boost Includes */
-#include <boost/container/vector.hpp>
+/* C/C++ Includes */
+#include <stdint.h>
+#include <atomic>
 
 /* FreeRTOS Includes */
 #include "FreeRTOS.h"
@@ -12,19 +13,122 @@
 #include "semphr.h"
 
 /* Project Includes */
+#include "config.hpp"
 #include "dataTypes.hpp"
 
 
 /*----------------------------------
-* Queues
+* Lock-free Channels
 *----------------------------------*/
-extern QueueHandle_t qAHRS;
+/* Per-reader bookkeeping for a SeqLock channel */
+struct SeqLockReader
+{
+	SeqLockReader() : lastSequence(0), updates(0), missed(0), retries(0), failed(0) {}
+
+	uint32_t lastSequence;	/* Sequence of the last value this reader copied out */
+	uint32_t updates;		/* New values received */
+	uint32_t missed;		/* Values published that this reader never saw */
+	uint32_t retries;		/* Copies thrown away because the writer got in mid-read */
+	uint32_t failed;		/* read() calls that gave up after too many retries */
+};
+
+/**
+* @brief Latest-value channel between one writer task and any number of reader tasks
+*
+* The writer never blocks or waits: publish() bumps a sequence counter to an odd value,
+* copies the data in and bumps it back to even. Readers copy the data out and check the
+* counter was even and unchanged on both sides of the copy; if not, the copy may be torn
+* and is retried. Only the most recent value is kept, and each reader learns from the
+* sequence numbers how many updates it skipped.
+*/
+template<typename T>
+class SeqLock
+{
+public:
+	static const int maxRetries = 4;
+
+	SeqLock() : sequence(0) {}
+
+	/**
+	* @brief Wait-free publish. Must only be called from a single task.
+	*/
+	void publish(const T& value)
+	{
+		uint32_t seq = sequence.load(std::memory_order_relaxed);
+
+		sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		data = value;
+
+		sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	/**
+	* @brief Copies out the latest value if it is newer than the last one this reader saw
+	*
+	* @param [out]    value     Receives the new value; left untouched otherwise
+	* @param [in,out] reader    This reader's bookkeeping
+	* @returns true if value was updated
+	*/
+	bool read(T& value, SeqLockReader& reader)
+	{
+		for (int attempt = 0; attempt <= maxRetries; attempt++)
+		{
+			uint32_t before = sequence.load(std::memory_order_acquire);
+
+			if (before == reader.lastSequence)
+				return false;
+
+			if (before & 1u)
+			{
+				reader.retries++;
+				continue;
+			}
+
+			T copy = data;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) != before)
+			{
+				reader.retries++;
+				continue;
+			}
+
+			value = copy;
+			reader.missed += ((before - reader.lastSequence) / 2u) - 1u;
+			reader.lastSequence = before;
+			reader.updates++;
+			return true;
+		}
+
+		reader.failed++;
+		return false;
+	}
+
+	/* Number of values published so far */
+	uint32_t published() const { return sequence.load(std::memory_order_relaxed) / 2u; }
+
+private:
+	std::atomic<uint32_t> sequence;
+	T data;
+};
 
 
 /*----------------------------------
-* Semaphores and Mutexes
+* Time Conversion
 *----------------------------------*/
-extern SemaphoreHandle_t ahrsBufferMutex;
+/* RTOS ticks to milliseconds. The POSIX simulator keeps one tick per simulated mS while
+* running the tick faster than real time, so it supplies its own definition. */
+#ifndef TICKS_TO_MS
+#define TICKS_TO_MS(ticks)	((uint32_t)((ticks) * portTICK_PERIOD_MS))
+#endif
+
+
+/*----------------------------------
+* Inter-task Data
+*----------------------------------*/
+extern SeqLock<AHRSData_t> ahrsChannel;
 
 
 
@@ -34,9 +138,35 @@ enum TaskIndex
 	LED_STATUS_TASK,
 	AHRS_TASK,
 	SERIAL_TASK,
+	CALIBRATION_TASK,
 	TOTAL_TASK_SIZE
 };
-extern boost::container::vector<void*> TaskHandle;
+extern TaskHandle_t TaskHandle[TOTAL_TASK_SIZE];
+
+/**
+* @brief Creates a task and records its handle in TaskHandle
+*
+* With STATIC_ALLOCATION the control block and stack are static storage owned by this
+* instantiation, so each task index must only be created once. Otherwise they come from
+* the FreeRTOS heap as usual.
+*
+* @param[in] Task          Slot in TaskHandle
+* @param[in] StackWords    Stack depth in words
+* @returns pdPASS, or errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY
+*/
+template<TaskIndex Task, size_t StackWords>
+BaseType_t createTask(TaskFunction_t function, const char* name, UBaseType_t priority)
+{
+	#if (STATIC_ALLOCATION)
+	static StaticTask_t taskBuffer;
+	static StackType_t stack[StackWords];
+
+	TaskHandle[Task] = xTaskCreateStatic(function, name, StackWords, NULL, priority, stack, &taskBuffer);
+	return TaskHandle[Task] ? pdPASS : errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	#else
+	return xTaskCreate(function, name, StackWords, NULL, priority, &TaskHandle[Task]);
+	#endif
+}
 
 /* Allows sending a notification message to any task from anywhere */
 extern BaseType_t xTaskSendMessage(const TaskIndex, const uint32_t);
@@ -0,0 +1,150 @@
+#include "trace.hpp"
+
+/* C/C++ Includes */
+#include <string.h>
+
+namespace SOAR_PROFILE
+{
+	/*----------------------------------
+	* Histogram
+	*----------------------------------*/
+	static inline int floorLog2(uint32_t value)
+	{
+		return 31 - __builtin_clz(value);
+	}
+
+	/* Buckets 4n to 4n + 3 split [2^(n + 2), 2^(n + 3)) into quarters, except bucket 0 which
+	* also takes everything below 4 */
+	static inline int bucketIndex(uint32_t cycles)
+	{
+		if (cycles < 4)
+			return 0;
+
+		int octave = floorLog2(cycles);
+		if (octave >= TraceHistogram::maxOctave)
+			return TraceHistogram::bucketCount - 1;
+
+		int quarter = (cycles >> (octave - 2)) & 3;
+		return (octave - 2) * 4 + quarter;
+	}
+
+	static inline uint32_t bucketUpperBound(int index)
+	{
+		int octave = index / 4 + 2;
+		int quarter = index % 4;
+		uint32_t width = 1u << (octave - 2);
+
+		return ((4u + quarter) << (octave - 2)) + width - 1;
+	}
+
+	void TraceHistogram::reset()
+	{
+		count = 0;
+		min = 0xFFFFFFFFu;
+		max = 0;
+		total = 0;
+		memset(buckets, 0, sizeof(buckets));
+	}
+
+	void TraceHistogram::add(uint32_t cycles)
+	{
+		count++;
+		total += cycles;
+
+		if (cycles < min)
+			min = cycles;
+		if (cycles > max)
+			max = cycles;
+
+		buckets[bucketIndex(cycles)]++;
+	}
+
+	uint32_t TraceHistogram::percentile(float fraction) const
+	{
+		if (count == 0)
+			return 0;
+
+		uint32_t target = (uint32_t)(fraction * count + 0.5f);
+		if (target < 1)
+			target = 1;
+
+		uint32_t seen = 0;
+		for (int i = 0; i < bucketCount; i++)
+		{
+			seen += buckets[i];
+			if (seen >= target)
+			{
+				/* The last bucket has no upper bound of its own */
+				if (i == bucketCount - 1)
+					return max;
+
+				uint32_t bound = bucketUpperBound(i);
+				return (bound < max) ? bound : max;
+			}
+		}
+
+		return max;
+	}
+
+
+	/*----------------------------------
+	* Trace Storage
+	*----------------------------------*/
+	static TraceRing<AHRS_TRACE_RING_SIZE> traceRing;
+	static TraceHistogram histograms[TRACE_STAGE_COUNT];
+
+	void traceRecord(TraceStage stage, uint32_t startCycles)
+	{
+		TraceEvent event;
+		event.start = startCycles;
+		event.cycles = cycleCount() - startCycles;
+		event.stage = (uint8_t)stage;
+
+		traceRing.push(event);
+	}
+
+	uint32_t traceDrain()
+	{
+		TraceEvent event;
+		uint32_t drained = 0;
+
+		while (traceRing.pop(event))
+		{
+			if (event.stage < TRACE_STAGE_COUNT)
+				histograms[event.stage].add(event.cycles);
+
+			drained++;
+		}
+
+		return drained;
+	}
+
+	static uint32_t cyclesToNanoseconds(uint64_t cycles)
+	{
+		uint64_t nS = (cycles * 1000000000ull) / cycleCounterHz();
+		return (nS > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)nS;
+	}
+
+	void traceSummary(uint8_t stage, TraceSummary& summary)
+	{
+		const TraceHistogram& h = histograms[stage];
+
+		summary.stage = stage;
+		summary.count = h.count;
+		summary.min_nS = h.count ? cyclesToNanoseconds(h.min) : 0;
+		summary.avg_nS = h.count ? cyclesToNanoseconds(h.total / h.count) : 0;
+		summary.max_nS = cyclesToNanoseconds(h.max);
+		summary.p99_nS = cyclesToNanoseconds(h.percentile(0.99f));
+	}
+
+	uint32_t traceDropped()
+	{
+		return traceRing.dropped;
+	}
+
+	void traceReset()
+	{
+		for (int stage = 0; stage < TRACE_STAGE_COUNT; stage++)
+			histograms[stage].reset();
+	}
+}
@@ -0,0 +1,172 @@
+#pragma once
+#ifndef SOAR_TRACE_HPP
+#define SOAR_TRACE_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+
+/* Project Includes */
+#include "config.hpp"
+#include "cycleCounter.hpp"
+
+/*----------------------------------
+* Tracepoints
+*----------------------------------*/
+/* Bracket a stage with these. With AHRS_TRACE_ENABLED set to 0 they expand to nothing,
+* so the instrumented code is exactly what it was before. Both must be in the same scope. */
+#if (AHRS_TRACE_ENABLED)
+#define TRACE_BEGIN(stage)	const uint32_t _traceStart_##stage = SOAR_PROFILE::cycleCount()
+#define TRACE_END(stage)	SOAR_PROFILE::traceRecord(SOAR_PROFILE::stage, _traceStart_##stage)
+#else
+#define TRACE_BEGIN(stage)
+#define TRACE_END(stage)
+#endif
+
+namespace SOAR_PROFILE
+{
+	/* Instrumented stages of the AHRS loop */
+	enum TraceStage
+	{
+		TRACE_SAMPLE,				/* Whole loop iteration, wakeup to publish */
+		TRACE_SPI_READ,				/* readGyro() + readAccel() */
+		TRACE_MAG_READ,				/* readMag() + calcMag() */
+		TRACE_CONVERT,				/* calcAccel() + calcGyro() */
+		TRACE_SMOOTHER_PREDICT,		/* Or the error-state EKF's predict */
+		TRACE_SMOOTHER_UPDATE,		/* Or the error-state EKF's accel/mag update */
+		TRACE_ORIENTATION,			/* All orientation filter steps for one sample, unused by the EKF */
+		TRACE_OUTPUT,				/* Filling in the AHRSData_t */
+		TRACE_PUBLISH,				/* ahrsChannel.publish() */
+		TRACE_STAGE_COUNT
+	};
+
+	inline const char* traceStageName(uint8_t stage)
+	{
+		static const char* names[TRACE_STAGE_COUNT] =
+		{
+			"sample", "spiRead", "magRead", "convert", "predict", "update", "orientation", "output", "publish"
+		};
+
+		return (stage < TRACE_STAGE_COUNT) ? names[stage] : "unknown";
+	}
+
+	/* One traced interval, as stored in the ring buffer */
+	struct TraceEvent
+	{
+		uint32_t start;			/* Cycle counter when the stage began */
+		uint32_t cycles;		/* Duration */
+		uint8_t stage;
+	};
+
+	/**
+	* @brief Single producer, single consumer ring of trace events
+	*
+	* The producer never blocks: when the consumer falls behind, new events are dropped and
+	* counted rather than overwriting ones the consumer may be reading.
+	*/
+	template<size_t Size>
+	class TraceRing
+	{
+	public:
+		static_assert((Size & (Size - 1)) == 0, "TraceRing size must be a power of two");
+
+		TraceRing() : dropped(0), head(0), tail(0) {}
+
+		bool push(const TraceEvent& event)
+		{
+			uint32_t h = head.load(std::memory_order_relaxed);
+			if (h - tail.load(std::memory_order_acquire) >= Size)
+			{
+				dropped++;
+				return false;
+			}
+
+			events[h & (Size - 1)] = event;
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(TraceEvent& event)
+		{
+			uint32_t t = tail.load(std::memory_order_relaxed);
+			if (t == head.load(std::memory_order_acquire))
+				return false;
+
+			event = events[t & (Size - 1)];
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		uint32_t dropped;
+
+	private:
+		std::atomic<uint32_t> head;
+		std::atomic<uint32_t> tail;
+		TraceEvent events[Size];
+	};
+
+	/**
+	* @brief Log-linear histogram of stage durations
+	*
+	* Four buckets per power of two, so percentiles are exact to within 25%, from 4 cycles up
+	* to 2^maxOctave cycles. Anything longer lands in the last bucket.
+	*/
+	class TraceHistogram
+	{
+	public:
+		static const int maxOctave = 24;
+		static const int bucketCount = (maxOctave - 2) * 4;
+
+		TraceHistogram() { reset(); }
+
+		void reset();
+		void add(uint32_t cycles);
+
+		/* Upper bound of the bucket holding the given fraction (0-1) of samples, clamped to max */
+		uint32_t percentile(float fraction) const;
+
+		uint32_t count;
+		uint32_t min;
+		uint32_t max;
+		uint64_t total;
+
+	private:
+		uint32_t buckets[bucketCount];
+	};
+
+	/* Summary of one stage, in nanoseconds */
+	struct TraceSummary
+	{
+		uint8_t stage;
+		uint32_t count;
+		uint32_t min_nS;
+		uint32_t avg_nS;
+		uint32_t max_nS;
+		uint32_t p99_nS;
+	};
+
+	/**
+	* @brief Records one stage. Called through TRACE_END() from the AHRS task only.
+	*/
+	extern void traceRecord(TraceStage stage, uint32_t startCycles);
+
+	/**
+	* @brief Moves everything in the ring into the histograms. Call from one consumer task.
+	* @returns Number of events consumed
+	*/
+	extern uint32_t traceDrain();
+
+	/**
+	* @brief Summarises one stage's histogram
+	*/
+	extern void traceSummary(uint8_t stage, TraceSummary& summary);
+
+	/* Events lost because the ring was full */
+	extern uint32_t traceDropped();
+
+	/* Clears all histograms */
+	extern void traceReset();
+}
+
+#endif
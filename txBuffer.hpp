@@ -0,0 +1,94 @@
+#pragma once
+#ifndef SOAR_TX_BUFFER_HPP
+#define SOAR_TX_BUFFER_HPP
+
+/* C/C++ Includes */
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace SOAR_SERIAL
+{
+	/**
+	* @brief Two transmit buffers used alternately
+	*
+	* The next frame is always built in back() while the DMA engine reads from the other
+	* buffer. Once the previous transfer has completed, swap() turns the freshly built back
+	* buffer into the one being sent and hands the old one back out for formatting.
+	*/
+	template<size_t Size>
+	class PingPongBuffer
+	{
+	public:
+		static const size_t capacity = Size;
+
+		PingPongBuffer() : front(0) {}
+
+		/* Buffer that is safe to write into */
+		uint8_t* back() { return buffer[front ^ 1]; }
+
+		/**
+		* @brief Makes the back buffer the one being sent
+		* @returns The buffer to pass to the transmitter
+		* @note Only call once the previous transmission has completed
+		*/
+		uint8_t* swap()
+		{
+			front ^= 1;
+			return buffer[front];
+		}
+
+	private:
+		uint8_t buffer[2][Size];
+		uint8_t front;
+	};
+
+
+	/**
+	* @brief Accounting for the time serialTask spends handing frames to the UART
+	*
+	* callCycles is the cost of the write call itself: the whole transfer for a blocking
+	* write, or only the DMA setup for a DMA one. waitCycles is the time spent waiting for
+	* the previous DMA transfer, which is zero for the first frame of a tick and the rest of
+	* the previous frame's time on the wire for any after it.
+	*/
+	struct TxStats
+	{
+		uint32_t frames;
+		uint32_t bytes;
+		uint32_t lastCallCycles;
+		uint32_t maxCallCycles;
+		uint32_t lastWaitCycles;
+		uint32_t maxWaitCycles;
+		uint32_t lostCompletions;	/* Transfers whose TX_COMPLETE never came, assumed done after their time on the wire */
+
+		TxStats() : frames(0), bytes(0), lastCallCycles(0), maxCallCycles(0),
+			lastWaitCycles(0), maxWaitCycles(0), lostCompletions(0) {}
+
+		void record(size_t length, uint32_t callCycles, uint32_t waitCycles)
+		{
+			frames++;
+			bytes += length;
+
+			lastCallCycles = callCycles;
+			if (callCycles > maxCallCycles)
+				maxCallCycles = callCycles;
+
+			lastWaitCycles = waitCycles;
+			if (waitCycles > maxWaitCycles)
+				maxWaitCycles = waitCycles;
+		}
+
+		/* Average frame length so far */
+		uint32_t averageFrameSize() const { return frames ? (bytes / frames) : 0; }
+	};
+
+	/**
+	* @brief Upper bound on frames per second for a frame size, assuming 8N1 (10 bits per byte)
+	*/
+	inline uint32_t maxFrameRate(uint32_t baud, uint32_t frameSize)
+	{
+		return frameSize ? (baud / 10u) / frameSize : 0;
+	}
+}
+
+#endif
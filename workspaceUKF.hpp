@@ -0,0 +1,361 @@
+#pragma once
+#ifndef SOAR_WORKSPACE_UKF_HPP
+#define SOAR_WORKSPACE_UKF_HPP
+
+/* C/C++ Includes */
+#include <math.h>
+
+/* Eigen Includes */
+#include <Eigen/Eigen>
+
+namespace IMU
+{
+	/**
+	* @brief Scratch storage for WorkspaceSquareRootUKF
+	*
+	* Holds every intermediate predict() and update() produce on the way to the new state
+	* and covariance square root: sigma points, the QR input and its factorisation, the
+	* measurement covariance square root, the cross covariance and the gain. Only the
+	* propagated sigma points carry over, from predict() to the update() that follows it, so
+	* one workspace can be shared by any number of filters in the same task as long as each
+	* filter's update() comes straight after its own predict().
+	*
+	* @tparam T    Scalar type
+	* @tparam N    State dimension. Measurements have the same dimension.
+	*/
+	template<typename T, int N>
+	struct SquareRootUKFWorkspace
+	{
+		static const int SigmaPoints = 2 * N + 1;
+
+		typedef Eigen::Matrix<T, N, N> Matrix;
+		typedef Eigen::Matrix<T, N, 1> Vector;
+		typedef Eigen::Matrix<T, 3 * N, N> Compound;
+
+		Eigen::Matrix<T, N, SigmaPoints> sigmaStatePoints;
+		Eigen::Matrix<T, N, SigmaPoints> sigmaMeasurePoints;
+
+		Compound compound;						/* Weighted sigma point deviations over the noise square root. Reduced to R in place. */
+
+		Matrix noiseRoot;						/* Cholesky factor of the process or measurement noise */
+		Matrix measureRoot;						/* Measurement covariance square root, S_y */
+		Matrix crossCovariance;					/* State/measurement cross covariance, P_xy */
+		Matrix gain;							/* Kalman gain, K */
+
+		Vector predictedMeasurement;
+		Vector deviation;
+		Vector update;							/* Vector being folded into a Cholesky factor */
+	};
+
+	/**
+	* @brief Square root unscented Kalman filter that keeps its scratch out of the call stack
+	*
+	* Runs the same algorithm as Kalman::SquareRootUnscentedKalmanFilter (sigma points, QR of
+	* the weighted deviations, rank one Cholesky update/downdate, gain from triangular solves)
+	* including its choice of measuring the sigma points propagated by predict() rather than
+	* redrawing them around the predicted covariance. The gain is therefore built from the
+	* spread before the process noise was added, exactly as in the library.
+	*
+	* Every step is evaluated in place into a SquareRootUKFWorkspace instead of through Eigen
+	* temporaries on the stack. The factorisations and solves are plain loops rather than Eigen
+	* decompositions, which keeps the call depth flat in unoptimised Debug builds too. The
+	* filter object itself only holds the state, the covariance square root and the sigma
+	* point weights.
+	*
+	* The interface mirrors the SR-UKF so either one can be handed to SOAR_AHRS::FilterChainT.
+	*
+	* @warning The measurement must have the same dimension as the state, which holds for
+	*			every IMU model in IMUModel.hpp.
+	*/
+	template<class StateType>
+	class WorkspaceSquareRootUKF
+	{
+	public:
+		typedef typename StateType::Scalar T;
+		static const int N = StateType::RowsAtCompileTime;
+		typedef SquareRootUKFWorkspace<T, N> Workspace;
+		typedef typename Workspace::Matrix Matrix;
+
+		/**
+		* @brief Workspace used by every filter of this type that is not given its own
+		*/
+		static Workspace& sharedWorkspace()
+		{
+			static Workspace workspace;
+			return workspace;
+		}
+
+		/**
+		* @param [in] alpha, beta, kappa    Sigma point scaling, as for the SR-UKF
+		* @param [in] workspace             Caller owned scratch space. Must outlive the filter.
+		*/
+		WorkspaceSquareRootUKF(T alpha = T(1), T beta = T(2), T kappa = T(0), Workspace& workspace = sharedWorkspace()) :
+			ws(workspace)
+		{
+			const T lambda = alpha * alpha * (T(N) + kappa) - T(N);
+
+			gamma = sqrt(T(N) + lambda);
+			weightMean0 = lambda / (T(N) + lambda);
+			weightCovariance0 = weightMean0 + (T(1) - alpha * alpha + beta);
+			weight = T(1) / (T(2) * (T(N) + lambda));
+
+			x.setZero();
+			S.setIdentity();
+		}
+
+		void init(const StateType& initialState)
+		{
+			x = initialState;
+		}
+
+		/**
+		* @brief Prediction step with a zero control input
+		*/
+		template<class System>
+		const StateType& predict(const System& s)
+		{
+			typename System::Control u;
+			u.setZero();
+
+			computeSigmaPoints();
+			for (int i = 0; i < Workspace::SigmaPoints; i++)
+				ws.sigmaStatePoints.col(i) = s.f(StateType(ws.sigmaStatePoints.col(i)), u);
+
+			weightedMean(ws.sigmaStatePoints, x);
+			covarianceSquareRoot(ws.sigmaStatePoints, x, s.getCovariance(), S);
+			return x;
+		}
+
+		/**
+		* @brief Measurement update
+		*
+		* Measures the sigma points left in the workspace by the preceding predict(), as the
+		* SR-UKF does, so it must follow predict() on this filter.
+		*/
+		template<class Measure, class MeasurementType>
+		const StateType& update(const Measure& m, const MeasurementType& z)
+		{
+			static_assert(MeasurementType::RowsAtCompileTime == N, "WorkspaceSquareRootUKF needs measurements the size of the state");
+
+			for (int i = 0; i < Workspace::SigmaPoints; i++)
+				ws.sigmaMeasurePoints.col(i) = m.h(StateType(ws.sigmaStatePoints.col(i)));
+
+			weightedMean(ws.sigmaMeasurePoints, ws.predictedMeasurement);
+			covarianceSquareRoot(ws.sigmaMeasurePoints, ws.predictedMeasurement, m.getCovariance(), ws.measureRoot);
+
+			/* P_xy = sum(Wc * (X - x)(Y - y)^T) */
+			ws.crossCovariance.setZero();
+			for (int i = 0; i < Workspace::SigmaPoints; i++)
+			{
+				ws.deviation = ws.sigmaStatePoints.col(i) - x;
+				ws.update = ws.sigmaMeasurePoints.col(i) - ws.predictedMeasurement;
+				ws.crossCovariance.noalias() += ((i == 0) ? weightCovariance0 : weight) * ws.deviation * ws.update.transpose();
+			}
+
+			/* K = P_xy (S_y S_y^T)^-1, solved as K^T = S_y^-T S_y^-1 P_xy^T */
+			ws.gain = ws.crossCovariance.transpose();
+			choleskySolveInPlace(ws.measureRoot, ws.gain);
+			ws.gain.transposeInPlace();
+
+			/* S = cholupdate(S, K S_y, -1), one column at a time */
+			for (int j = 0; j < N; j++)
+			{
+				ws.update.noalias() = ws.gain * ws.measureRoot.col(j);
+				rankUpdate(S, -T(1));
+			}
+
+			ws.deviation = z - ws.predictedMeasurement;
+			x.noalias() += ws.gain * ws.deviation;
+			return x;
+		}
+
+		const StateType& getState() const { return x; }
+		const Matrix& getCovarianceSquareRoot() const { return S; }
+
+	private:
+		Workspace& ws;
+
+		StateType x;
+		Matrix S;			/* Lower triangular square root of the state covariance */
+
+		T gamma;
+		T weightMean0, weightCovariance0, weight;
+
+		/* x, x + gamma * S, x - gamma * S */
+		void computeSigmaPoints()
+		{
+			ws.sigmaStatePoints.col(0) = x;
+			for (int i = 0; i < N; i++)
+			{
+				ws.sigmaStatePoints.col(1 + i) = x + gamma * S.col(i);
+				ws.sigmaStatePoints.col(1 + N + i) = x - gamma * S.col(i);
+			}
+		}
+
+		template<class Points, class Mean>
+		void weightedMean(const Points& points, Eigen::MatrixBase<Mean>& mean)
+		{
+			mean = weightMean0 * points.col(0);
+			for (int i = 1; i < Workspace::SigmaPoints; i++)
+				mean += weight * points.col(i);
+		}
+
+		/**
+		* @brief New covariance square root from a set of sigma points and additive noise
+		*
+		* @param [in]  points      Propagated sigma points
+		* @param [in]  mean        Their weighted mean
+		* @param [in]  noise       Noise covariance
+		* @param [out] root        Lower triangular square root of the resulting covariance
+		*/
+		template<class Points, class Mean, class Noise>
+		void covarianceSquareRoot(const Points& points, const Mean& mean, const Noise& noise, Matrix& root)
+		{
+			ws.noiseRoot = noise;
+			choleskyInPlace(ws.noiseRoot);
+
+			const T scale = sqrt(weight);
+			for (int i = 0; i < 2 * N; i++)
+				ws.compound.row(i) = scale * (points.col(1 + i) - mean).transpose();
+			ws.compound.template bottomRows<N>() = ws.noiseRoot.transpose();
+
+			householderInPlace(ws.compound);
+			for (int j = 0; j < N; j++)
+				for (int i = 0; i < N; i++)
+					root(i, j) = (i >= j) ? ws.compound(j, i) : T(0);
+
+			/* The central point carries its own weight, which may be negative */
+			ws.update = points.col(0) - mean;
+			rankUpdate(root, weightCovariance0);
+		}
+
+		/**
+		* @brief L L^T + sigma * v v^T, in place on a lower triangular L, with v in ws.update
+		*
+		* Same recurrence as Eigen's LLT::rankUpdate.
+		*
+		* @returns false if a downdate would leave the matrix indefinite. L is then only partly updated.
+		*/
+		bool rankUpdate(Matrix& L, T sigma)
+		{
+			T beta = T(1);
+
+			for (int j = 0; j < N; j++)
+			{
+				const T Ljj = L(j, j);
+				const T dj = Ljj * Ljj;
+				const T wj = ws.update[j];
+				const T swj2 = sigma * wj * wj;
+				const T g = dj * beta + swj2;
+
+				const T diagonal = dj + swj2 / beta;
+				if (diagonal <= T(0))
+					return false;
+
+				const T nLjj = sqrt(diagonal);
+				L(j, j) = nLjj;
+				beta += swj2 / dj;
+
+				for (int i = j + 1; i < N; i++)
+				{
+					ws.update[i] -= (wj / Ljj) * L(i, j);
+					if (g != T(0))
+						L(i, j) = (nLjj / Ljj) * L(i, j) + (nLjj * sigma * wj / g) * ws.update[i];
+				}
+			}
+
+			return true;
+		}
+
+		/**
+		* @brief Reduces A to R of its QR decomposition with Householder reflections
+		*
+		* Q is never formed. R is left in the upper triangle of the top N rows, the rest of A
+		* holds the reflection vectors.
+		*/
+		static void householderInPlace(typename Workspace::Compound& A)
+		{
+			const int rows = 3 * N;
+
+			for (int k = 0; k < N; k++)
+			{
+				T norm = T(0);
+				for (int i = k; i < rows; i++)
+					norm += A(i, k) * A(i, k);
+				norm = sqrt(norm);
+
+				if (norm == T(0))
+					continue;
+
+				/* v = a - alpha * e1, with alpha chosen to avoid cancellation */
+				const T alpha = (A(k, k) > T(0)) ? -norm : norm;
+				A(k, k) -= alpha;
+
+				T vNorm2 = T(0);
+				for (int i = k; i < rows; i++)
+					vNorm2 += A(i, k) * A(i, k);
+
+				/* Apply I - 2 v v^T / (v^T v) to the remaining columns */
+				for (int j = k + 1; j < N; j++)
+				{
+					T dot = T(0);
+					for (int i = k; i < rows; i++)
+						dot += A(i, k) * A(i, j);
+
+					const T scale = T(2) * dot / vNorm2;
+					for (int i = k; i < rows; i++)
+						A(i, j) -= scale * A(i, k);
+				}
+
+				A(k, k) = alpha;
+			}
+		}
+
+		/* B = (L L^T)^-1 B in place, by forward then back substitution */
+		static void choleskySolveInPlace(const Matrix& L, Matrix& B)
+		{
+			for (int c = 0; c < N; c++)
+			{
+				for (int i = 0; i < N; i++)
+				{
+					T v = B(i, c);
+					for (int k = 0; k < i; k++)
+						v -= L(i, k) * B(k, c);
+					B(i, c) = v / L(i, i);
+				}
+
+				for (int i = N - 1; i >= 0; i--)
+				{
+					T v = B(i, c);
+					for (int k = i + 1; k < N; k++)
+						v -= L(k, i) * B(k, c);
+					B(i, c) = v / L(i, i);
+				}
+			}
+		}
+
+		/* Lower Cholesky factor in place. Leaves zeros above the diagonal. */
+		static void choleskyInPlace(Matrix& A)
+		{
+			for (int j = 0; j < N; j++)
+			{
+				T d = A(j, j);
+				for (int k = 0; k < j; k++)
+					d -= A(j, k) * A(j, k);
+				d = (d > T(0)) ? sqrt(d) : T(0);
+				A(j, j) = d;
+
+				for (int i = j + 1; i < N; i++)
+				{
+					T v = A(i, j);
+					for (int k = 0; k < j; k++)
+						v -= A(i, k) * A(j, k);
+					A(i, j) = (d > T(0)) ? (v / d) : T(0);
+					A(j, i) = T(0);
+				}
+			}
+		}
+	};
+}
+
+#endif